@@ -1,6 +1,7 @@
 from pathlib import Path
 from os import chdir
 import unittest
+import numpy as np
 from nipype.interfaces.base import CommandLine
 from qipype.commands import NewImage, Diff
 from qipype.fitting import DESPOT1, DESPOT1Sim, DESPOT2, DESPOT2Sim, HIFI, HIFISim, FM, FMSim
@@ -18,28 +19,101 @@ class DESPOT_SC(unittest.TestCase):
         chdir('../')
 
     def test_despot1(self):
-        seq = {'SPGR': {'TR': 10e-3, 'FA': [3, 18]}}
-        spgr_file = 'sim_spgr.nii.gz'
+        """Each DESPOT1 fitting variant recovers the simulated maps"""
         img_sz = [32, 32, 32]
         noise = 0.001
-
         NewImage(img_size=img_sz, grad_dim=0, grad_vals=(
             0.8, 1.0), out_file='PD.nii.gz', verbose=vb).run()
         NewImage(img_size=img_sz, grad_dim=1, grad_vals=(
             0.8, 1.3), out_file='T1.nii.gz', verbose=vb).run()
 
-        DESPOT1Sim(sequence=seq, out_file=spgr_file,
-                   noise=noise, verbose=vb,
-                   PD_map='PD.nii.gz', T1_map='T1.nii.gz').run()
-        DESPOT1(sequence=seq, in_file=spgr_file,
-                verbose=vb, residuals=True).run()
-
-        diff_T1 = Diff(in_file='D1_T1.nii.gz', baseline='T1.nii.gz',
-                       noise=noise, verbose=vb).run()
-        diff_PD = Diff(in_file='D1_PD.nii.gz', baseline='PD.nii.gz',
+        # Two flip-angles determine the fit, four over-determine it for the iterative solvers
+        protocols = {'2fa': [3, 18], '4fa': [2, 5, 12, 18]}
+        for name, fa in protocols.items():
+            DESPOT1Sim(sequence={'SPGR': {'TR': 10e-3, 'FA': fa}},
+                       out_file='sim_spgr_{}.nii.gz'.format(name), noise=noise, verbose=vb,
+                       PD_map='PD.nii.gz', T1_map='T1.nii.gz').run()
+
+        variants = [('2fa', {'residuals': True}),
+                    ('4fa', {'algo': 'n', 'iterations': 50, 'prefix': 'NLLS_'}),
+                    ('4fa', {'algo': 'm', 'iterations': 50, 'prefix': 'LM_'}),
+                    ('4fa', {'varpro': True, 'prefix': 'VP_'})]
+        for name, options in variants:
+            prefix = options.get('prefix', '')
+            with self.subTest(protocol=name, prefix=prefix):
+                DESPOT1(sequence={'SPGR': {'TR': 10e-3, 'FA': protocols[name]}},
+                        in_file='sim_spgr_{}.nii.gz'.format(name), verbose=vb, **options).run()
+                for p in ['T1', 'PD']:
+                    diff = Diff(in_file='{}D1_{}.nii.gz'.format(prefix, p),
+                                baseline=p + '.nii.gz', noise=noise, verbose=vb).run()
+                    self.assertLessEqual(diff.outputs.out_diff, 35)
+
+        # The two solvers should agree far more closely than either does with the truth
+        for p in ['T1', 'PD']:
+            diff = Diff(in_file='LM_D1_{}.nii.gz'.format(p),
+                        baseline='NLLS_D1_{}.nii.gz'.format(p), noise=noise, verbose=vb).run()
+            self.assertLessEqual(diff.outputs.out_diff, 1)
+
+    def test_despot1_seed(self):
+        """Simulated noise depends only on the seed, not the number of threads"""
+        seq = {'SPGR': {'TR': 10e-3, 'FA': [3, 18]}}
+        img_sz = [32, 32, 32]
+        NewImage(img_size=img_sz, fill=1.0, out_file='PD.nii.gz', verbose=vb).run()
+        NewImage(img_size=img_sz, grad_dim=1, grad_vals=(
+            0.8, 1.3), out_file='T1.nii.gz', verbose=vb).run()
+        for name, seed, threads in [('a', 42, 1), ('b', 42, 4), ('c', 43, 4)]:
+            spgr_file = 'sim_seed_{}.nii.gz'.format(name)
+            DESPOT1Sim(sequence=seq, out_file=spgr_file, noise=0.01, seed=seed, threads=threads,
+                       verbose=vb, PD_map='PD.nii.gz', T1_map='T1.nii.gz').run()
+            DESPOT1(sequence=seq, in_file=spgr_file, prefix=name + '_', verbose=vb).run()
+        same = Diff(in_file='b_D1_T1.nii.gz', baseline='a_D1_T1.nii.gz',
+                    abs_diff=True, verbose=vb).run()
+        different = Diff(in_file='c_D1_T1.nii.gz', baseline='a_D1_T1.nii.gz',
+                         abs_diff=True, verbose=vb).run()
+        self.assertEqual(same.outputs.out_diff, 0)
+        self.assertGreater(different.outputs.out_diff, 0)
+
+    def test_despot1_montecarlo(self):
+        seq = {'SPGR': {'TR': 10e-3, 'FA': [3, 18]}}
+        img_sz = [16, 16, 4]
+        noise = 0.0005
+        NewImage(img_size=img_sz, fill=1.0, out_file='PD.nii.gz', verbose=vb).run()
+        NewImage(img_size=img_sz, fill=1.0, out_file='T1.nii.gz', verbose=vb).run()
+
+        # Two flip angles determine the fit exactly, so at high SNR its SD is the linearised error.
+        # Magnitude noise has SD noise/sqrt(2) because the simulated noise is complex.
+        fa = np.radians(seq['SPGR']['FA'])
+
+        def spgr(PD, T1):
+            E1 = np.exp(-seq['SPGR']['TR'] / T1)
+            return PD * np.sin(fa) * (1 - E1) / (1 - E1 * np.cos(fa))
+        h = 1e-6
+        J = np.stack([(spgr(1 + h, 1) - spgr(1 - h, 1)) / (2 * h),
+                      (spgr(1, 1 + h) - spgr(1, 1 - h)) / (2 * h)], axis=1)
+        sd = np.sqrt(np.diag(np.linalg.inv(J.T @ J))) * noise / np.sqrt(2)
+        NewImage(img_size=img_sz, fill=sd[0], out_file='PD_sd.nii.gz', verbose=vb).run()
+        NewImage(img_size=img_sz, fill=sd[1], out_file='T1_sd.nii.gz', verbose=vb).run()
+        NewImage(img_size=img_sz, fill=0.0, out_file='zero.nii.gz', verbose=vb).run()
+
+        DESPOT1Sim(sequence=seq, out_file='unused.nii.gz', noise=noise, montecarlo=100, seed=1,
+                   prefix='mc_', verbose=vb, PD_map='PD.nii.gz', T1_map='T1.nii.gz').run()
+        diff_T1 = Diff(in_file='mc_D1_T1_mc_mean.nii.gz', baseline='T1.nii.gz',
                        noise=noise, verbose=vb).run()
         self.assertLessEqual(diff_T1.outputs.out_diff, 35)
-        self.assertLessEqual(diff_PD.outputs.out_diff, 35)
+        for i, p in enumerate(['PD', 'T1']):
+            # 100 realisations estimate an SD to about 7%, and a bias to a tenth of the SD
+            diff_sd = Diff(in_file='mc_D1_{}_mc_sd.nii.gz'.format(p), baseline=p + '_sd.nii.gz',
+                           noise=1, verbose=vb).run()
+            diff_bias = Diff(in_file='mc_D1_{}_mc_bias.nii.gz'.format(p), baseline='zero.nii.gz',
+                             abs_diff=True, noise=sd[i], verbose=vb).run()
+            self.assertLessEqual(diff_sd.outputs.out_diff, 0.15)
+            self.assertLessEqual(diff_bias.outputs.out_diff, 0.3)
+        self.assertTrue(Path('mc_D1_mc_failures.nii.gz').exists())
+
+        # Without noise every realisation would be identical
+        with self.assertRaises(RuntimeError):
+            DESPOT1Sim(sequence=seq, out_file='unused.nii.gz', montecarlo=100,
+                       prefix='mc0_', verbose=vb, PD_map='PD.nii.gz', T1_map='T1.nii.gz').run()
 
     def test_hifi(self):
         seqs = {'SPGR': {'TR': 5e-3, 'FA': [3, 18]},
@@ -73,7 +147,7 @@ class DESPOT_SC(unittest.TestCase):
         self.assertLessEqual(diff_PD.outputs.out_diff, 35)
         self.assertLessEqual(diff_B1.outputs.out_diff, 60)
 
-    def test_despot2(self, gs=False, tol=20):
+    def test_despot2(self, gs=False, tol=20, varpro=False):
         seq = {'SSFP': {'TR': 10e-3,
                         'FA': [15, 30, 45, 60],
                         'PhaseInc': [180, 180, 180, 180]}}
@@ -92,7 +166,7 @@ class DESPOT_SC(unittest.TestCase):
                    ellipse=gs, noise=noise, verbose=vb,
                    PD_map='PD.nii.gz', T2_map='T2.nii.gz', T1_map='T1.nii.gz').run()
         DESPOT2(sequence=seq, in_file=ssfp_file,
-                T1_map='T1.nii.gz', ellipse=gs, verbose=vb, residuals=True).run()
+                T1_map='T1.nii.gz', ellipse=gs, varpro=varpro, verbose=vb, residuals=True).run()
 
         diff_T2 = Diff(in_file='D2_T2.nii.gz', baseline='T2.nii.gz',
                        noise=noise, verbose=vb).run()
@@ -104,7 +178,10 @@ class DESPOT_SC(unittest.TestCase):
     def test_despot2gs(self):
         self.test_despot2(True, 30)
 
-    def test_fm(self):
+    def test_despot2_varpro(self):
+        self.test_despot2(varpro=True)
+
+    def test_fm(self, warm=False):
         seq = {'SSFP': {'TR': 5e-3,
                         'FA': [15, 15, 60, 60],
                         'PhaseInc': [180, 0, 180, 0]}
@@ -126,7 +203,7 @@ class DESPOT_SC(unittest.TestCase):
                     T1_map='T1.nii.gz', noise=noise, verbose=vb,
                     PD_map='PD.nii.gz', T2_map='T2.nii.gz', f0_map='f0.nii.gz')
         sim.run()
-        FM(sequence=seq, in_file=ssfp_file, asym=False,
+        FM(sequence=seq, in_file=ssfp_file, asym=False, warm=warm,
            T1_map='T1.nii.gz', verbose=vb, residuals=True).run()
 
         diff_T2 = Diff(in_file='FM_T2.nii.gz', baseline='T2.nii.gz',
@@ -136,6 +213,9 @@ class DESPOT_SC(unittest.TestCase):
         self.assertLessEqual(diff_T2.outputs.out_diff, 20)
         self.assertLessEqual(diff_PD.outputs.out_diff, 10)
 
+    def test_fm_warm(self):
+        self.test_fm(True)
+
 
 if __name__ == '__main__':
     unittest.main()
@@ -1,7 +1,9 @@
 from pathlib import Path
 from os import chdir
+import json
 import unittest
 import numpy as np
+import nibabel as nib
 from nipype.interfaces.base import CommandLine
 from qipype.fitting import LtzWaterMT, LtzWaterMTSim, qMT, qMTSim
 from qipype.commands import NewImage, Diff, ZSpec, Lineshape
@@ -116,7 +118,10 @@ class MT(unittest.TestCase):
                T2_f_map='T2_f.nii.gz',
                k_map='k.nii.gz').run()
         qMT(sequence=qmt, in_file=qmt_file, T1_map=t1app,
-            lineshape=lineshape_file, verbose=vb).run()
+            lineshape=lineshape_file, verbose=vb, telemetry='qmt_telemetry.json').run()
+        with open('qmt_telemetry.json') as f:
+            telemetry = json.load(f)
+        self.assertEqual(telemetry['voxels'], img_sz[0] * img_sz[1] * img_sz[2])
 
         diff_PD = Diff(in_file='QMT_M0_f.nii.gz', baseline='M0_f.nii.gz',
                        noise=noise, verbose=vb).run()
@@ -128,6 +133,45 @@ class MT(unittest.TestCase):
         self.assertLessEqual(diff_f_b.outputs.out_diff, 50)
         self.assertLessEqual(diff_k.outputs.out_diff, 50)
 
+    def test_qMT_lm_warm(self):
+        # Starting from the neighbours must save iterations, so the start point has to be used
+        self.test_qMT()
+        qmt = {'MTSat': {
+            'TR': 0.032,
+            'Trf': 0.020,
+            'FA': 5,
+            'sat_f0': [1000, 1000, 2236, 2236, 5000, 5000, 11180, 11180, 250000, 250000],
+            'sat_angle': [750, 360, 750, 360, 750, 360, 750, 360, 750, 360],
+            'pulse': {'name': 'Gauss', 'p1': 0.416, 'p2': 0.295, 'bandwidth': 200}
+        }
+        }
+        iterations = {}
+        for warm in [False, True]:
+            name = 'qmt_lm_warm' if warm else 'qmt_lm_cold'
+            qMT(sequence=qmt, in_file='qmt_sim.nii.gz', T1_map='qmt_t1app.nii.gz',
+                lineshape='_qmt_lineshape.json', lm=True, warm=warm, prefix=name + '_',
+                verbose=vb, telemetry=name + '.json').run()
+            with open(name + '.json') as f:
+                telemetry = json.load(f)
+            iterations[warm] = sum(b['count'] * (b['min'] + b['max']) / 2
+                                   for b in telemetry['iterations'])
+        self.assertLess(iterations[True], iterations[False])
+        diff_f_b = Diff(in_file='qmt_lm_warm_QMT_f_b.nii.gz', baseline='f_b.nii.gz',
+                        abs_diff=True, noise=0.001, verbose=vb).run()
+        self.assertLessEqual(diff_f_b.outputs.out_diff, 50)
+
+    def test_superlorentzian_table(self):
+        # The second T2b takes the highest frequencies past the end of the table
+        for t2b in [10e-6, 50e-6]:
+            values = []
+            for quad in [False, True]:
+                ls_file = '_sl_{}.json'.format('quad' if quad else 'table')
+                Lineshape(out_file=ls_file, lineshape='SuperLorentzian', t2b=t2b,
+                          quadrature=quad, frq_start=100, frq_space=997, frq_count=250).run()
+                with open(ls_file) as f:
+                    values.append(np.array(json.load(f)['lineshape']['values']))
+            np.testing.assert_allclose(values[0], values[1], rtol=1e-5)
+
     def test_ZSpec(self):
         NewImage(out_file='zspec_linear.nii.gz', verbose=vb, img_size=[8, 8, 8, 4],
                  grad_dim=3, grad_vals=(-3, 3)).run()
@@ -141,6 +185,39 @@ class MT(unittest.TestCase):
                          baseline='zspec_zero.nii.gz', noise=1, verbose=vb).run()
         self.assertLessEqual(diff_zero.outputs.out_diff, 0.01)
 
+    def test_ZSpec_f0_asym(self):
+        # A Gaussian dip centred on f0 is symmetric about f0, so its asymmetry is zero only if
+        # the f0 map is used. f0 and the offsets are whole numbers, so f0 +/- offset always
+        # lands on an input frequency and the spline is exact there.
+        in_freqs = np.arange(-5, 6)
+        f0 = np.tile(np.array([-1., 0., 1., 2.]), 2)[:, None, None] * np.ones((8, 8, 8))
+        zspec = 1 - 0.8 * np.exp(-((in_freqs - f0[..., None]) / 1.5)**2)
+        nib.save(nib.Nifti1Image(zspec.astype(np.float32), np.eye(4)), 'zspec_gauss.nii.gz')
+        nib.save(nib.Nifti1Image(f0.astype(np.float32), np.eye(4)), 'zspec_f0.nii.gz')
+        nib.save(nib.Nifti1Image(np.zeros((8, 8, 8, 3), np.float32), np.eye(4)),
+                 'zspec_asym_zero.nii.gz')
+        ZSpec(in_file='zspec_gauss.nii.gz',
+              in_freqs=in_freqs.tolist(),
+              out_freqs=[1, 2, 3],
+              f0_map='zspec_f0.nii.gz',
+              asym=True,
+              out_file='zspec_asym.nii.gz',
+              verbose=vb).run()
+        diff_asym = Diff(in_file='zspec_asym.nii.gz', abs_diff=True,
+                         baseline='zspec_asym_zero.nii.gz', noise=1, verbose=vb).run()
+        self.assertLessEqual(diff_asym.outputs.out_diff, 1e-4)
+
+        # Without the f0 map the same data is asymmetric
+        ZSpec(in_file='zspec_gauss.nii.gz',
+              in_freqs=in_freqs.tolist(),
+              out_freqs=[1, 2, 3],
+              asym=True,
+              out_file='zspec_asym_nof0.nii.gz',
+              verbose=vb).run()
+        diff_nof0 = Diff(in_file='zspec_asym_nof0.nii.gz', abs_diff=True,
+                         baseline='zspec_asym_zero.nii.gz', noise=1, verbose=vb).run()
+        self.assertGreater(diff_nof0.outputs.out_diff, 0.1)
+
 
 if __name__ == '__main__':
     unittest.main()
@@ -56,14 +56,17 @@ class Perfusion(unittest.TestCase):
                   dT_map='dT.nii.gz',
                   R2p_map='R2p.nii.gz',
                   DBV_map='DBV.nii.gz').run()
-        ASEDBV(sequence=seq, in_file=ase_file, verbose=vb).run()
-
-        diff_R2p = Diff(in_file='ASE_R2p.nii.gz', baseline='R2p.nii.gz',
-                        noise=noise, verbose=vb).run()
-        diff_DBV = Diff(in_file='ASE_DBV.nii.gz', baseline='DBV.nii.gz',
-                        noise=noise, verbose=vb).run()
-        self.assertLessEqual(diff_R2p.outputs.out_diff, 20)
-        self.assertLessEqual(diff_DBV.outputs.out_diff, 75)
+        # The default fit, then Variable Projection
+        for options in [{}, {'varpro': True, 'prefix': 'VP_'}]:
+            prefix = options.get('prefix', '')
+            ASEDBV(sequence=seq, in_file=ase_file, verbose=vb, **options).run()
+
+            diff_R2p = Diff(in_file=prefix + 'ASE_R2p.nii.gz', baseline='R2p.nii.gz',
+                            noise=noise, verbose=vb).run()
+            diff_DBV = Diff(in_file=prefix + 'ASE_DBV.nii.gz', baseline='DBV.nii.gz',
+                            noise=noise, verbose=vb).run()
+            self.assertLessEqual(diff_R2p.outputs.out_diff, 20)
+            self.assertLessEqual(diff_DBV.outputs.out_diff, 75)
 
     def test_oef_fixed_dbv(self):
         # Use MultiEchoFlex as a proxy for ASE
@@ -92,6 +95,33 @@ class Perfusion(unittest.TestCase):
                         noise=noise, verbose=vb).run()
         self.assertLessEqual(diff_R2p.outputs.out_diff, 1.0)
 
+    def test_oef_table(self):
+        # The fc table must reproduce the quadrature it replaces
+        seq = {'MultiEcho': {'TR': 2.5,
+                             'TE': [-0.07, -0.05, -0.03, -0.01, 0.0, 0.01, 0.03, 0.05, 0.07]}}
+        img_sz = [16, 16, 16]
+
+        NewImage(img_size=img_sz, fill=100.,
+                 out_file='S0.nii.gz', verbose=vb).run()
+        NewImage(img_size=img_sz, grad_dim=0, grad_vals=(-0.01, 0.01),
+                 out_file='dT.nii.gz', verbose=vb).run()
+        NewImage(img_size=img_sz, grad_dim=1, grad_vals=(1.0, 3.0),
+                 out_file='R2p.nii.gz', verbose=vb).run()
+        NewImage(img_size=img_sz, grad_dim=2, grad_vals=(0.005, 0.025),
+                 out_file='DBV.nii.gz', verbose=vb).run()
+
+        for quad in [False, True]:
+            ASEDBVSim(sequence=seq, out_file='sim_ase_{}.nii.gz'.format('quad' if quad else 'table'),
+                      noise=0, quadrature=quad, verbose=vb,
+                      S0_map='S0.nii.gz',
+                      dT_map='dT.nii.gz',
+                      R2p_map='R2p.nii.gz',
+                      DBV_map='DBV.nii.gz').run()
+
+        diff_table = Diff(in_file='sim_ase_table.nii.gz', baseline='sim_ase_quad.nii.gz',
+                          noise=1, verbose=vb).run()
+        self.assertLessEqual(diff_table.outputs.out_diff, 1e-5)
+
     def test_zshim(self):
         nshims = 8
         sz = 32
@@ -1,9 +1,10 @@
 from pathlib import Path
-from os import chdir
+from os import chdir, stat
+import json
 import unittest
 from nipype.interfaces.base import CommandLine
 from qipype.commands import NewImage, Diff
-from qipype.fitting import Multiecho, MultiechoSim
+from qipype.fitting import Multiecho, MultiechoSim, mcDESPOT, mcDESPOTSim
 
 vb = True
 CommandLine.terminal_output = 'allatonce'
@@ -41,6 +42,102 @@ class Relax(unittest.TestCase):
         self.assertLessEqual(diff_T2.outputs.out_diff, 3)
         self.assertLessEqual(diff_PD.outputs.out_diff, 2)
 
+    def test_mcdespot_src(self):
+        """Benchmark the SRC samplers and schedules by evaluation count and parameter error"""
+        seq = {'SPGR': {'TR': 8e-3, 'TE': 3e-3, 'FA': [2, 4, 6, 8, 10, 12, 14, 16]},
+               'SSFP': {'TR': 8e-3, 'FA': [12, 16, 24, 32, 40, 50, 60, 70, 12, 16, 24, 32, 40, 50, 60, 70],
+                        'PhaseInc': [180, 180, 180, 180, 180, 180, 180, 180, 0, 0, 0, 0, 0, 0, 0, 0]}}
+        spgr_file = 'sim_mcd_spgr.nii.gz'
+        ssfp_file = 'sim_mcd_ssfp.nii.gz'
+        img_sz = [8, 8, 2]
+        noise = 0.002
+        values = {'PD': 1.0, 'T1_m': 0.465, 'T2_m': 0.02,
+                  'T1_ie': 1.07, 'T2_ie': 0.117, 'tau_m': 0.2}
+        maps = {}
+        for name, value in values.items():
+            maps[name + '_map'] = name + '.nii.gz'
+            NewImage(img_size=img_sz, fill=value,
+                     out_file=maps[name + '_map'], verbose=vb).run()
+        maps['f_m_map'] = 'f_m.nii.gz'
+        NewImage(img_size=img_sz, grad_dim=0, grad_vals=(0.1, 0.25),
+                 out_file='f_m.nii.gz', verbose=vb).run()
+        mcDESPOTSim(sequence=seq, spgr_file=spgr_file, ssfp_file=ssfp_file, scale=True,
+                    noise=noise, verbose=vb, **maps).run()
+
+        configs = {'random': {},
+                   'sobol': {'sampler': 'sobol'},
+                   'adaptive': {'adaptive': True},
+                   'sobol_adaptive': {'sampler': 'sobol', 'adaptive': True}}
+        results = {}
+        for name, options in configs.items():
+            telemetry_file = 'mcd_{}_telemetry.json'.format(name)
+            mcDESPOT(sequence=seq, spgr_file=spgr_file, ssfp_file=ssfp_file, scale=True, seed=42,
+                     prefix=name + '_', telemetry=telemetry_file, verbose=vb, **options).run()
+            with open(telemetry_file) as f:
+                telemetry = json.load(f)
+            diff_f_m = Diff(in_file=name + '_2C_f_m.nii.gz', baseline='f_m.nii.gz',
+                            noise=noise, verbose=vb).run()
+            results[name] = (telemetry['src_evaluations'], telemetry['seconds']['fit'],
+                             diff_f_m.outputs.out_diff)
+        print('\n{:>16} {:>12} {:>10} {:>10}'.format('SRC', 'Evaluations', 'Fit (s)', 'f_m diff'))
+        for name, (evals, seconds, diff) in results.items():
+            print('{:>16} {:>12} {:>10.2f} {:>10.2f}'.format(name, evals, seconds, diff))
+
+        # Sobol keeps the sample count, so should be no less accurate for no more evaluations
+        self.assertLessEqual(results['sobol'][0], results['random'][0])
+        self.assertLessEqual(results['sobol'][2], results['random'][2] + 1)
+        for name in ['adaptive', 'sobol_adaptive']:
+            self.assertLess(results[name][0], results['random'][0])
+            self.assertLessEqual(results[name][2], 1.5 * results['random'][2] + 1)
+
+    def test_mcdespot_dict(self):
+        seq = {'SPGR': {'TR': 8e-3, 'TE': 3e-3, 'FA': [2, 4, 6, 8, 10, 12, 14, 16]},
+               'SSFP': {'TR': 8e-3, 'FA': [12, 16, 24, 32, 40, 50, 60, 70, 12, 16, 24, 32, 40, 50, 60, 70],
+                        'PhaseInc': [180, 180, 180, 180, 180, 180, 180, 180, 0, 0, 0, 0, 0, 0, 0, 0]},
+               'dictionary': {'T1_m': 0.465, 'T2_m': 0.02, 'T1_ie': [0.9, 1.3, 9], 'T2_ie': 0.117,
+                              'tau_m': 0.2, 'f_m': [0.0, 0.35, 36]}}
+        spgr_file = 'sim_mcd_dict_spgr.nii.gz'
+        ssfp_file = 'sim_mcd_dict_ssfp.nii.gz'
+        img_sz = [16, 16, 2]
+        noise = 0.002
+        values = {'PD': 1.0, 'T1_m': 0.465, 'T2_m': 0.02, 'T2_ie': 0.117, 'tau_m': 0.2}
+        maps = {}
+        for name, value in values.items():
+            maps[name + '_map'] = name + '.nii.gz'
+            NewImage(img_size=img_sz, fill=value,
+                     out_file=maps[name + '_map'], verbose=vb).run()
+        maps['T1_ie_map'] = 'T1_ie.nii.gz'
+        NewImage(img_size=img_sz, grad_dim=1, grad_vals=(0.95, 1.25),
+                 out_file='T1_ie.nii.gz', verbose=vb).run()
+        maps['f_m_map'] = 'f_m.nii.gz'
+        NewImage(img_size=img_sz, grad_dim=0, grad_vals=(0.1, 0.25),
+                 out_file='f_m.nii.gz', verbose=vb).run()
+        mcDESPOTSim(sequence=seq, spgr_file=spgr_file, ssfp_file=ssfp_file, scale=True,
+                    noise=noise, verbose=vb, **maps).run()
+
+        # A dictionary left from a different grid must be rebuilt, not used or refused
+        stale = dict(seq, dictionary=dict(seq['dictionary'], f_m=[0.0, 0.35, 8]))
+        mcDESPOT(sequence=stale, spgr_file=spgr_file, ssfp_file=ssfp_file, scale=True,
+                 dict='mcd.dict', prefix='dict_stale_', verbose=vb).run()
+        # The second run re-uses the saved dictionary, so must not rewrite it
+        saved = None
+        for prefix, options in [('dict_', {}), ('dict_reuse_', {}),
+                                ('dict_float_', {'dict_float': True}),
+                                ('dict_polish_', {'polish': 10})]:
+            dict_file = 'mcd_float.dict' if 'dict_float' in options else 'mcd.dict'
+            mcDESPOT(sequence=seq, spgr_file=spgr_file, ssfp_file=ssfp_file, scale=True,
+                     dict=dict_file, prefix=prefix, verbose=vb, **options).run()
+            if prefix == 'dict_':
+                saved = stat('mcd.dict').st_mtime_ns
+            elif prefix == 'dict_reuse_':
+                self.assertEqual(stat('mcd.dict').st_mtime_ns, saved)
+            diff_f_m = Diff(in_file=prefix + '2C_f_m.nii.gz', baseline='f_m.nii.gz',
+                            noise=noise, verbose=vb).run()
+            diff_T1_ie = Diff(in_file=prefix + '2C_T1_ie.nii.gz', baseline='T1_ie.nii.gz',
+                              noise=noise, verbose=vb).run()
+            self.assertLessEqual(diff_f_m.outputs.out_diff, 50)
+            self.assertLessEqual(diff_T1_ie.outputs.out_diff, 15)
+
 
 if __name__ == '__main__':
     unittest.main()
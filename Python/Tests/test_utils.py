@@ -1,10 +1,11 @@
 from pathlib import Path
 from os import chdir
+import gzip
 import unittest
 from math import sqrt
 from nipype.interfaces.base import CommandLine
-from qipype.commands import NewImage, Diff
-from qipype.utils import PolyImage, PolyFit, Filter, RFProfile
+from qipype.commands import NewImage, Diff, ZSpec
+from qipype.utils import PolyImage, PolyFit, Filter, RFProfile, Affine
 
 vb = True
 CommandLine.terminal_output = 'allatonce'
@@ -60,6 +61,48 @@ class Utils(unittest.TestCase):
                        noise=1, abs_diff=True, verbose=vb).run()
         self.assertLessEqual(rf_diff.outputs.out_diff, 1.e-3)
 
+    def test_mapped_read(self):
+        # Uncompressed NIfTI is memory-mapped, compressed goes through ITK. Results must agree.
+        for ext in ['.nii', '.nii.gz']:
+            NewImage(out_file='map_vol' + ext, img_size=[16, 16, 16],
+                     grad_dim=0, grad_vals=(1, 2), verbose=vb).run()
+            NewImage(out_file='map_series' + ext, img_size=[16, 16, 16, 5],
+                     grad_dim=3, grad_vals=(-2, 2), verbose=vb).run()
+            ZSpec(in_file='map_series' + ext, in_freqs=[-2, -1, 0, 1, 2], out_freqs=[0.5],
+                  out_file='map_interp' + ext.replace('.', '_') + '.nii.gz', verbose=vb).run()
+        vol_diff = Diff(baseline='map_vol.nii.gz', in_file='map_vol.nii',
+                        noise=1, verbose=vb).run()
+        self.assertLessEqual(vol_diff.outputs.out_diff, 1.e-6)
+        series_diff = Diff(baseline='map_interp_nii_gz.nii.gz', in_file='map_interp_nii.nii.gz',
+                           noise=1, verbose=vb).run()
+        self.assertLessEqual(series_diff.outputs.out_diff, 1.e-6)
+
+    def test_inplace_affine(self):
+        # The input is mapped from the file being overwritten. Only the header should change.
+        NewImage(out_file='inplace.nii', img_size=[16, 16, 16],
+                 grad_dim=0, grad_vals=(1, 2), verbose=vb).run()
+        NewImage(out_file='inplace_ref.nii.gz', img_size=[16, 16, 16],
+                 grad_dim=0, grad_vals=(1, 2), verbose=vb).run()
+        Affine(in_file='inplace.nii', scale=2.0, verbose=vb).run()
+        inplace_diff = Diff(baseline='inplace_ref.nii.gz', in_file='inplace.nii',
+                            noise=1, verbose=vb).run()
+        self.assertLessEqual(inplace_diff.outputs.out_diff, 1.e-6)
+
+    def test_streamed_write(self):
+        # Large enough that uncompressed output is streamed in several pieces, while compressed
+        # output is written in one. Both must hold the same bytes.
+        NewImage(out_file='stream_in.nii.gz', img_size=[64, 64, 64, 5],
+                 grad_dim=3, grad_vals=(-2, 2), verbose=vb).run()
+        out_freqs = [-2 + 0.1 * i for i in range(40)]
+        for ext in ['.nii', '.nii.gz']:
+            ZSpec(in_file='stream_in.nii.gz', in_freqs=[-2, -1, 0, 1, 2], out_freqs=out_freqs,
+                  out_file='stream_out' + ext, verbose=vb).run()
+        with open('stream_out.nii', 'rb') as f:
+            streamed = f.read()
+        with gzip.open('stream_out.nii.gz', 'rb') as f:
+            whole = f.read()
+        self.assertEqual(streamed, whole)
+
 
 if __name__ == '__main__':
     unittest.main()
@@ -301,6 +301,8 @@ class LineshapeInputSpec(InputBaseSpec):
                              desc='Start frequency for table (default 1 kHZ)')
     frq_space = traits.Float(
         argstr='--frq_space=%f', desc='Spacing of frequencies in table (default 1kHz)')
+    quadrature = traits.Bool(argstr='--quadrature',
+                             desc='Integrate the Super-Lorentzian instead of using the table')
 
 
 class LineshapeOutputSpec(TraitedSpec):
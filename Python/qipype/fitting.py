@@ -58,9 +58,10 @@ def FitIS(name, fixed=None, in_files=None, extra=None):
     return T
 
 
-def SimIS(name, varying, fixed=None, out_files=None, extra=None):
+def SimIS(name, varying, fixed=None, out_files=None, extra=None, sim_extra=None):
     """
-    Input specification for tools in simulation mode
+    Input specification for tools in simulation mode. sim_extra holds traits that only apply to
+    simulation, extra those shared with fitting.
     """
     if fixed is None:
         fixed = []
@@ -70,6 +71,7 @@ def SimIS(name, varying, fixed=None, out_files=None, extra=None):
 
     attrs = {'noise': traits.Float(desc='Noise level to add to simulation',
                                    argstr='--simulate=%f', default_value=0.0, usedefault=True),
+             'seed': traits.Int(desc='Seed for simulated noise (default random)', argstr='--seed=%d'),
              '__module__': __name__}
     varying_names = []
     for v in varying:
@@ -90,9 +92,10 @@ def SimIS(name, varying, fixed=None, out_files=None, extra=None):
         desc = 'Output {} file'.format(o)
         attrs[aname] = File(argstr='%s', mandatory=True,
                             position=idx, desc=desc)
-    if extra:
-        for k, v in extra.items():
-            attrs[k] = v
+    for e in [extra, sim_extra]:
+        if e:
+            for k, v in e.items():
+                attrs[k] = v
     T = type(name + 'SimIS', (InputSpec,), attrs)
     return T
 
@@ -174,7 +177,7 @@ class SimCommand(BaseCommand):
 
 
 def Command(toolname, cmd, file_prefix, varying,
-            derived=None, fixed=None, files=None, extra=None,
+            derived=None, fixed=None, files=None, extra=None, sim_extra=None,
             init=None):
     fit_ispec = FitIS(toolname,
                       fixed=fixed,
@@ -184,7 +187,8 @@ def Command(toolname, cmd, file_prefix, varying,
                       varying=varying,
                       fixed=fixed,
                       out_files=files,
-                      extra=extra)
+                      extra=extra,
+                      sim_extra=sim_extra)
 
     fit_ospec = FitOS(toolname, file_prefix,
                       varying=varying, derived=derived)
@@ -204,14 +208,24 @@ def Command(toolname, cmd, file_prefix, varying,
     return (fit_cmd, sim_cmd, fit_ispec, fit_ospec, sim_ispec, sim_ospec)
 
 
+def MonteCarlo():
+    """
+    Simulation option for the tools that support Monte Carlo precision estimates
+    """
+    return {'montecarlo': traits.Int(desc='Fit N noisy realisations in memory and write mean/SD/bias maps instead',
+                                     argstr='--montecarlo=%d')}
+
+
 # Relaxometry Commands
 
 DESPOT1, DESPOT1Sim, DESPOT1FitIS, DESPOT1FitOS, DESPOT1SimIS, DESPOT1SimOS = Command(
     'DESPOT1', 'qi despot1', 'D1',
     varying=['PD', 'T1'],
     fixed=['B1'],
-    extra={'algo': traits.String(desc="Choose algorithm (l/w/n)", argstr="--algo=%s"),
-           'iterations': traits.Int(desc='Max iterations for WLLS/NLLS (default 15)', argstr='--its=%d')})
+    extra={'algo': traits.String(desc="Choose algorithm (l/w/n/m)", argstr="--algo=%s"),
+           'iterations': traits.Int(desc='Max iterations for WLLS/NLLS/LM (default 15)', argstr='--its=%d'),
+           'varpro': traits.Bool(desc='Eliminate PD with Variable Projection', argstr='--varpro')},
+    sim_extra=MonteCarlo())
 
 HIFI, HIFISim, HIFIFitIS, HIFIFitOS, HIFISimIS, HIFISimOS = Command(
     'HIFI', 'qi despot1hifi', 'HIFI',
@@ -227,14 +241,16 @@ DESPOT2, DESPOT2Sim, DESPOT2FitIS, DESPOT2FitOS, DESPOT2SimIS, DESPOT2SimOS = Co
            'ellipse': traits.Bool(desc="Data is ellipse geometric solution", argstr='--gs'),
            'iterations': traits.Int(desc='Max iterations for WLLS/NLLS (default 15)', argstr='--its=%d'),
            'clamp_PD': traits.Float(desc='Clamp PD between 0 and value', argstr='-f %f'),
-           'clamp_T2': traits.Float(desc='Clamp T2 between 0 and value', argstr='--clampT1=%f')})
+           'clamp_T2': traits.Float(desc='Clamp T2 between 0 and value', argstr='--clampT1=%f'),
+           'varpro': traits.Bool(desc='Eliminate PD with Variable Projection', argstr='--varpro')})
 
 FM, FMSim, FMFitIS, FMFitOS, FMSimIS, FMSimOS = Command(
     'FM', 'qi despot2fm', 'FM',
     varying=['PD', 'T2', 'f0'],
     fixed=['B1', 'T1'],
     extra={'asym': traits.Bool(desc="Fit asymmetric (+/-) off-resonance frequency", argstr='--asym'),
-           'algo': traits.Enum("LLS", "WLS", "NLS", desc="Choose algorithm", argstr="--algo=%d")})
+           'algo': traits.Enum("LLS", "WLS", "NLS", desc="Choose algorithm", argstr="--algo=%d"),
+           'warm': traits.Bool(desc='Start from fitted neighbours instead of multiple f0 starts', argstr='--warm')})
 
 JSR, JSRSim, JSRFitIS, JSRFitOS, JSRSimIS, JSRSimOS = Command(
     'JSR', 'qi jsr', 'JSR',
@@ -254,6 +270,22 @@ Ellipse, EllipseSim, EllipseFitIS, EllipseFitOS, EllipseSimIS, EllipseSimOS = Co
 PLANET, PLANETSim, PLANETFitIS, PLANETFitOS, PLANETSimIS, PLANETSimOS = Command(
     'PLANET', 'qi planet', 'PLANET', varying=['PD', 'T1', 'T2'], fixed=['B1'], files=['G', 'a', 'b'])
 
+mcDESPOT, mcDESPOTSim, mcDESPOTFitIS, mcDESPOTFitOS, mcDESPOTSimIS, mcDESPOTSimOS = Command(
+    'mcDESPOT', 'qi mcdespot', '2C',
+    varying=['PD', 'T1_m', 'T2_m', 'T1_ie', 'T2_ie', 'tau_m', 'f_m'],
+    fixed=['f0', 'B1'],
+    files=['spgr', 'ssfp'],
+    extra={'model': traits.Int(2, usedefault=True, desc='Number of pools, outputs assume 2', argstr='--model=%d'),
+           'scale': traits.Bool(desc='Normalize signals to mean', argstr='--scale'),
+           'sampler': traits.Enum('random', 'sobol', desc='SRC sampler', argstr='--sampler=%s'),
+           'adaptive': traits.Bool(desc='Shrink the SRC sample count as the region contracts', argstr='--adaptive'),
+           'seed': traits.Int(desc='Seed for SRC, and for simulated noise (default random)', argstr='--seed=%d'),
+           'dict': traits.String(desc='Match to a dictionary saved in this file', argstr='--dict=%s'),
+           'dict_float': traits.Bool(desc='Store the dictionary as float32', argstr='--dict-float'),
+           'polish': traits.Int(desc='NLLS iterations after dictionary matching', argstr='--polish=%d'),
+           'telemetry': traits.String(desc='Write a JSON performance report', argstr='--telemetry=%s')},
+    sim_extra=MonteCarlo())
+
 
 MPMR2s, MPMR2sSim, MPMR2sFitIS, MPMR2sFitOS, MPMR2sSimIS, MPMR2sSimOS = Command(
     'MPMR2s', 'qi mpm_r2s', 'MPM',
@@ -277,7 +309,11 @@ qMT, qMTSim, qMTFitIS, qMTFitOS, qMTSimIS, qMTSimOS = Command(
     derived=['T1_f', 'k_bf'],
     fixed=['f0', 'B1', 'T1'],
     extra={'lineshape': traits.String(argstr='--lineshape=%s', mandatory=True,
-                                      desc='Gauss/Lorentzian/SuperLorentzian/path to JSON file')})
+                                      desc='Gauss/Lorentzian/SuperLorentzian/path to JSON file'),
+           'lm': traits.Bool(desc='Use the fixed-size LM solver instead of Ceres', argstr='--lm'),
+           'varpro': traits.Bool(desc='Eliminate M0_f with Variable Projection', argstr='--varpro'),
+           'warm': traits.Bool(desc='Start from already fitted neighbours', argstr='--warm'),
+           'telemetry': traits.String(desc='Write a JSON performance report', argstr='--telemetry=%s')})
 
 eMT, eMTSim, eMTFitIS, eMTFitOS, eMTSimIS, eMTSimOS = Command(
     'eMT', 'qi ssfp_emt', 'EMT',
@@ -349,7 +385,9 @@ ASE, ASESim, ASEFitIS, ASEFitOS, ASESimIS, ASESimOS = Command(
     varying=['S0', 'dT', 'R2p'],
     derived=['Tc', 'OEF', 'dHb'],
     extra={'B0': traits.Float(desc='Field-strength (Tesla), default 3', argstr='--B0=%f'),
-           'fix_DBV': traits.Float(desc='Fix Deoxygenated Blood Volume to value (fraction)', argstr='--DBV=%f', mandatory=True)}
+           'fix_DBV': traits.Float(desc='Fix Deoxygenated Blood Volume to value (fraction)', argstr='--DBV=%f', mandatory=True),
+           'quadrature': traits.Bool(desc='Integrate fc directly instead of using the table', argstr='--quadrature'),
+           'varpro': traits.Bool(desc='Eliminate S0 with Variable Projection', argstr='--varpro')}
 )
 
 ASEDBV, ASEDBVSim, ASEDBVFitIS, ASEDBVFitOS, ASEDBVSimIS, ASEDBVSimOS = Command(
@@ -357,7 +395,9 @@ ASEDBV, ASEDBVSim, ASEDBVFitIS, ASEDBVFitOS, ASEDBVSimIS, ASEDBVSimOS = Command(
     varying=['S0', 'dT', 'R2p', 'DBV'],
     derived=['Tc', 'OEF', 'dHb'],
     extra={'B0': traits.Float(
-        desc='Field-strength (Tesla), default 3', argstr='--B0=%f')}
+        desc='Field-strength (Tesla), default 3', argstr='--B0=%f'),
+        'quadrature': traits.Bool(desc='Integrate fc directly instead of using the table', argstr='--quadrature'),
+        'varpro': traits.Bool(desc='Eliminate S0 with Variable Projection', argstr='--varpro')}
 )
 
 
@@ -170,8 +170,8 @@ class AffineInputSpec(base.InputSpec):
                    position=0, desc='Source File')
 
     # Outputs
-    out_file = File(exists=False, argstr='%s', mandatory=True,
-                    position=1, desc='Destination File')
+    out_file = File(exists=False, argstr='%s',
+                    position=1, desc='Destination File, default is to overwrite Source')
 
     # Options
     xfm_file = File(exists=False, argstr='--tfm=%s',
@@ -213,7 +213,10 @@ class Affine(CommandLine):
 
     def _list_outputs(self):
         outputs = self.output_spec().get()
-        outputs['out_file'] = path.abspath(self.inputs.out_file)
+        if isdefined(self.inputs.out_file):
+            outputs['out_file'] = path.abspath(self.inputs.out_file)
+        else:
+            outputs['out_file'] = path.abspath(self.inputs.in_file)
         return outputs
 
 ############################ qimask ############################
@@ -71,6 +71,15 @@ extern args::Group    global_group;
 extern args::HelpFlag help;
 extern args::Flag     verbose;
 
+#define QI_SIMULATE_ARGS                                                                       \
+    args::ValueFlag<float> simulate(                                                           \
+        parser, "SIMULATE", "Simulate sequence (argument is noise level)", {"simulate"}, 0.0); \
+    args::ValueFlag<uint64_t> seed(parser,                                                     \
+                                   "SEED",                                                     \
+                                   "With --simulate, seed for the noise (default random)",     \
+                                   {"seed"},                                                   \
+                                   QI::RandomSeed());
+
 #define QI_COMMON_ARGS                                                                         \
     args::Flag resids(parser, "RESIDS", "Write point residuals", {'r', "resids"});             \
     args::Flag covar(                                                                          \
@@ -81,8 +90,7 @@ extern args::Flag     verbose;
                                  "Use N threads (default=hardware limit or $QUIT_THREADS)",  \
                                    {'T', "threads"},                                           \
                                  QI::GetDefaultThreads());                                   \
-    args::ValueFlag<float> simulate(                                                           \
-        parser, "SIMULATE", "Simulate sequence (argument is noise level)", {"simulate"}, 0.0); \
+    QI_SIMULATE_ARGS                                                                           \
     args::ValueFlag<std::string> mask(                                                         \
         parser, "MASK", "Only process voxels within the given mask", {'m', "mask"});           \
     args::ValueFlag<std::string> subregion(                                                    \
@@ -94,3 +102,38 @@ extern args::Flag     verbose;
         parser, "PREFIX", "Add a prefix to output filenames", {'o', "out"});                   \
     args::ValueFlag<std::string> json_file(                                                    \
         parser, "JSON", "Read JSON from file instead of stdin", {"json"});
+
+#define QI_CHECKPOINT_ARGS                                                                     \
+    args::ValueFlag<std::string> checkpoint(parser,                                            \
+                                            "CHECKPOINT",                                      \
+                                            "Periodically save finished voxels to this file",  \
+                                            {"checkpoint"});                                   \
+    args::ValueFlag<double> checkpoint_interval(parser,                                        \
+                                                "SECONDS",                                     \
+                                                "Seconds between checkpoints, default 600",    \
+                                                {"checkpoint-interval"},                       \
+                                                600.);                                         \
+    args::Flag resume(                                                                         \
+        parser, "RESUME", "Resume from the file given with --checkpoint", {"resume"});
+
+#define QI_SLAB_ARG                                                                            \
+    args::ValueFlag<int> slab(                                                                 \
+        parser, "SLICES", "Process the image in slabs of N slices to save memory", {"slab"});
+
+#define QI_TELEMETRY_ARG                                                                       \
+    args::ValueFlag<std::string> telemetry(                                                    \
+        parser,                                                                                \
+        "TELEMETRY",                                                                           \
+        "Write a solve-time image and a JSON performance report to this file",                 \
+        {"telemetry"});
+
+#define QI_MONTECARLO_ARG                                                                      \
+    args::ValueFlag<int> montecarlo(                                                           \
+        parser,                                                                                \
+        "N",                                                                                   \
+        "With --simulate, fit N noisy realisations in memory and write mean/SD/bias maps",     \
+        {"montecarlo"});
+
+#define QI_VARPRO_ARG                                                                          \
+    args::Flag varpro(                                                                         \
+        parser, "VARPRO", "Eliminate the amplitude parameter (Variable Projection)", {"varpro"});
@@ -0,0 +1,182 @@
+/*
+ *  Checkpoint.cpp
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "Checkpoint.h"
+#include "Log.h"
+
+namespace QI {
+
+namespace {
+/*
+ *  File layout is the magic string, then the number of voxels, the number of buffers and the bytes
+ *  per voxel of each buffer (all uint64_t), then the done flags packed into bits, then each buffer
+ *  in turn. Voxels that were not done are written as zeros.
+ */
+char const   CheckpointMagic[8] = {'Q', 'I', 'C', 'K', 'P', 'T', '0', '1'};
+size_t const StagingVoxels      = 4096; // Voxels copied per fwrite
+} // namespace
+
+Checkpoint::Checkpoint(std::string const &path,
+                       size_t const       nvoxels,
+                       double const       interval_seconds,
+                       bool const         verbose) :
+    m_path(path),
+    m_nvoxels(nvoxels), m_interval(interval_seconds), m_verbose(verbose), m_done(nvoxels) {
+    if (interval_seconds <= 0) {
+        QI::Fail("Checkpoint interval must be positive, was {}", interval_seconds);
+    }
+}
+
+Checkpoint::~Checkpoint() {
+    stop();
+}
+
+void Checkpoint::addBuffer(void *data, size_t const bytes_per_voxel) {
+    m_buffers.push_back({static_cast<char *>(data), bytes_per_voxel});
+}
+
+size_t Checkpoint::load() {
+    FILE *file = std::fopen(m_path.c_str(), "rb");
+    if (!file) {
+        Info(m_verbose, "No checkpoint found at {}, starting from scratch", m_path);
+        return 0;
+    }
+    auto const read = [&](void *dst, size_t const bytes) {
+        if (std::fread(dst, 1, bytes, file) != bytes) {
+            QI::Fail("Could not read checkpoint {}, file is truncated", m_path);
+        }
+    };
+    char magic[8];
+    read(magic, sizeof(magic));
+    if (std::memcmp(magic, CheckpointMagic, sizeof(magic)) != 0) {
+        QI::Fail("{} is not a checkpoint file", m_path);
+    }
+    uint64_t nvoxels, nbuffers;
+    read(&nvoxels, sizeof(nvoxels));
+    read(&nbuffers, sizeof(nbuffers));
+    bool matches = (nvoxels == m_nvoxels) && (nbuffers == m_buffers.size());
+    for (size_t b = 0; matches && b < m_buffers.size(); b++) {
+        uint64_t bytes;
+        read(&bytes, sizeof(bytes));
+        matches = (bytes == m_buffers[b].bytes_per_voxel);
+    }
+    if (!matches) {
+        QI::Fail("Checkpoint {} was written by a different fit or for different images", m_path);
+    }
+
+    std::vector<uint8_t> bits((m_nvoxels + 7) / 8);
+    read(bits.data(), bits.size());
+    size_t ndone = 0;
+    for (size_t v = 0; v < m_nvoxels; v++) {
+        uint8_t const d = (bits[v / 8] >> (v % 8)) & 1;
+        m_done[v].store(d, std::memory_order_relaxed);
+        ndone += d;
+    }
+    for (auto const &b : m_buffers) {
+        read(b.data, m_nvoxels * b.bytes_per_voxel);
+    }
+    std::fclose(file);
+    Info(m_verbose, "Resuming from {}, {} voxels already done", m_path, ndone);
+    return ndone;
+}
+
+void Checkpoint::start() {
+    m_stop   = false;
+    m_writer = std::thread(&Checkpoint::run, this);
+}
+
+void Checkpoint::stop() {
+    if (m_writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        m_writer.join();
+    }
+}
+
+void Checkpoint::remove() {
+    std::remove(m_path.c_str());
+}
+
+void Checkpoint::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_wake.wait_for(lock, m_interval, [this] { return m_stop; })) {
+        lock.unlock();
+        write();
+        lock.lock();
+    }
+}
+
+void Checkpoint::write() {
+    auto const begin = std::chrono::steady_clock::now();
+    // Snapshot the flags first. Voxels finished after this point are left for the next write, so
+    // only buffer entries that no worker will touch again are read.
+    std::vector<uint8_t> bits((m_nvoxels + 7) / 8, 0);
+    size_t               ndone = 0;
+    for (size_t v = 0; v < m_nvoxels; v++) {
+        if (m_done[v].load(std::memory_order_acquire)) {
+            bits[v / 8] |= (1 << (v % 8));
+            ndone++;
+        }
+    }
+
+    std::string const tmp_path = m_path + ".tmp";
+    FILE *            file     = std::fopen(tmp_path.c_str(), "wb");
+    if (!file) {
+        QI::Warn("Could not open {} to write checkpoint", tmp_path);
+        return;
+    }
+    bool       ok    = true;
+    auto const put   = [&](void const *src, size_t const bytes) {
+        ok = ok && (std::fwrite(src, 1, bytes, file) == bytes);
+    };
+    uint64_t const nvoxels = m_nvoxels, nbuffers = m_buffers.size();
+    put(CheckpointMagic, sizeof(CheckpointMagic));
+    put(&nvoxels, sizeof(nvoxels));
+    put(&nbuffers, sizeof(nbuffers));
+    for (auto const &b : m_buffers) {
+        uint64_t const bytes = b.bytes_per_voxel;
+        put(&bytes, sizeof(bytes));
+    }
+    put(bits.data(), bits.size());
+    std::vector<char> staging;
+    for (auto const &b : m_buffers) {
+        staging.resize(StagingVoxels * b.bytes_per_voxel);
+        for (size_t start = 0; start < m_nvoxels; start += StagingVoxels) {
+            size_t const n = std::min(StagingVoxels, m_nvoxels - start);
+            for (size_t v = 0; v < n; v++) {
+                char *const dst = staging.data() + v * b.bytes_per_voxel;
+                if ((bits[(start + v) / 8] >> ((start + v) % 8)) & 1) {
+                    std::memcpy(dst, b.data + (start + v) * b.bytes_per_voxel, b.bytes_per_voxel);
+                } else {
+                    std::memset(dst, 0, b.bytes_per_voxel);
+                }
+            }
+            put(staging.data(), n * b.bytes_per_voxel);
+        }
+    }
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok || std::rename(tmp_path.c_str(), m_path.c_str()) != 0) {
+        QI::Warn("Failed to write checkpoint {}", m_path);
+        return;
+    }
+    auto const seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    Info(m_verbose, "Wrote checkpoint of {} voxels to {} in {:.1f} s", ndone, m_path, seconds);
+}
+
+} // namespace QI
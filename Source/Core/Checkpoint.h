@@ -0,0 +1,87 @@
+/*
+ *  Checkpoint.h
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace QI {
+
+/*
+ *  Periodically saves the partial results of a long fit so that it can be resumed. The checkpoint
+ *  refers to a set of output buffers, all indexed by the same voxel offset, plus a flag per voxel
+ *  that workers set once that voxel's outputs are final. A background thread snapshots the flags
+ *  and copies only the finished voxels, so workers never wait for it. Each write goes to a
+ *  temporary file that is then renamed over the old checkpoint, so a job killed mid-write still
+ *  leaves the previous checkpoint intact.
+ */
+class Checkpoint {
+  public:
+    Checkpoint(std::string const &path,
+               size_t const       nvoxels,
+               double const       interval_seconds,
+               bool const         verbose);
+    ~Checkpoint();
+
+    Checkpoint(Checkpoint const &) = delete;
+    Checkpoint &operator=(Checkpoint const &) = delete;
+
+    /*
+     *  Register an output buffer holding nvoxels pixels of bytes_per_voxel each. All buffers must
+     *  be added before load() or start().
+     */
+    void addBuffer(void *data, size_t const bytes_per_voxel);
+
+    /*
+     *  Restore the finished voxels and their outputs from an existing checkpoint. Returns the
+     *  number of finished voxels, which is zero if there was no checkpoint file.
+     */
+    size_t load();
+
+    void start();  // Start the background writer
+    void stop();   // Stop the background writer, without a final write
+    void remove(); // Delete the checkpoint file, once the outputs are safely written
+
+    // Call after all outputs for the voxel at this buffer offset have been written
+    void markDone(int64_t const offset) { m_done[offset].store(1, std::memory_order_release); }
+    bool done(int64_t const offset) const {
+        return m_done[offset].load(std::memory_order_acquire);
+    }
+
+  protected:
+    struct Buffer {
+        char * data;
+        size_t bytes_per_voxel;
+    };
+
+    void write();
+    void run();
+
+    std::string                       m_path;
+    size_t                            m_nvoxels;
+    std::chrono::duration<double>     m_interval;
+    bool                              m_verbose;
+    std::vector<Buffer>               m_buffers;
+    std::vector<std::atomic<uint8_t>> m_done;
+    std::thread                       m_writer;
+    std::mutex                        m_mutex;
+    std::condition_variable           m_wake;
+    bool                              m_stop = false;
+};
+
+} // namespace QI
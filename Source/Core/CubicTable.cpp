@@ -0,0 +1,19 @@
+/*
+ *  CubicTable.cpp
+ *
+ *  Copyright (c) 2016 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include "CubicTable.h"
+
+namespace QI {
+
+CubicTable::CubicTable(const Eigen::ArrayXd &vals) :
+    values{vals}, grid{values.data(), 0, static_cast<int>(values.rows())}, interpolator{grid} {}
+
+} // End namespace QI
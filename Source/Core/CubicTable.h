@@ -0,0 +1,46 @@
+/*
+ *  CubicTable.h
+ *
+ *  Copyright (c) 2016 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#ifndef QI_CUBICTABLE_H
+#define QI_CUBICTABLE_H
+
+#include "ceres/cubic_interpolation.h"
+#include <Eigen/Core>
+
+namespace QI {
+
+/*
+ *  Uniformly spaced samples with cubic interpolation, which also works with Jets. The ceres grid
+ *  and interpolator point into the samples, so tables cannot be copied and are shared instead.
+ */
+class CubicTable {
+  public:
+    CubicTable(const Eigen::ArrayXd &vals);
+    CubicTable(const CubicTable &) = delete;
+    CubicTable &operator=(const CubicTable &) = delete;
+
+    const Eigen::ArrayXd values;
+
+    // i is a fractional index into values
+    template <typename T> T Evaluate(const T &i) const {
+        T val;
+        interpolator.Evaluate(i, &val);
+        return val;
+    }
+
+  private:
+    const ceres::Grid1D<double>                           grid;
+    const ceres::CubicInterpolator<ceres::Grid1D<double>> interpolator;
+};
+
+} // End namespace QI
+
+#endif // QI_CUBICTABLE_H
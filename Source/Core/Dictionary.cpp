@@ -0,0 +1,89 @@
+/*
+ *  Dictionary.cpp
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "Dictionary.h"
+#include "Log.h"
+
+namespace QI {
+
+double DictionaryAxis::value(double const i) const {
+    if (steps < 2) {
+        return start;
+    }
+    double const f = i / (steps - 1);
+    if (log) {
+        return start * std::pow(stop / start, f);
+    } else {
+        return start + f * (stop - start);
+    }
+}
+
+int DictionaryAxis::nearest(double const v) const {
+    if (steps < 2) {
+        return 0;
+    }
+    double const f = log ? std::log(v / start) / std::log(stop / start) : (v - start) / (stop - start);
+    if (!std::isfinite(f)) {
+        return 0;
+    }
+    return std::clamp(static_cast<int>(std::lround(f * (steps - 1))), 0, steps - 1);
+}
+
+namespace {
+DictionaryAxis ReadAxis(json const &j, std::string const &name, int const index, bool const fixed) {
+    DictionaryAxis axis{name, index, fixed};
+    if (j.is_number()) {
+        axis.start = axis.stop = j.get<double>();
+        axis.steps             = 1;
+    } else if (j.is_array() && j.size() == 3) {
+        axis.start = j[0].get<double>();
+        axis.stop  = j[1].get<double>();
+        axis.steps = j[2].get<int>();
+    } else if (j.is_object()) {
+        GetJSON(j, "start", axis.start);
+        GetJSON(j, "stop", axis.stop);
+        GetJSON(j, "steps", axis.steps);
+        axis.log = j.value("log", false);
+    } else {
+        QI::Fail("Dictionary entry for {} must be a value, [start, stop, steps] or an object", name);
+    }
+    if (axis.steps < 1) {
+        QI::Fail("Dictionary entry for {} must have at least one step", name);
+    }
+    if (axis.log && (axis.start <= 0 || axis.stop <= 0)) {
+        QI::Fail("Dictionary entry for {} is log-spaced so must be positive", name);
+    }
+    return axis;
+}
+} // namespace
+
+std::vector<DictionaryAxis> ReadDictionaryAxes(json const &                    grid,
+                                               std::vector<std::string> const &varying,
+                                               std::vector<std::string> const &fixed) {
+    std::vector<DictionaryAxis> axes;
+    for (size_t i = 0; i < fixed.size(); i++) {
+        if (grid.contains(fixed[i])) {
+            axes.push_back(ReadAxis(grid[fixed[i]], fixed[i], i, true));
+        }
+    }
+    for (size_t i = 1; i < varying.size(); i++) {
+        if (!grid.contains(varying[i])) {
+            QI::Fail("Dictionary needs a value or range for {}", varying[i]);
+        }
+        axes.push_back(ReadAxis(grid[varying[i]], varying[i], i, false));
+    }
+    return axes;
+}
+
+} // namespace QI
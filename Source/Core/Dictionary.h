@@ -0,0 +1,370 @@
+/*
+ *  Dictionary.h
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "JSON.h"
+#include "Log.h"
+#include "itkMultiThreaderBase.h"
+
+namespace QI {
+
+/*
+ *  One parameter of a dictionary. A constant is an axis with a single step. Values are evenly
+ *  spaced, or evenly spaced in log(value) if log is set.
+ */
+struct DictionaryAxis {
+    std::string name;
+    int         index; // Position in the model's varying or fixed array
+    bool        fixed; // Fixed parameter rather than varying
+    double      start = 0, stop = 0;
+    int         steps = 1;
+    bool        log   = false;
+
+    double value(double const i) const;   // Value at a (fractional) step
+    int    nearest(double const v) const; // Closest step to a value
+};
+
+/*
+ *  Read the grid from JSON such as
+ *      {"T1": [0.5, 3.0, 40], "T2": {"start": 0.01, "stop": 0.3, "steps": 30, "log": true}}
+ *  Every varying parameter except the first, which is the amplitude, needs a range or a constant
+ *  value. Fixed parameters may also be given a range, otherwise the dictionary is built at their
+ *  defaults. Fixed axes come first in the result.
+ */
+std::vector<DictionaryAxis> ReadDictionaryAxes(json const &                    grid,
+                                               std::vector<std::string> const &varying,
+                                               std::vector<std::string> const &fixed);
+
+/*
+ *  All the inputs of a model as one signal
+ */
+template <typename ModelType>
+Eigen::ArrayXd DictionarySignal(ModelType const &                       model,
+                                typename ModelType::VaryingArray const &varying,
+                                typename ModelType::FixedArray const &  fixed) {
+    if constexpr (ModelType::NI > 1) {
+        auto const  signals = model.signals(varying, fixed);
+        Eigen::Index rows   = 0;
+        for (auto const &s : signals) {
+            rows += s.rows();
+        }
+        Eigen::ArrayXd all(rows);
+        rows = 0;
+        for (auto const &s : signals) {
+            all.segment(rows, s.rows()) = s;
+            rows += s.rows();
+        }
+        return all;
+    } else {
+        return model.signal(varying, fixed);
+    }
+}
+
+/*
+ *  Signals of a model on a grid of parameters, each normalised to unit length and stored as one
+ *  column of a contiguous matrix. The amplitude (first varying parameter) is not part of the grid
+ *  because it drops out of the normalised inner product. Atoms are ordered with the fixed axes
+ *  outermost, so all the atoms for one combination of fixed parameters form a contiguous block.
+ *  Scalar can be float to halve the memory and double the matching speed.
+ */
+template <typename ModelType, typename Scalar = double> class Dictionary {
+  public:
+    static_assert(std::is_floating_point_v<typename ModelType::DataType>,
+                  "Dictionaries only support real-valued models");
+    using VaryingArray = typename ModelType::VaryingArray;
+    using FixedArray   = typename ModelType::FixedArray;
+    using AtomMatrix   = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+    using AtomVector   = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+
+    /*
+     *  Read the dictionary from path if that exists, otherwise build it and save it to path (unless
+     *  path is empty). The key must contain everything the signals depend on, typically the
+     *  sequence and the grid. A saved dictionary is only used if its key matches, otherwise it is
+     *  rebuilt and the file overwritten.
+     */
+    Dictionary(ModelType const &  model,
+               json const &       grid,
+               json const &       key,
+               std::string const &path,
+               int const          threads,
+               bool const         verbose) :
+        m_axes(ReadDictionaryAxes(grid,
+                                  {model.varying_names.begin(), model.varying_names.end()},
+                                  {model.fixed_names.begin(), model.fixed_names.end()})),
+        m_key(key.dump()) {
+        m_strides.resize(m_axes.size());
+        long stride = 1;
+        for (int k = static_cast<int>(m_axes.size()) - 1; k >= 0; k--) {
+            m_strides[k] = stride;
+            stride *= m_axes[k].steps;
+            if (!m_axes[k].fixed) {
+                m_blockSize *= m_axes[k].steps;
+            }
+        }
+        m_natoms = stride;
+        if constexpr (ModelType::NF > 0) {
+            m_fixedDefaults = model.fixed_defaults;
+        }
+        m_constants    = VaryingArray::Zero();
+        m_constants[0] = 1.0;
+        for (auto const &a : m_axes) {
+            if (!a.fixed) {
+                m_constants[a.index] = a.start;
+            }
+        }
+        if (path != "" && read(path, verbose)) {
+            return;
+        }
+        build(model, threads, verbose);
+        if (path != "") {
+            write(path, verbose);
+        }
+    }
+
+    Eigen::Index                       rows() const { return m_atoms.rows(); }
+    long                               atoms() const { return m_natoms; }
+    std::vector<long> const &          inputSizes() const { return m_inputSizes; }
+    std::vector<DictionaryAxis> const &axes() const { return m_axes; }
+    VaryingArray const &constants() const { return m_constants; } // Amplitude 1, constant axes set
+    double norm(long const atom) const { return m_norms[atom]; } // Of the signal before normalising
+
+    // The block of atoms whose fixed parameters are closest to these
+    long block(FixedArray const &fixed) const {
+        long b = 0;
+        for (size_t k = 0; k < m_axes.size(); k++) {
+            if (m_axes[k].fixed) {
+                b += m_axes[k].nearest(fixed[m_axes[k].index]) * m_strides[k];
+            }
+        }
+        return b / m_blockSize;
+    }
+
+    // The parameters of an atom, with unit amplitude
+    void parameters(long const atom, VaryingArray &varying, FixedArray &fixed) const {
+        varying = m_constants;
+        if constexpr (ModelType::NF > 0) {
+            fixed = m_fixedDefaults;
+        }
+        for (size_t k = 0; k < m_axes.size(); k++) {
+            auto const & a = m_axes[k];
+            double const v = a.value((atom / m_strides[k]) % a.steps);
+            if (a.fixed) {
+                fixed[a.index] = v;
+            } else {
+                varying[a.index] = v;
+            }
+        }
+    }
+
+    /*
+     *  Find the atom in a block with the largest inner product with each column of data. Atoms are
+     *  processed a chunk at a time so the scores for a whole tile of voxels stay small.
+     */
+    void match(AtomMatrix const &data, long const block, long *best, Scalar *score) const {
+        thread_local AtomMatrix scores;
+        long const              first = block * m_blockSize;
+        for (Eigen::Index j = 0; j < data.cols(); j++) {
+            best[j]  = first;
+            score[j] = -std::numeric_limits<Scalar>::infinity();
+        }
+        for (long start = 0; start < m_blockSize; start += MatchChunk) {
+            long const n = std::min(MatchChunk, m_blockSize - start);
+            scores.noalias() = m_atoms.middleCols(first + start, n).transpose() * data;
+            for (Eigen::Index j = 0; j < data.cols(); j++) {
+                Eigen::Index i;
+                Scalar const s = scores.col(j).maxCoeff(&i);
+                if (s > score[j]) {
+                    score[j] = s;
+                    best[j]  = first + start + i;
+                }
+            }
+        }
+    }
+
+    /*
+     *  Varying parameters of the best atom, moved along each varying axis to the peak of a parabola
+     *  through the scores of that atom and its two neighbours
+     */
+    VaryingArray refine(long const atom, Eigen::Ref<AtomVector const> const &data) const {
+        VaryingArray varying;
+        FixedArray   fixed;
+        parameters(atom, varying, fixed);
+        double const s0 = m_atoms.col(atom).dot(data);
+        for (size_t k = 0; k < m_axes.size(); k++) {
+            auto const &a = m_axes[k];
+            long const  i = (atom / m_strides[k]) % a.steps;
+            if (a.fixed || i == 0 || i == a.steps - 1) {
+                continue;
+            }
+            double const sm    = m_atoms.col(atom - m_strides[k]).dot(data);
+            double const sp    = m_atoms.col(atom + m_strides[k]).dot(data);
+            double const denom = sm - 2 * s0 + sp;
+            if (denom < 0) {
+                double const delta = std::clamp(0.5 * (sm - sp) / denom, -0.5, 0.5);
+                varying[a.index]   = a.value(i + delta);
+            }
+        }
+        return varying;
+    }
+
+  protected:
+    static constexpr long MatchChunk = 2048;
+
+    void build(ModelType const &model, int const threads, bool const verbose) {
+        Info(verbose, "Building dictionary of {} atoms", m_natoms);
+        VaryingArray v;
+        FixedArray   f;
+        parameters(0, v, f);
+        if constexpr (ModelType::NI > 1) {
+            for (auto const &s : model.signals(v, f)) {
+                m_inputSizes.push_back(s.rows());
+            }
+        } else {
+            m_inputSizes.push_back(model.signal(v, f).rows());
+        }
+        long rows = 0;
+        for (auto const &s : m_inputSizes) {
+            rows += s;
+        }
+        m_atoms.resize(rows, m_natoms);
+        m_norms.resize(m_natoms);
+        auto threader = itk::MultiThreaderBase::New();
+        threader->SetNumberOfWorkUnits(threads);
+        threader->ParallelizeArray(
+            0,
+            m_natoms,
+            [&](itk::SizeValueType const atom) {
+                VaryingArray varying;
+                FixedArray   fixed;
+                parameters(atom, varying, fixed);
+                Eigen::ArrayXd const s    = DictionarySignal(model, varying, fixed);
+                double const         norm = s.matrix().norm();
+                m_norms[atom]             = norm;
+                if (norm > 0 && std::isfinite(norm)) {
+                    m_atoms.col(atom) = (s / norm).matrix().template cast<Scalar>();
+                } else {
+                    m_atoms.col(atom).setZero();
+                }
+            },
+            nullptr);
+    }
+
+    /*
+     *  File layout is the magic string, then the key length, the key, the scalar size, the number
+     *  of inputs and their sizes, and the number of atoms (all uint64_t except the key), then the
+     *  norms as doubles and the atoms as Scalar in column order.
+     */
+    static constexpr char Magic[8] = {'Q', 'I', 'D', 'I', 'C', 'T', '0', '1'};
+
+    bool read(std::string const &path, bool const verbose) {
+        FILE *file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+        auto const get = [&](void *dst, size_t const bytes) {
+            if (std::fread(dst, 1, bytes, file) != bytes) {
+                QI::Fail("Could not read dictionary {}, file is truncated", path);
+            }
+        };
+        auto const get_u64 = [&]() {
+            uint64_t v;
+            get(&v, sizeof(v));
+            return v;
+        };
+        char magic[8];
+        get(magic, sizeof(magic));
+        if (std::memcmp(magic, Magic, sizeof(magic)) != 0) {
+            QI::Fail("{} is not a dictionary file", path);
+        }
+        std::string key(get_u64(), '\0');
+        get(key.data(), key.size());
+        if (key != m_key || get_u64() != sizeof(Scalar)) {
+            std::fclose(file);
+            Info(verbose, "Dictionary {} is for a different sequence, grid or precision", path);
+            return false;
+        }
+        m_inputSizes.resize(get_u64());
+        long rows = 0;
+        for (auto &s : m_inputSizes) {
+            s = get_u64();
+            rows += s;
+        }
+        if (static_cast<long>(get_u64()) != m_natoms) {
+            QI::Fail("Dictionary {} has the wrong number of atoms", path);
+        }
+        m_norms.resize(m_natoms);
+        m_atoms.resize(rows, m_natoms);
+        get(m_norms.data(), m_natoms * sizeof(double));
+        get(m_atoms.data(), m_atoms.size() * sizeof(Scalar));
+        std::fclose(file);
+        Info(verbose, "Read dictionary of {} atoms from {}", m_natoms, path);
+        return true;
+    }
+
+    void write(std::string const &path, bool const verbose) const {
+        // Write then rename, so a crash or another run never sees a half-written dictionary
+        auto const tmp_path = path + ".tmp";
+        FILE *     file     = std::fopen(tmp_path.c_str(), "wb");
+        if (!file) {
+            QI::Fail("Could not open {} to write dictionary", tmp_path);
+        }
+        bool       ok      = true;
+        auto const put     = [&](void const *src, size_t const bytes) {
+            ok = ok && (std::fwrite(src, 1, bytes, file) == bytes);
+        };
+        auto const put_u64 = [&](uint64_t const v) { put(&v, sizeof(v)); };
+        put(Magic, sizeof(Magic));
+        put_u64(m_key.size());
+        put(m_key.data(), m_key.size());
+        put_u64(sizeof(Scalar));
+        put_u64(m_inputSizes.size());
+        for (auto const s : m_inputSizes) {
+            put_u64(s);
+        }
+        put_u64(m_natoms);
+        put(m_norms.data(), m_natoms * sizeof(double));
+        put(m_atoms.data(), m_atoms.size() * sizeof(Scalar));
+        ok = (std::fclose(file) == 0) && ok;
+        if (!ok) {
+            std::remove(tmp_path.c_str());
+            QI::Fail("Failed to write dictionary {}", path);
+        }
+        if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            std::remove(tmp_path.c_str());
+            QI::Fail("Failed to move dictionary into place at {}", path);
+        }
+        Info(verbose, "Wrote dictionary to {}", path);
+    }
+
+    std::vector<DictionaryAxis> m_axes;
+    std::vector<long>           m_strides;
+    std::string                 m_key;
+    long                        m_natoms = 0, m_blockSize = 1;
+    std::vector<long>           m_inputSizes;
+    VaryingArray                m_constants;
+    FixedArray                  m_fixedDefaults;
+    Eigen::ArrayXd              m_norms;
+    AtomMatrix                  m_atoms;
+};
+
+} // namespace QI
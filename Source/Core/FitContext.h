@@ -0,0 +1,89 @@
+/*
+ *  FitContext.h - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "Macro.h"
+#include "Model.h"
+#include "ceres/ceres.h"
+
+namespace QI {
+
+/*
+ *  Unique tag for a fit object. Copies get a fresh tag, because any Ceres setup cached against the
+ *  original refers to the original's model.
+ */
+struct FitContextId {
+    size_t const id = Next();
+
+    FitContextId() = default;
+    FitContextId(FitContextId const &) : id{Next()} {}
+    FitContextId &operator=(FitContextId const &) = delete;
+
+    static size_t Next() {
+        static std::atomic<size_t> counter{1};
+        return counter++;
+    }
+};
+
+/*
+ *  Setting up a ceres::Problem (cost function, loss function, bounds) costs about as much as
+ *  solving the small problems found in most voxels. A FitContext keeps all of that for one thread
+ *  and one fit object, and between voxels only the data, fixed parameters and start point change.
+ *  The cost function refers to data and fixed by reference, so they must be assigned in place.
+ */
+template <typename ModelType> struct FitContext {
+    size_t                                 id = 0;
+    QI_ARRAY(typename ModelType::DataType) data;
+    typename ModelType::FixedArray         fixed;
+    typename ModelType::VaryingArray       varying;
+    std::unique_ptr<ceres::Problem>        problem;
+};
+
+/*
+ *  Return the calling thread's context for the fit object tagged with id, building the problem
+ *  with setup(context) the first time it is requested. Each call site has its own context because
+ *  the setup lambda type is unique.
+ */
+template <typename ModelType, typename Setup>
+FitContext<ModelType> &ThreadFitContext(FitContextId const &tag, Setup &&setup) {
+    thread_local FitContext<ModelType> context;
+    if (context.id != tag.id) {
+        context.problem = std::make_unique<ceres::Problem>();
+        context.id      = tag.id;
+        setup(context);
+    }
+    return context;
+}
+
+/*
+ *  As ModelCost, but referring to data and fixed parameters owned by a FitContext so that the
+ *  same cost function can be re-used for every voxel
+ */
+template <typename Model> struct ModelCostRef {
+    using FixedArray = typename Model::FixedArray;
+    using DataArray  = QI_ARRAY(typename Model::DataType);
+    const Model &     model;
+    const FixedArray &fixed;
+    const DataArray & data;
+
+    template <typename T> bool operator()(const T *const vin, T *rin) const {
+        Eigen::Map<QI_ARRAYN(T, Model::NV) const> const v(vin);
+        Eigen::Map<QI_ARRAY(T)>                         residual(rin, data.rows());
+        residual = data - model.signal(v, fixed);
+        return true;
+    }
+};
+
+} // namespace QI
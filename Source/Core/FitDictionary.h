@@ -0,0 +1,260 @@
+/*
+ *  FitDictionary.h - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "Dictionary.h"
+#include "FitContext.h"
+#include "FitFunction.h"
+
+namespace QI {
+
+/*
+ *  Residuals of the model after eliminating the amplitude, as in VarProCost, for polishing a
+ *  dictionary match. Only the parameters with a range in the dictionary are read from p, so the
+ *  others (including the amplitude) have zero derivative and stay put.
+ */
+template <typename ModelType, typename Scalar> struct DictionaryPolishCost {
+    using FixedArray = typename ModelType::FixedArray;
+    using DataArray  = QI_ARRAY(typename ModelType::DataType);
+    ModelType const &                    model;
+    Dictionary<ModelType, Scalar> const &dictionary;
+    FixedArray const &                   fixed;
+    DataArray const &                    data;
+
+    bool operator()(double const *const p, double *r) const {
+        typename ModelType::VaryingArray v = dictionary.constants();
+        for (auto const &a : dictionary.axes()) {
+            if (!a.fixed && a.steps > 1) {
+                v[a.index] = p[a.index];
+            }
+        }
+        Eigen::ArrayXd const s  = DictionarySignal(model, v, fixed);
+        double const         gg = s.square().sum();
+        double const         A  = gg > 0 ? (s * data).sum() / gg : 0.;
+        Eigen::Map<Eigen::ArrayXd>(r, data.rows()) = data - A * s;
+        return true;
+    }
+};
+
+/*
+ *  Match each voxel to the closest atom of a Dictionary by normalised inner product, optionally
+ *  refine the parameters with a parabola through the neighbouring atoms, and optionally polish
+ *  with a few iterations of NLLS. The amplitude is always fitted by linear least-squares at the
+ *  final parameters. Set scale_to_mean if the model normalises each input to its mean.
+ *
+ *  ModelFitFilter calls tileStart() first, which matches a whole tile of voxels with one matrix
+ *  product per chunk of atoms, and then fit() for each voxel starting from its match.
+ */
+template <typename ModelType_, typename Scalar = double> struct DictionaryFit {
+    using ModelType             = ModelType_;
+    using InputType             = typename ModelType::DataType;
+    using OutputType            = typename ModelType::ParameterType;
+    using FlagType              = int; // Polish iterations
+    using RMSErrorType          = double;
+    using DictionaryType        = Dictionary<ModelType, Scalar>;
+    static const bool Blocked   = false;
+    static const bool Indexed   = false;
+    static const bool TileStart = true;
+
+    ModelType const       model;
+    DictionaryType const &dictionary;
+    bool                  refine        = true;
+    int                   polish        = 0; // Maximum NLLS iterations, 0 for none
+    bool                  scale_to_mean = false;
+    FitContextId          context;
+
+    long input_size(long const i) const { return dictionary.inputSizes()[i]; }
+
+    // Axes with a range of values, which polishing can move off the grid
+    static bool Polished(DictionaryAxis const &a) { return !a.fixed && a.steps > 1; }
+
+    // All inputs as one column, scaled like the model if needed
+    template <typename Input> void gather(Input const &input, Eigen::ArrayXd &data) const {
+        Eigen::Index row = 0;
+        for (size_t i = 0; i < dictionary.inputSizes().size(); i++) {
+            auto const n       = dictionary.inputSizes()[i];
+            auto       segment = data.segment(row, n);
+            segment            = input(i).template cast<double>();
+            if (scale_to_mean) {
+                segment /= segment.mean();
+            }
+            row += n;
+        }
+    }
+
+    /*
+     *  Match every voxel in a tile. Voxels are grouped by the dictionary block for their fixed
+     *  parameters, and each group is matched with one product per chunk of atoms.
+     */
+    template <typename DataBlock, typename ParamBlock>
+    void tileStart(std::vector<DataBlock> const &data,
+                   ParamBlock const &            fixed,
+                   int const                     count,
+                   ParamBlock &                  varying) const {
+        thread_local std::vector<std::pair<long, int>> order;
+        thread_local typename DictionaryType::AtomMatrix group;
+        thread_local std::vector<long>                  best;
+        thread_local std::vector<Scalar>                score;
+        thread_local Eigen::ArrayXd                     column;
+        order.resize(count);
+        for (int v = 0; v < count; v++) {
+            typename ModelType::FixedArray f;
+            if constexpr (ModelType::NF > 0) {
+                f = fixed.col(v).template cast<double>();
+            }
+            order[v] = {dictionary.block(f), v};
+        }
+        std::sort(order.begin(), order.end());
+        column.resize(dictionary.rows());
+        for (int begin = 0; begin < count;) {
+            int end = begin;
+            while (end < count && order[end].first == order[begin].first) {
+                end++;
+            }
+            int const n = end - begin;
+            group.resize(dictionary.rows(), n);
+            for (int j = 0; j < n; j++) {
+                gather([&](size_t i) { return data[i].col(order[begin + j].second); }, column);
+                group.col(j) = column.matrix().template cast<Scalar>();
+            }
+            best.resize(n);
+            score.resize(n);
+            dictionary.match(group, order[begin].first, best.data(), score.data());
+            for (int j = 0; j < n; j++) {
+                int const v    = order[begin + j].second;
+                varying.col(v) = refine ? dictionary.refine(best[j], group.col(j)) :
+                                          Parameters(best[j]);
+            }
+            begin = end;
+        }
+    }
+
+    FitReturnType fit(std::vector<QI_ARRAY(InputType)> const &inputs,
+                      typename ModelType::FixedArray const &  fixed,
+                      typename ModelType::VaryingArray &      varying,
+                      typename ModelType::DerivedArray &      derived,
+                      typename ModelType::CovarArray *        cov,
+                      RMSErrorType &                          rmse,
+                      std::vector<QI_ARRAY(InputType)> &      residuals,
+                      FlagType &                              iterations) const
+        requires(ModelType::ND > 0) {
+        auto const result = fit(inputs, fixed, varying, cov, rmse, residuals, iterations);
+        if (result.success) {
+            this->model.derived(varying, fixed, derived);
+        }
+        return result;
+    }
+
+    FitReturnType fit(std::vector<QI_ARRAY(InputType)> const &inputs,
+                      typename ModelType::FixedArray const &  fixed,
+                      typename ModelType::VaryingArray &      varying,
+                      typename ModelType::CovarArray * /* Unused */,
+                      RMSErrorType &                     rmse,
+                      std::vector<QI_ARRAY(InputType)> & residuals,
+                      FlagType &                         iterations) const {
+        thread_local Eigen::ArrayXd data;
+        data.resize(dictionary.rows());
+        gather([&](size_t i) { return inputs[i]; }, data);
+        if (!IsWarmStart(varying)) {
+            // Called outside ModelFitFilter, so tileStart() has not matched this voxel
+            typename DictionaryType::AtomMatrix const d = data.matrix().template cast<Scalar>();
+            long                                      best;
+            Scalar                                    score;
+            dictionary.match(d, dictionary.block(fixed), &best, &score);
+            varying = refine ? dictionary.refine(best, d.col(0)) : Parameters(best);
+        }
+        // Matches have unit amplitude, the amplitude is fitted once the other parameters are final
+        varying[0] = 1.0;
+
+        iterations       = 0;
+        auto const &axes = dictionary.axes();
+        if (polish > 0 && std::any_of(axes.begin(), axes.end(), Polished)) {
+            auto &ctx = QI::ThreadFitContext<ModelType>(context, [this](auto &c) {
+                using Cost = DictionaryPolishCost<ModelType, Scalar>;
+                using Diff = ceres::
+                    NumericDiffCostFunction<Cost, ceres::CENTRAL, ceres::DYNAMIC, ModelType::NV>;
+                auto *cost = new Diff(new Cost{this->model, this->dictionary, c.fixed, c.data},
+                                      ceres::TAKE_OWNERSHIP,
+                                      this->dictionary.rows());
+                c.problem->AddResidualBlock(cost, nullptr, c.varying.data());
+                // Only the axes with a range move, the rest stay out of the solve
+                std::vector<int> constant;
+                for (int i = 0; i < ModelType::NV; i++) {
+                    constant.push_back(i);
+                }
+                for (auto const &a : this->dictionary.axes()) {
+                    if (Polished(a)) {
+                        constant.erase(std::find(constant.begin(), constant.end(), a.index));
+                    }
+                }
+                if (constant.size() > 0) {
+                    c.problem->SetManifold(c.varying.data(),
+                                           new ceres::SubsetManifold(ModelType::NV, constant));
+                }
+                for (auto const &a : this->dictionary.axes()) {
+                    if (Polished(a)) {
+                        c.problem->SetParameterLowerBound(
+                            c.varying.data(), a.index, std::min(a.start, a.stop));
+                        c.problem->SetParameterUpperBound(
+                            c.varying.data(), a.index, std::max(a.start, a.stop));
+                    }
+                }
+            });
+            ctx.data    = data;
+            ctx.fixed   = fixed;
+            ctx.varying = varying;
+            ceres::Solver::Options options;
+            ceres::Solver::Summary summary;
+            options.max_num_iterations  = polish;
+            options.function_tolerance  = 1e-6;
+            options.gradient_tolerance  = 1e-7;
+            options.parameter_tolerance = 1e-5;
+            options.logging_type        = ceres::SILENT;
+            ceres::Solve(options, ctx.problem.get(), &summary);
+            if (summary.IsSolutionUsable()) {
+                varying    = ctx.varying;
+                iterations = summary.iterations.size();
+            }
+        }
+
+        Eigen::ArrayXd const s  = DictionarySignal(model, varying, fixed);
+        double const         gg = s.square().sum();
+        if (!(gg > 0)) {
+            varying.setZero();
+            rmse = 0;
+            return {false, "Model signal was zero at the dictionary match"};
+        }
+        varying[0]              = (s * data).sum() / gg;
+        Eigen::ArrayXd const rs = data - varying[0] * s;
+        rmse                    = sqrt(rs.square().sum() / rs.rows());
+        Eigen::Index row        = 0;
+        for (size_t i = 0; i < residuals.size(); i++) {
+            residuals[i] = rs.segment(row, residuals[i].rows());
+            row += residuals[i].rows();
+        }
+        return {true, ""};
+    }
+
+  protected:
+    typename ModelType::VaryingArray Parameters(long const atom) const {
+        typename ModelType::VaryingArray v;
+        typename ModelType::FixedArray   f;
+        dictionary.parameters(atom, v, f);
+        return v;
+    }
+};
+
+} // namespace QI
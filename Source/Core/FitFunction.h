@@ -11,10 +11,12 @@
 
 #pragma once
 
+#include "FitContext.h"
 #include "Macro.h"
 #include "Model.h"
 #include <Eigen/Core>
 #include <itkIndex.h>
+#include <limits>
 #include <string>
 #include <tuple>
 
@@ -29,13 +31,45 @@ struct FitReturnType {
     std::string message;
 };
 
+/*
+ *  The varying array passed to fit() holds the start point. ModelFitFilter and
+ *  ModelMonteCarloFilter fill it with NoWarmStart() for every fit type, unless the fit declares
+ *  WarmStart = true and an already fitted neighbour is suitable, or declares TileStart = true and
+ *  has matched the voxel in tileStart(). Fits that wrap another fit can pass the array on as is.
+ */
+template <typename VaryingArray> VaryingArray NoWarmStart() {
+    return VaryingArray::Constant(std::numeric_limits<typename VaryingArray::Scalar>::quiet_NaN());
+}
+
+template <typename VaryingArray> bool IsWarmStart(VaryingArray const &v) {
+    return v.allFinite();
+}
+
+/*
+ *  Pick the start point for fits that divide the data (and hence the first NScale parameters) by
+ *  scale
+ */
+template <typename ModelType, int NScale = 1>
+typename ModelType::VaryingArray WarmStartOr(ModelType const &                      model,
+                                             typename ModelType::VaryingArray const &warm,
+                                             double const                            scale) {
+    if (IsWarmStart(warm)) {
+        typename ModelType::VaryingArray start = warm;
+        start.template head<NScale>() /= scale;
+        return start.max(model.bounds_lo).min(model.bounds_hi);
+    } else {
+        return model.start;
+    }
+}
+
 template <typename Model_, bool Blocked_ = false, bool Indexed_ = false> struct FitFunctionBase {
     using ModelType           = Model_;
     using RMSErrorType        = double;
     static const bool Blocked = Blocked_;
     static const bool Indexed = Indexed_;
 
-    ModelType model;
+    ModelType    model;
+    FitContextId context;
     FitFunctionBase(ModelType &m) : model{m} {}
 
     long input_size(long const &i) const { return model.input_size(i); }
@@ -69,6 +103,7 @@ struct NLLSFitFunction : FitFunction<ModelType> {
     using InputType  = typename ModelType::DataType;
     using OutputType = typename ModelType::ParameterType;
     using FlagType   = FlagType_; // Iterations
+    static const bool WarmStart = true;
 
     NLLSFitFunction(ModelType &m) : Super{m} {}
 
@@ -79,17 +114,20 @@ struct NLLSFitFunction : FitFunction<ModelType> {
                       RMSErrorType &                          rmse,
                       std::vector<QI_ARRAY(InputType)> &      residuals,
                       FlagType &                              iterations) const {
-        auto const &   data = inputs[0];
-        ceres::Problem problem;
-        using Cost      = ModelCost<ModelType>;
-        using AutoCost  = ceres::AutoDiffCostFunction<Cost, ceres::DYNAMIC, ModelType::NV>;
-        auto *cost      = new Cost{this->model, fixed, data};
-        auto *auto_cost = new AutoCost(cost, this->model.sequence.size());
-        problem.AddResidualBlock(auto_cost, NULL, p.data());
-        for (int i = 0; i < ModelType::NV; i++) {
-            problem.SetParameterLowerBound(p.data(), i, this->model.bounds_lo[i]);
-            problem.SetParameterUpperBound(p.data(), i, this->model.bounds_hi[i]);
-        }
+        auto const &data = inputs[0];
+        auto &      ctx  = QI::ThreadFitContext<ModelType>(this->context, [this](auto &c) {
+            using Cost     = ModelCostRef<ModelType>;
+            using AutoCost = ceres::AutoDiffCostFunction<Cost, ceres::DYNAMIC, ModelType::NV>;
+            auto *cost     = new Cost{this->model, c.fixed, c.data};
+            auto *auto_cost = new AutoCost(cost, this->model.sequence.size());
+            c.problem->AddResidualBlock(auto_cost, NULL, c.varying.data());
+            for (int i = 0; i < ModelType::NV; i++) {
+                c.problem->SetParameterLowerBound(c.varying.data(), i, this->model.bounds_lo[i]);
+                c.problem->SetParameterUpperBound(c.varying.data(), i, this->model.bounds_hi[i]);
+            }
+        });
+        ctx.data  = data;
+        ctx.fixed = fixed;
         ceres::Solver::Options options;
         ceres::Solver::Summary summary;
         options.max_num_iterations  = 15;
@@ -97,8 +135,9 @@ struct NLLSFitFunction : FitFunction<ModelType> {
         options.gradient_tolerance  = 1e-7;
         options.parameter_tolerance = 1e-5;
         options.logging_type        = ceres::SILENT;
-        p << this->model.start;
-        ceres::Solve(options, &problem, &summary);
+        ctx.varying = WarmStartOr(this->model, p, 1.0);
+        ceres::Solve(options, ctx.problem.get(), &summary);
+        p = ctx.varying;
         if (!summary.IsSolutionUsable()) {
             return {false, summary.FullReport()};
         }
@@ -111,7 +150,8 @@ struct NLLSFitFunction : FitFunction<ModelType> {
             residuals[0] = rs;
         }
         if (cov) {
-            QI::GetModelCovariance<ModelType>(problem, p, var / (data.rows() - ModelType::NV), cov);
+            QI::GetModelCovariance<ModelType>(
+                *ctx.problem, ctx.varying, var / (data.rows() - ModelType::NV), cov);
         }
 
         return {true, ""};
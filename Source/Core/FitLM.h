@@ -0,0 +1,261 @@
+/*
+ *  FitLM.h - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+
+#include <Eigen/Cholesky>
+#include <Eigen/Core>
+
+#include "FitFunction.h"
+#include "Macro.h"
+#include "Model.h"
+#include "ceres/ceres.h"
+
+namespace QI {
+
+/*
+ *  Options for LMSolve, named after their Ceres equivalents
+ */
+struct LMOptions {
+    int    max_iterations      = 100;
+    double function_tolerance  = 1e-6;
+    double gradient_tolerance  = 1e-7;
+    double parameter_tolerance = 1e-5;
+    double huber_loss          = 0.0; // Scale of the Huber loss, zero for plain least-squares
+};
+
+struct LMSummary {
+    bool   usable     = false;
+    int    iterations = 0; // Includes the initial evaluation, as ceres::Solver::Summary does
+    double cost       = 0.0;
+};
+
+/*
+ *  Huber loss in the same form as ceres::HuberLoss. Takes a squared residual and returns the loss,
+ *  with the weight (first derivative) in w.
+ */
+inline double HuberRho(double const s, double const a, double &w) {
+    if (a <= 0.0 || s <= a * a) {
+        w = 1.0;
+        return s;
+    } else {
+        double const r = std::sqrt(s);
+        w              = a / r;
+        return 2.0 * a * r - a * a;
+    }
+}
+
+/*
+ *  A bounded Levenberg-Marquardt solver for the small models that make up most of QUIT. All
+ *  parameter-sized storage is fixed-size, the Jacobian is found with forward-mode autodiff through
+ *  the templated signal() and is accumulated straight into the NV x NV normal equations, so there
+ *  is no per-voxel setup cost. Steps are projected onto the model bounds. The damping update
+ *  follows Nielsen, and the Huber loss is handled by re-weighting. If JtJ is given it receives
+ *  the (weighted) normal matrix at the solution, for use in GetModelCovariance.
+ */
+template <typename ModelType>
+LMSummary LMSolve(ModelType const &                      model,
+                  QI_ARRAY(typename ModelType::DataType) const &data,
+                  typename ModelType::FixedArray const &  fixed,
+                  typename ModelType::VaryingArray &      varying,
+                  LMOptions const &                       options,
+                  Eigen::Matrix<double, ModelType::NV, ModelType::NV> *JtJ = nullptr) {
+    static_assert(std::is_same_v<typename ModelType::DataType, double>,
+                  "LMSolve only supports real-valued data");
+    constexpr int NV = ModelType::NV;
+    using Jet        = ceres::Jet<double, NV>;
+    using JetArray   = QI_ARRAYN(Jet, NV);
+    using Vec        = Eigen::Matrix<double, NV, 1>;
+    using Mat        = Eigen::Matrix<double, NV, NV>;
+
+    auto const clamp = [&](Vec const &x) -> Vec {
+        return x.array().max(model.bounds_lo).min(model.bounds_hi).matrix();
+    };
+
+    // Cost, gradient and (Gauss-Newton) Hessian at x
+    auto const linearise = [&](Vec const &x, Mat &H, Vec &g) {
+        JetArray xj;
+        for (int i = 0; i < NV; i++) {
+            xj[i] = Jet(x[i], i);
+        }
+        auto const s    = model.signal(xj, fixed);
+        double     cost = 0.0;
+        H.setZero();
+        g.setZero();
+        for (Eigen::Index i = 0; i < data.rows(); i++) {
+            double const r = data[i] - s[i].a;
+            double       w;
+            cost += 0.5 * HuberRho(r * r, options.huber_loss, w);
+            // Jacobian of the residual is minus the Jacobian of the signal
+            H.template selfadjointView<Eigen::Lower>().rankUpdate(s[i].v, w);
+            g.noalias() -= (w * r) * s[i].v;
+        }
+        H.template triangularView<Eigen::StrictlyUpper>() = H.transpose();
+        return cost;
+    };
+
+    auto const evaluate = [&](Vec const &x) {
+        typename ModelType::VaryingArray const xa = x.array();
+        auto const                             s  = model.signal(xa, fixed);
+        double                                 cost = 0.0, w;
+        for (Eigen::Index i = 0; i < data.rows(); i++) {
+            double const r = data[i] - s[i];
+            cost += 0.5 * HuberRho(r * r, options.huber_loss, w);
+        }
+        return cost;
+    };
+
+    // Infinity norm of the projected gradient, as Ceres uses
+    auto const gradient_norm = [&](Vec const &x, Vec const &g) {
+        return (x - clamp(x - g)).template lpNorm<Eigen::Infinity>();
+    };
+
+    LMSummary summary;
+    Vec       x = clamp(varying.matrix());
+    Mat       H;
+    Vec       g;
+    summary.cost       = linearise(x, H, g);
+    summary.iterations = 1;
+    if (!std::isfinite(summary.cost)) {
+        varying = x.array();
+        return summary;
+    }
+
+    double     mu = 1e-4, nu = 2.0; // Ceres starts with a trust region radius of 1e4
+    bool const converged = gradient_norm(x, g) <= options.gradient_tolerance;
+    for (int it = 0; !converged && it < options.max_iterations; it++) {
+        Mat A = H;
+        A.diagonal() += mu * H.diagonal().cwiseMax(1e-6).cwiseMin(1e32);
+        Vec const full_step = A.ldlt().solve(-g);
+        Vec const xn        = clamp(x + full_step);
+        Vec const step      = xn - x;
+        summary.iterations++;
+        if (!step.allFinite()) {
+            break;
+        }
+        if (step.norm() <= options.parameter_tolerance * (x.norm() + options.parameter_tolerance)) {
+            break;
+        }
+        double const new_cost  = evaluate(xn);
+        double const predicted = -(step.dot(g) + 0.5 * step.dot(H * step));
+        double const rho       = (summary.cost - new_cost) / predicted;
+        if (std::isfinite(new_cost) && predicted > 0.0 && rho > 1e-3) {
+            double const change = summary.cost - new_cost;
+            x                   = xn;
+            summary.cost        = linearise(x, H, g);
+            mu *= std::max(1.0 / 3.0, 1.0 - std::pow(2.0 * rho - 1.0, 3));
+            nu = 2.0;
+            if (change <= options.function_tolerance * (summary.cost + change) ||
+                gradient_norm(x, g) <= options.gradient_tolerance) {
+                break;
+            }
+        } else {
+            mu *= nu;
+            nu *= 2.0;
+            if (mu > 1e32) {
+                break;
+            }
+        }
+    }
+    varying        = x.array();
+    summary.usable = std::isfinite(summary.cost);
+    if (JtJ) {
+        *JtJ = H;
+    }
+    return summary;
+}
+
+/*
+ *  Drop-in alternative to ScaledAutoDiffFit for models with a small number of parameters, using
+ *  LMSolve instead of Ceres. Models must provide start, bounds_lo and bounds_hi.
+ */
+template <typename ModelType_, typename FlagType_ = int> struct LMFit {
+    using ModelType           = ModelType_;
+    using InputType           = typename ModelType::DataType;
+    using OutputType          = typename ModelType::ParameterType;
+    using FlagType            = FlagType_; // Iterations
+    using RMSErrorType        = double;
+    static const bool Blocked   = false;
+    static const bool Indexed   = false;
+    static const bool WarmStart = true;
+
+    ModelType const model;
+    float const     huber_loss     = 1.f;
+    int const       max_iterations = 100;
+    long            input_size(long const &i) const { return model.input_size(i); }
+
+    FitReturnType fit(std::vector<QI_ARRAY(InputType)> const &inputs,
+                      typename ModelType::FixedArray const &  fixed,
+                      typename ModelType::VaryingArray &      varying,
+                      typename ModelType::DerivedArray &      derived,
+                      typename ModelType::CovarArray *        cov,
+                      RMSErrorType &                          rmse,
+                      std::vector<QI_ARRAY(InputType)> &      residuals,
+                      FlagType &                              iterations) const
+        requires(ModelType::ND > 0) {
+        auto const result = fit(inputs, fixed, varying, cov, rmse, residuals, iterations);
+        if (result.success) {
+            this->model.derived(varying, fixed, derived);
+        }
+        return result;
+    }
+
+    FitReturnType fit(std::vector<QI_ARRAY(InputType)> const &inputs,
+                      typename ModelType::FixedArray const &  fixed,
+                      typename ModelType::VaryingArray &      varying,
+                      typename ModelType::CovarArray *        cov,
+                      RMSErrorType &                          rmse,
+                      std::vector<QI_ARRAY(InputType)> &      residuals,
+                      FlagType &                              iterations) const {
+        const double &scale = inputs[0].maxCoeff();
+        if (scale < std::numeric_limits<double>::epsilon()) {
+            varying = ModelType::VaryingArray::Zero();
+            rmse    = 0;
+            return {false, "Maximum data value was not positive"};
+        }
+        const Eigen::ArrayXd data = inputs[0] / scale;
+        LMOptions            options;
+        options.max_iterations = max_iterations;
+        options.huber_loss     = huber_loss;
+        varying                = WarmStartOr(this->model, varying, scale);
+        Eigen::Matrix<double, ModelType::NV, ModelType::NV> JtJ;
+        auto const summary = LMSolve(this->model, data, fixed, varying, options, &JtJ);
+        if (!summary.usable) {
+            return {false, "Cost function was not finite"};
+        }
+        iterations               = summary.iterations;
+        Eigen::ArrayXd const rs  = (data - this->model.signal(varying, fixed));
+        double const         var = rs.square().sum();
+        rmse                     = sqrt(var / data.rows()) * scale;
+        if (residuals.size() > 0) {
+            residuals[0] = rs * scale;
+        }
+        double const cov_scale = var / (data.rows() - ModelType::NV);
+        if (cov && !QI::GetModelCovariance<ModelType>(JtJ, varying, cov_scale, cov)) {
+            // Badly conditioned, let Ceres have a go
+            ceres::Problem problem;
+            using Cost      = ModelCost<ModelType>;
+            using AutoCost  = ceres::AutoDiffCostFunction<Cost, ceres::DYNAMIC, ModelType::NV>;
+            auto *cost      = new Cost{this->model, fixed, data};
+            auto *auto_cost = new AutoCost(cost, data.rows());
+            auto *loss      = huber_loss > 0 ? new ceres::HuberLoss(huber_loss) : nullptr;
+            problem.AddResidualBlock(auto_cost, loss, varying.data());
+            QI::GetModelCovariance<ModelType>(problem, varying, cov_scale, cov);
+        }
+        varying[0] = varying[0] * scale;
+        return {true, ""};
+    }
+};
+
+} // namespace QI
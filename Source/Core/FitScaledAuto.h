@@ -4,17 +4,23 @@
 
 namespace QI {
 
-template <typename ModelType_, typename FlagType_ = int> struct ScaledAutoDiffFit {
+/*
+ *  Fits a model whose signal is templated on the scalar type, so Ceres can use Jets. The data is
+ *  divided by its maximum, and the first NScale parameters multiplied back up afterwards.
+ */
+template <typename ModelType_, typename FlagType_ = int, int NScale = 1> struct ScaledAutoDiffFit {
     using ModelType           = ModelType_;
     using InputType           = typename ModelType::DataType;
     using OutputType          = typename ModelType::ParameterType;
     using FlagType            = FlagType_; // Iterations
     using RMSErrorType        = double;
-    static const bool Blocked = false;
-    static const bool Indexed = false;
+    static const bool Blocked   = false;
+    static const bool Indexed   = false;
+    static const bool WarmStart = true;
 
     ModelType const model;
     float const     huber_loss = 1.f;
+    FitContextId    context;
     long            input_size(long const &i) const { return model.input_size(i); }
 
     FitReturnType fit(std::vector<QI_ARRAY(InputType)> const &inputs,
@@ -31,18 +37,21 @@ template <typename ModelType_, typename FlagType_ = int> struct ScaledAutoDiffFi
             rmse    = 0;
             return {false, "Maximum data value was not positive"};
         }
-        const Eigen::ArrayXd data = inputs[0] / scale;
-        ceres::Problem       problem;
-        using Cost      = ModelCost<ModelType>;
-        using AutoCost  = ceres::AutoDiffCostFunction<Cost, ceres::DYNAMIC, ModelType::NV>;
-        auto *cost      = new Cost{this->model, fixed, data};
-        auto *auto_cost = new AutoCost(cost, this->model.sequence.size());
-        auto *loss      = new ceres::HuberLoss(huber_loss);
-        problem.AddResidualBlock(auto_cost, loss, varying.data());
-        for (int i = 0; i < ModelType::NV; i++) {
-            problem.SetParameterLowerBound(varying.data(), i, this->model.bounds_lo[i]);
-            problem.SetParameterUpperBound(varying.data(), i, this->model.bounds_hi[i]);
-        }
+        auto &ctx = QI::ThreadFitContext<ModelType>(context, [this](auto &c) {
+            using Cost      = ModelCostRef<ModelType>;
+            using AutoCost  = ceres::AutoDiffCostFunction<Cost, ceres::DYNAMIC, ModelType::NV>;
+            auto *cost      = new Cost{this->model, c.fixed, c.data};
+            auto *auto_cost = new AutoCost(cost, this->model.sequence.size());
+            auto *loss      = new ceres::HuberLoss(huber_loss);
+            c.problem->AddResidualBlock(auto_cost, loss, c.varying.data());
+            for (int i = 0; i < ModelType::NV; i++) {
+                c.problem->SetParameterLowerBound(c.varying.data(), i, this->model.bounds_lo[i]);
+                c.problem->SetParameterUpperBound(c.varying.data(), i, this->model.bounds_hi[i]);
+            }
+        });
+        ctx.data                    = inputs[0] / scale;
+        ctx.fixed                   = fixed;
+        auto const &           data = ctx.data;
         ceres::Solver::Options options;
         ceres::Solver::Summary summary;
         options.max_num_iterations  = 100;
@@ -50,8 +59,9 @@ template <typename ModelType_, typename FlagType_ = int> struct ScaledAutoDiffFi
         options.gradient_tolerance  = 1e-7;
         options.parameter_tolerance = 1e-5;
         options.logging_type        = ceres::SILENT;
-        varying << this->model.start;
-        ceres::Solve(options, &problem, &summary);
+        ctx.varying = WarmStartOr<ModelType, NScale>(this->model, varying, scale);
+        ceres::Solve(options, ctx.problem.get(), &summary);
+        varying = ctx.varying;
         if (!summary.IsSolutionUsable()) {
             return {false, summary.FullReport()};
         }
@@ -64,12 +74,26 @@ template <typename ModelType_, typename FlagType_ = int> struct ScaledAutoDiffFi
         }
         if (cov) {
             QI::GetModelCovariance<ModelType>(
-                problem, varying, var / (data.rows() - ModelType::NV), cov);
+                *ctx.problem, ctx.varying, var / (data.rows() - ModelType::NV), cov);
+        }
+        if constexpr (ModelType::ND > 0) {
+            this->model.derived(varying, fixed, derived);
         }
-        this->model.derived(varying, fixed, derived);
-        varying[0] = varying[0] * scale;
+        varying.template head<NScale>() *= scale;
         return {true, ""};
     }
+
+    // ModelFitFilter does not pass a derived array for models without any
+    FitReturnType fit(std::vector<QI_ARRAY(InputType)> const &inputs,
+                      typename ModelType::FixedArray const   &fixed,
+                      typename ModelType::VaryingArray       &varying,
+                      typename ModelType::CovarArray         *cov,
+                      RMSErrorType                           &rmse,
+                      std::vector<QI_ARRAY(InputType)>       &residuals,
+                      FlagType                               &iterations) const {
+        typename ModelType::DerivedArray derived;
+        return fit(inputs, fixed, varying, derived, cov, rmse, residuals, iterations);
+    }
 };
 
 } // namespace QI
\ No newline at end of file
@@ -33,27 +33,28 @@ struct ScaledNumericDiffFit : FitFunction<ModelType, int> {
             rmse    = 0.0;
             return {false, "Maximum data value was zero or less"};
         }
-        Eigen::ArrayXd const data = inputs[0] / scale;
+        // Setup Ceres once per thread, after that only the data and fixed parameters change
+        auto &ctx = QI::ThreadFitContext<ModelType>(this->context, [this](auto &c) {
+            using Cost = QI::ModelCostRef<ModelType>;
+            using Diff =
+                ceres::NumericDiffCostFunction<Cost, ceres::CENTRAL, ceres::DYNAMIC, ModelType::NV>;
+            auto *cost = new Diff(new Cost{this->model, c.fixed, c.data},
+                                  ceres::TAKE_OWNERSHIP,
+                                  this->model.sequence.size());
+            auto *loss = new ceres::HuberLoss(1.0); // Don't know if this helps
 
-        // Setup Ceres
-        ceres::Problem problem;
-        using Diff = ceres::NumericDiffCostFunction<QI::ModelCost<ModelType>,
-                                                    ceres::CENTRAL,
-                                                    ceres::DYNAMIC,
-                                                    ModelType::NV>;
-        auto *cost = new Diff(new QI::ModelCost<ModelType>{this->model, fixed, data},
-                              ceres::TAKE_OWNERSHIP,
-                              this->model.sequence.size());
-        auto *loss = new ceres::HuberLoss(1.0); // Don't know if this helps
+            // This is where the parameters and cost functions actually get added to Ceres
+            c.problem->AddResidualBlock(cost, loss, c.varying.data());
 
-        // This is where the parameters and cost functions actually get added to Ceres
-        problem.AddResidualBlock(cost, loss, varying.data());
-
-        // Set up parameter bounds
-        for (int i = 0; i < ModelType::NV; i++) {
-            problem.SetParameterLowerBound(varying.data(), i, this->model.lo[i]);
-            problem.SetParameterUpperBound(varying.data(), i, this->model.hi[i]);
-        }
+            // Set up parameter bounds
+            for (int i = 0; i < ModelType::NV; i++) {
+                c.problem->SetParameterLowerBound(c.varying.data(), i, this->model.bounds_lo[i]);
+                c.problem->SetParameterUpperBound(c.varying.data(), i, this->model.bounds_hi[i]);
+            }
+        });
+        ctx.data                   = inputs[0] / scale;
+        ctx.fixed                  = fixed;
+        Eigen::ArrayXd const &data = ctx.data;
 
         ceres::Solver::Options options;
         ceres::Solver::Summary summary;
@@ -63,15 +64,16 @@ struct ScaledNumericDiffFit : FitFunction<ModelType, int> {
         options.parameter_tolerance = 1e-5;
         options.logging_type        = ceres::SILENT;
 
-        varying = this->model.start;
-        ceres::Solve(options, &problem, &summary);
+        ctx.varying = this->model.start;
+        ceres::Solve(options, ctx.problem.get(), &summary);
+        varying = ctx.varying;
         if (!summary.IsSolutionUsable()) {
             return {false, summary.FullReport()};
         }
         iterations = summary.iterations.size();
         double              var;
         std::vector<double> rs(data.size());
-        problem.Evaluate(ceres::Problem::EvaluateOptions(), &var, &rs, nullptr, nullptr);
+        ctx.problem->Evaluate(ceres::Problem::EvaluateOptions(), &var, &rs, nullptr, nullptr);
         rmse = sqrt(var / data.rows()) * scale;
         if (residuals.size() > 0) {
             for (long ii = 0; ii < residuals[0].size(); ii++) {
@@ -80,12 +82,28 @@ struct ScaledNumericDiffFit : FitFunction<ModelType, int> {
         }
         if (cov) {
             QI::GetModelCovariance<ModelType>(
-                problem, varying, var / (data.rows() - ModelType::NV), cov);
+                *ctx.problem, ctx.varying, var / (data.rows() - ModelType::NV), cov);
         }
         varying.template head<NScale>() *= scale; // Multiply signals/proton density back up
 
         return {true, ""};
     }
+
+    // ModelFitFilter passes an extra output array for models with derived parameters
+    QI::FitReturnType fit(std::vector<Eigen::ArrayXd> const &   inputs,
+                          typename ModelType::FixedArray const &fixed,
+                          typename ModelType::VaryingArray &    varying,
+                          typename ModelType::DerivedArray &    derived,
+                          typename ModelType::CovarArray *      cov,
+                          RMSErrorType &                        rmse,
+                          std::vector<Eigen::ArrayXd> &         residuals,
+                          int &                                 iterations) const {
+        auto const status = fit(inputs, fixed, varying, cov, rmse, residuals, iterations);
+        if (status.success) {
+            this->model.derived(varying, fixed, derived);
+        }
+        return status;
+    }
 };
 
 } // namespace QI
\ No newline at end of file
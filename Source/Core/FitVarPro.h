@@ -0,0 +1,206 @@
+/*
+ *  FitVarPro.h - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include "FitContext.h"
+#include "FitFunction.h"
+#include "FitLM.h"
+
+namespace QI {
+
+/*
+ *  Variable Projection cost function. The first varying parameter must be a linear amplitude (PD,
+ *  M0 etc.). For a given set of the remaining, non-linear, parameters the best amplitude has a
+ *  closed form, so it is eliminated and the optimiser only sees NV - 1 parameters. Because the
+ *  amplitude is calculated with the same scalar type, autodiff gives the full VarPro Jacobian. The
+ *  amplitude is clamped to the model bounds, where it no longer depends on the other parameters. If
+ *  the basis is zero it carries no information about the amplitude, so the lower bound is used.
+ */
+template <typename Model> struct VarProCost {
+    using FixedArray = typename Model::FixedArray;
+    using DataArray  = QI_ARRAY(typename Model::DataType);
+    const Model &     model;
+    const FixedArray &fixed;
+    const DataArray & data;
+
+    template <typename T> T amplitude(QI_ARRAY(T) const &g) const {
+        T gd(0.0), gg(0.0);
+        for (Eigen::Index i = 0; i < data.rows(); i++) {
+            gd += g[i] * data[i];
+            gg += g[i] * g[i];
+        }
+        if (gg == T(0.0)) {
+            return T(model.bounds_lo[0]);
+        }
+        T const a = gd / gg;
+        if (a < T(model.bounds_lo[0])) {
+            return T(model.bounds_lo[0]);
+        } else if (a > T(model.bounds_hi[0])) {
+            return T(model.bounds_hi[0]);
+        }
+        return a;
+    }
+
+    template <typename T> QI_ARRAY(T) basis(T const *const nl) const {
+        QI_ARRAYN(T, Model::NV) v;
+        v[0] = T(1.0);
+        for (int i = 1; i < Model::NV; i++) {
+            v[i] = nl[i - 1];
+        }
+        return model.signal(v, fixed);
+    }
+
+    template <typename T> bool operator()(const T *const nl, T *rin) const {
+        QI_ARRAY(T) const g = basis(nl);
+        T const a           = amplitude(g);
+        Eigen::Map<QI_ARRAY(T)> residual(rin, data.rows());
+        for (Eigen::Index i = 0; i < data.rows(); i++) {
+            residual[i] = data[i] - a * g[i];
+        }
+        return true;
+    }
+};
+
+/*
+ *  Alternative to ScaledAutoDiffFit that uses Variable Projection to remove the amplitude
+ *  parameter. The amplitude is still written out as the first varying parameter. The closed-form
+ *  amplitude is the least-squares one, so there is no robust loss.
+ */
+template <typename ModelType_, typename FlagType_ = int> struct VarProFit {
+    using ModelType           = ModelType_;
+    using InputType           = typename ModelType::DataType;
+    using OutputType          = typename ModelType::ParameterType;
+    using FlagType            = FlagType_; // Iterations
+    using RMSErrorType        = double;
+    static const bool Blocked   = false;
+    static const bool Indexed   = false;
+    static const bool WarmStart = true;
+    static constexpr int NL     = ModelType::NV - 1;
+    static_assert(NL > 0, "VarProFit needs at least one non-linear parameter");
+
+    ModelType const model;
+    FitContextId    context;
+    long            input_size(long const &i) const { return model.input_size(i); }
+
+    FitReturnType fit(std::vector<QI_ARRAY(InputType)> const &inputs,
+                      typename ModelType::FixedArray const &  fixed,
+                      typename ModelType::VaryingArray &      varying,
+                      typename ModelType::DerivedArray &      derived,
+                      typename ModelType::CovarArray *        cov,
+                      RMSErrorType &                          rmse,
+                      std::vector<QI_ARRAY(InputType)> &      residuals,
+                      FlagType &                              iterations) const
+        requires(ModelType::ND > 0) {
+        auto const result = fit(inputs, fixed, varying, cov, rmse, residuals, iterations);
+        if (result.success) {
+            this->model.derived(varying, fixed, derived);
+        }
+        return result;
+    }
+
+    FitReturnType fit(std::vector<QI_ARRAY(InputType)> const &inputs,
+                      typename ModelType::FixedArray const &  fixed,
+                      typename ModelType::VaryingArray &      varying,
+                      typename ModelType::CovarArray *        cov,
+                      RMSErrorType &                          rmse,
+                      std::vector<QI_ARRAY(InputType)> &      residuals,
+                      FlagType &                              iterations) const {
+        const double &scale = inputs[0].maxCoeff();
+        if (scale < std::numeric_limits<double>::epsilon()) {
+            varying = ModelType::VaryingArray::Zero();
+            rmse    = 0;
+            return {false, "Maximum data value was not positive"};
+        }
+        // The varying array of the context holds the non-linear parameters in the first NL slots
+        auto &ctx = QI::ThreadFitContext<ModelType>(context, [this](auto &c) {
+            using Cost      = VarProCost<ModelType>;
+            using AutoCost  = ceres::AutoDiffCostFunction<Cost, ceres::DYNAMIC, NL>;
+            auto *cost      = new Cost{this->model, c.fixed, c.data};
+            auto *auto_cost = new AutoCost(cost, this->model.sequence.size());
+            c.problem->AddResidualBlock(auto_cost, nullptr, c.varying.data());
+            for (int i = 0; i < NL; i++) {
+                auto const &lo = this->model.bounds_lo[i + 1];
+                auto const &hi = this->model.bounds_hi[i + 1];
+                c.problem->SetParameterLowerBound(c.varying.data(), i, lo);
+                c.problem->SetParameterUpperBound(c.varying.data(), i, hi);
+            }
+        });
+        ctx.data                    = inputs[0] / scale;
+        ctx.fixed                   = fixed;
+        auto const &           data = ctx.data;
+        ceres::Solver::Options options;
+        ceres::Solver::Summary summary;
+        options.max_num_iterations  = 100;
+        options.function_tolerance  = 1e-6;
+        options.gradient_tolerance  = 1e-7;
+        options.parameter_tolerance = 1e-5;
+        options.logging_type        = ceres::SILENT;
+        // Only the non-linear part of a warm start is needed
+        ctx.varying.template head<NL>() =
+            WarmStartOr(this->model, varying, scale).template tail<NL>();
+        ceres::Solve(options, ctx.problem.get(), &summary);
+        if (!summary.IsSolutionUsable()) {
+            return {false, summary.FullReport()};
+        }
+        iterations = summary.iterations.size();
+
+        VarProCost<ModelType> const cost{this->model, fixed, data};
+        Eigen::ArrayXd const        g = cost.basis(ctx.varying.data());
+        varying[0]                    = cost.amplitude(g);
+        varying.template tail<NL>()   = ctx.varying.template head<NL>();
+
+        Eigen::ArrayXd const rs  = data - varying[0] * g;
+        double const         var = rs.square().sum();
+        rmse                     = sqrt(var / data.rows()) * scale;
+        if (residuals.size() > 0) {
+            residuals[0] = rs * scale;
+        }
+        if (cov) {
+            FullCovariance(data, fixed, varying, var / (data.rows() - ModelType::NV), cov);
+        }
+        varying[0] = varying[0] * scale;
+        return {true, ""};
+    }
+
+    /*
+     *  The covariance output covers all the model parameters, including the amplitude, so use the
+     *  Jacobian of the full model at the solution
+     */
+    void FullCovariance(Eigen::ArrayXd const &                data,
+                        typename ModelType::FixedArray const &fixed,
+                        typename ModelType::VaryingArray &    varying,
+                        double const                          cov_scale,
+                        typename ModelType::CovarArray *      cov) const {
+        constexpr int NV = ModelType::NV;
+        using Jet        = ceres::Jet<double, NV>;
+        QI_ARRAYN(Jet, NV) vj;
+        for (int i = 0; i < NV; i++) {
+            vj[i] = Jet(varying[i], i);
+        }
+        auto const                   s   = this->model.signal(vj, fixed);
+        Eigen::Matrix<double, NV, NV> JtJ = Eigen::Matrix<double, NV, NV>::Zero();
+        for (Eigen::Index i = 0; i < data.rows(); i++) {
+            JtJ.template selfadjointView<Eigen::Lower>().rankUpdate(s[i].v);
+        }
+        JtJ.template triangularView<Eigen::StrictlyUpper>() = JtJ.transpose();
+        if (!QI::GetModelCovariance<ModelType>(JtJ, varying, cov_scale, cov)) {
+            ceres::Problem problem;
+            using Cost      = ModelCost<ModelType>;
+            using AutoCost  = ceres::AutoDiffCostFunction<Cost, ceres::DYNAMIC, NV>;
+            auto *auto_cost = new AutoCost(new Cost{this->model, fixed, data}, data.rows());
+            problem.AddResidualBlock(auto_cost, nullptr, varying.data());
+            QI::GetModelCovariance<ModelType>(problem, varying, cov_scale, cov);
+        }
+    }
+};
+
+} // namespace QI
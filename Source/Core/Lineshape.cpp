@@ -16,17 +16,35 @@ using namespace std::string_literals;
 
 namespace QI {
 
+namespace {
+// log(h(x)) for the Super-Lorentzian table, with h evaluated as the lineshape at T2b = 1
+Eigen::ArrayXd TabulateSuperLorentzian(const double log_x0, const double dlog_x) {
+    Eigen::ArrayXd vals(SuperLorentzianTable::size);
+    for (int i = 0; i < SuperLorentzianTable::size; i++) {
+        const double x = std::exp(log_x0 + i * dlog_x);
+        vals[i]        = std::log(SuperLorentzianQuadrature(x / (2.0 * M_PI), 1.0));
+    }
+    return vals;
+}
+} // namespace
+
+SuperLorentzianTable::SuperLorentzianTable() :
+    dlog_x{(std::log(x_max) - std::log(x_min)) / (size - 3)},
+    log_x0{std::log(x_min) - dlog_x}, table{TabulateSuperLorentzian(log_x0, dlog_x)} {}
+
+const SuperLorentzianTable &SuperLorentzianTable::Get() {
+    static const SuperLorentzianTable table;
+    return table;
+}
+
 InterpLineshape::InterpLineshape(const double          fmin,
                                  const double          fstep,
                                  const int             fcount,
                                  const Eigen::ArrayXd &vals,
                                  const double          T2) :
     T2_nominal{T2},
-    freq_min{fmin}, freq_step{fstep}, freq_count{fcount}, values{vals} {
-
-    grid         = std::make_shared<ceres::Grid1D<double>>(&values[0], 0, values.rows());
-    interpolator = std::make_shared<ceres::CubicInterpolator<ceres::Grid1D<double>>>(*grid);
-}
+    freq_min{fmin}, freq_step{fstep}, freq_count{fcount},
+    table{std::make_shared<CubicTable>(vals)} {}
 
 } // End namespace QI
 
@@ -48,7 +66,7 @@ void adl_serializer<QI::InterpLineshape>::to_json(json &j, QI::InterpLineshape l
              {"freq_min", l.freq_min},
              {"freq_step", l.freq_step},
              {"freq_count", l.freq_count},
-             {"values", l.values}};
+             {"values", l.table->values}};
 }
 
 } // namespace nlohmann
@@ -12,11 +12,13 @@
 #ifndef LINESHAPE_H
 #define LINESHAPE_H
 
+#include "CubicTable.h"
 #include "JSON.h"
 #include "Macro.h"
 #include "NumericalIntegration.h"
-#include "ceres/cubic_interpolation.h"
+#include "ceres/jet.h"
 #include <Eigen/Core>
+#include <cmath>
 #include <functional>
 #include <memory>
 #include <string>
@@ -42,27 +44,68 @@ template <typename T> struct SLFunctor {
     }
 };
 
-template <typename T> QI_ARRAY(T) SuperLorentzian(const Eigen::ArrayXd &df0, const T T2b) {
+template <typename T> T SuperLorentzianQuadrature(const double f0, const T T2b) {
     Eigen::Integrator<T> integrator(200);
     const auto           quad_rule = Eigen::Integrator<T>::GaussKronrod61;
     T                    abs_error{0.0};
     T                    rel_error{Eigen::NumTraits<double>::epsilon() * 50.0};
+    SLFunctor<T>         sl_functor{T2b, f0};
+    return integrator.quadratureAdaptive(
+        sl_functor, T{0.0}, T{1.0}, abs_error, rel_error, quad_rule);
+}
+
+// Adaptive quadrature at every offset. Slow, use SuperLorentzianTable inside fits
+template <typename T> QI_ARRAY(T) SuperLorentzian(const Eigen::ArrayXd &df0, const T T2b) {
     QI_ARRAY(T) vals(df0.rows());
     for (auto i = 0; i < df0.rows(); i++) {
-        SLFunctor<T> sl_functor{T2b, df0[i]};
-        vals[i] = integrator.quadratureAdaptive(
-            sl_functor, T{0.0}, T{1.0}, abs_error, rel_error, quad_rule);
+        vals[i] = SuperLorentzianQuadrature(df0[i], T2b);
     }
     return vals;
 }
 
+/*
+ *  The Super-Lorentzian is T2b * h(2 pi f0 T2b). log(h) is tabulated once per process against
+ *  log(x) between x_min and x_max, which keeps the relative error of the interpolation below
+ *  2e-6. The end intervals of a cubic table are less accurate, so there is one extra sample
+ *  beyond each limit. Outside the limits this falls back to quadrature.
+ */
+class SuperLorentzianTable {
+  public:
+    static constexpr int    size  = 4096;
+    static constexpr double x_min = 1e-4;
+    static constexpr double x_max = 30.0;
+
+    static const SuperLorentzianTable &Get();
+
+    template <typename T> T operator()(const double f0, const T T2b) const {
+        using std::exp;
+        using std::log;
+        const T i = (log(2.0 * M_PI * std::abs(f0) * T2b) - log_x0) / dlog_x;
+        if ((i < 1.0) || (i > size - 2.0)) {
+            return SuperLorentzianQuadrature(f0, T2b);
+        }
+        return T2b * exp(table.Evaluate(i));
+    }
+
+    template <typename T> QI_ARRAY(T) operator()(const Eigen::ArrayXd &df0, const T T2b) const {
+        QI_ARRAY(T) vals(df0.rows());
+        for (auto i = 0; i < df0.rows(); i++) {
+            vals[i] = (*this)(df0[i], T2b);
+        }
+        return vals;
+    }
+
+  private:
+    SuperLorentzianTable();
+    const double     dlog_x, log_x0;
+    const CubicTable table;
+};
+
 struct InterpLineshape {
-    double                                                           T2_nominal = 1e-6;
-    double                                                           freq_min, freq_step;
-    int                                                              freq_count;
-    Eigen::ArrayXd                                                   values;
-    std::shared_ptr<ceres::Grid1D<double>>                           grid;
-    std::shared_ptr<ceres::CubicInterpolator<ceres::Grid1D<double>>> interpolator;
+    double                            T2_nominal = 1e-6;
+    double                            freq_min, freq_step;
+    int                               freq_count;
+    std::shared_ptr<const CubicTable> table;
 
     InterpLineshape(const double          freq_min,
                     const double          freq_step,
@@ -72,35 +115,38 @@ struct InterpLineshape {
     InterpLineshape(double const T2b, Eigen::ArrayXd &freqs, Eigen::ArrayXd &vals);
 
     template <typename T> QI_ARRAY(T) operator()(const Eigen::ArrayXd &f, const T T2) const {
-        const auto scale = T2 / T2_nominal;
-        const auto sf    = (f.abs() * scale - freq_min) / freq_step;
         QI_ARRAY(T) interp_vals(f.rows());
         for (auto i = 0; i < f.rows(); i++) {
-            if (sf[i] < 0.0) {
-                interp_vals[i] = values[0] * scale;
-            } else if (sf[i] > (freq_count - 1.0)) {
-                interp_vals[i] = values[freq_count - 1] * scale;
-            } else {
-                interpolator->Evaluate(sf[i], &interp_vals[i]);
-                interp_vals[i] *= scale;
-            }
+            interp_vals[i] = (*this)(f[i], T2);
         }
         return interp_vals;
     }
 
     template <typename T> T operator()(double const &f, const T T2) const {
         const auto scale = T2 / T2_nominal;
-        const auto sf    = (std::abs(f) * scale - freq_min) / freq_step;
+        const T    sf    = (std::abs(f) * scale - freq_min) / freq_step;
+
+        if (sf < 0.0) {
+            return table->values[0] * scale;
+        } else if (sf > (freq_count - 1.0)) {
+            return table->values[freq_count - 1] * scale;
+        } else {
+            return table->Evaluate(sf) * scale;
+        }
+    }
+
+    // As above, for models where the frequency offset is also fitted
+    template <typename T, int N>
+    ceres::Jet<T, N> operator()(ceres::Jet<T, N> const &f, ceres::Jet<T, N> const T2) const {
+        const auto scale = T2 / T2_nominal;
+        const auto sf    = (abs(f) * scale - freq_min) / freq_step;
 
         if (sf < 0.0) {
-            return values[0] * scale;
+            return table->values[0] * scale;
         } else if (sf > (freq_count - 1.0)) {
-            return values[freq_count - 1] * scale;
+            return table->values[freq_count - 1] * scale;
         } else {
-            T val;
-            interpolator->Evaluate(sf, &val);
-            val *= scale;
-            return val;
+            return table->Evaluate(sf) * scale;
         }
     }
 };
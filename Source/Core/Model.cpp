@@ -1,35 +1,35 @@
 #include "Model.h"
 
-#include <random>
-
 namespace QI {
 
-Eigen::ArrayXd NoiseFromDataType<double>::add_noise(Eigen::ArrayXd const &s, double const sigma) {
-    Eigen::ArrayXcd noise(s.rows());
-    // Simple Box Muller transform
-    Eigen::ArrayXd U = (Eigen::ArrayXd::Random(s.rows()) * 0.5) + 0.5;
-    Eigen::ArrayXd V = (Eigen::ArrayXd::Random(s.rows()) * 0.5) + 0.5;
-    noise.real()     = (sigma / M_SQRT2) * (-2. * U.log()).sqrt() * cos(2. * M_PI * V);
-    noise.imag()     = (sigma / M_SQRT2) * (-2. * V.log()).sqrt() * sin(2. * M_PI * U);
-    Eigen::ArrayXcd coutput(s.rows());
-    coutput.real() = s + noise.real();
-    coutput.imag() = noise.imag();
-    return coutput.abs();
+Eigen::ArrayXd NoiseFromDataType<double>::add_noise(Eigen::ArrayXd const &s,
+                                                   double const          sigma,
+                                                   NoiseStream &         stream) {
+    // Complex noise, so the magnitude is Rician
+    Eigen::ArrayXd noise(2 * s.rows());
+    stream.normal(noise);
+    noise *= sigma / M_SQRT2;
+    return ((s + noise.head(s.rows())).square() + noise.tail(s.rows()).square()).sqrt();
 }
 
 Eigen::ArrayXcd NoiseFromDataType<std::complex<double>>::add_noise(Eigen::ArrayXcd const &s,
-                                                                   double const           sigma) {
-    Eigen::ArrayXcd noise(s.rows());
-    // Simple Box Muller transform
-    Eigen::ArrayXd U = (Eigen::ArrayXd::Random(s.rows()) * 0.5) + 0.5;
-    Eigen::ArrayXd V = (Eigen::ArrayXd::Random(s.rows()) * 0.5) + 0.5;
-    noise.real()     = (sigma / M_SQRT2) * (-2. * U.log()).sqrt() * cos(2. * M_PI * V);
-    noise.imag()     = (sigma / M_SQRT2) * (-2. * V.log()).sqrt() * sin(2. * M_PI * U);
-    return s + noise;
+                                                                   double const           sigma,
+                                                                   NoiseStream &          stream) {
+    Eigen::ArrayXd noise(2 * s.rows());
+    stream.normal(noise);
+    noise *= sigma / M_SQRT2;
+    Eigen::ArrayXcd output = s;
+    output.real() += noise.head(s.rows());
+    output.imag() += noise.tail(s.rows());
+    return output;
 }
 
-Eigen::ArrayXd RealNoise::add_noise(Eigen::ArrayXd const &s, double const sigma) {
-    return s + Eigen::ArrayXd::Random(s.rows()) * sigma;
+Eigen::ArrayXd
+RealNoise::add_noise(Eigen::ArrayXd const &s, double const sigma, NoiseStream &stream) {
+    // Uniform on (-sigma, sigma)
+    Eigen::ArrayXd noise(s.rows());
+    stream.uniform(noise);
+    return s + (2. * noise - 1.) * sigma;
 }
 
 } // namespace QI
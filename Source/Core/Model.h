@@ -13,7 +13,9 @@
 
 #include "ImageTypes.h"
 #include "Macro.h"
+#include "Philox.h"
 #include "ceres/ceres.h"
+#include <Eigen/Eigenvalues>
 #include <array>
 #include <string>
 
@@ -48,23 +50,15 @@ template <typename DT_, typename PT_, int NV_, int NF_, int NI_ = 1, int ND_ = 0
 };
 
 /*
- *  Convert the Covariance Matrix from Ceres into something useful
+ *  Convert a covariance matrix into something useful
  * The diagonal elements are the estimation variance of each parameter (after division by the
  * residual). Square-root to get the standard deviation. Off-diagonal elements need to be divided by
  * the standard deviation of each variable to get the correlation.
  */
 template <typename Model>
-void GetModelCovariance(ceres::Problem &                    p,
-                        typename Model::VaryingArray const &v,
-                        double const &                      scale,
-                        typename Model::CovarArray *        ptr) {
-    ceres::Covariance::Options cov_options;
-    ceres::Covariance          cov_c(cov_options);
-    cov_c.Compute({std::make_pair(v.data(), v.data())}, &p);
-
-    Eigen::MatrixXd full(Model::NV, Model::NV);
-    cov_c.GetCovarianceBlock(v.data(), v.data(), full.data());
-    full *= scale;
+void FillModelCovariance(Eigen::Matrix<double, Model::NV, Model::NV> const &full,
+                         typename Model::VaryingArray const &               v,
+                         typename Model::CovarArray *                       ptr) {
     typename Model::CovarArray &cov = (*ptr);
     cov.head(Model::NV)             = full.diagonal().array().sqrt();
     int index                       = Model::NV;
@@ -78,6 +72,71 @@ void GetModelCovariance(ceres::Problem &                    p,
     QI_DBVEC(cov);
 }
 
+/*
+ *  Covariance from the normal matrix J^T J at the solution, which is small enough to invert
+ *  directly. Returns false, leaving the output untouched, if J^T J is too badly conditioned. The
+ *  check is on the eigenvalues of J^T J, so the threshold is the square of the one applied to J.
+ */
+template <typename Model>
+bool GetModelCovariance(Eigen::Matrix<double, Model::NV, Model::NV> const &JtJ,
+                        typename Model::VaryingArray const &               v,
+                        double const &                                     scale,
+                        typename Model::CovarArray *                       ptr) {
+    using Mat = Eigen::Matrix<double, Model::NV, Model::NV>;
+    Eigen::SelfAdjointEigenSolver<Mat> const eig(JtJ);
+    if (eig.info() != Eigen::Success) {
+        return false;
+    }
+    auto const &vals = eig.eigenvalues(); // Sorted in increasing order
+    if (!(vals[0] > 1e-12 * vals[Model::NV - 1])) {
+        return false;
+    }
+    auto const &vecs = eig.eigenvectors();
+    Mat const   full = scale * vecs * vals.cwiseInverse().asDiagonal() * vecs.transpose();
+    FillModelCovariance<Model>(full, v, ptr);
+    return true;
+}
+
+/*
+ *  Covariance for a solved Ceres problem. The Jacobian is evaluated once at the solution and the
+ *  small dense path above is used, only falling back to ceres::Covariance for ill-conditioned
+ *  voxels.
+ */
+template <typename Model>
+void GetModelCovariance(ceres::Problem &                    p,
+                        typename Model::VaryingArray const &v,
+                        double const &                      scale,
+                        typename Model::CovarArray *        ptr) {
+    using Mat = Eigen::Matrix<double, Model::NV, Model::NV>;
+    using Vec = Eigen::Matrix<double, Model::NV, 1>;
+    ceres::Problem::EvaluateOptions eval_options;
+    eval_options.parameter_blocks = {const_cast<double *>(v.data())};
+    ceres::CRSMatrix J;
+    if (p.Evaluate(eval_options, nullptr, nullptr, nullptr, &J) && J.num_cols == Model::NV) {
+        Mat JtJ = Mat::Zero();
+        for (int r = 0; r < J.num_rows; r++) {
+            Vec row = Vec::Zero();
+            for (int k = J.rows[r]; k < J.rows[r + 1]; k++) {
+                row[J.cols[k]] = J.values[k];
+            }
+            JtJ.template selfadjointView<Eigen::Lower>().rankUpdate(row);
+        }
+        JtJ.template triangularView<Eigen::StrictlyUpper>() = JtJ.transpose();
+        if (GetModelCovariance<Model>(JtJ, v, scale, ptr)) {
+            return;
+        }
+    }
+
+    ceres::Covariance::Options cov_options;
+    ceres::Covariance          cov_c(cov_options);
+    cov_c.Compute({std::make_pair(v.data(), v.data())}, &p);
+
+    Mat full;
+    cov_c.GetCovarianceBlock(v.data(), v.data(), full.data());
+    full *= scale;
+    FillModelCovariance<Model>(full, v, ptr);
+}
+
 /*
  *  A generic Ceres Cost Function compatible with auto-differentation
  */
@@ -132,15 +191,18 @@ template <int ImageDimension, typename T> struct BlockTypes<false, ImageDimensio
 template <typename DataType> struct NoiseFromDataType;
 
 template <> struct NoiseFromDataType<double> {
-    static Eigen::ArrayXd add_noise(Eigen::ArrayXd const &s, double const sigma);
+    static Eigen::ArrayXd
+    add_noise(Eigen::ArrayXd const &s, double const sigma, NoiseStream &stream);
 };
 
 template <> struct NoiseFromDataType<std::complex<double>> {
-    static Eigen::ArrayXcd add_noise(Eigen::ArrayXcd const &s, double const sigma);
+    static Eigen::ArrayXcd
+    add_noise(Eigen::ArrayXcd const &s, double const sigma, NoiseStream &stream);
 };
 
 struct RealNoise {
-    static Eigen::ArrayXd add_noise(Eigen::ArrayXd const &s, double const sigma);
+    static Eigen::ArrayXd
+    add_noise(Eigen::ArrayXd const &s, double const sigma, NoiseStream &stream);
 };
 
 template <typename ModelType>
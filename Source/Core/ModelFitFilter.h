@@ -13,8 +13,11 @@
 
 #include <Eigen/Core>
 #include <array>
+#include <chrono>
 #include <functional>
+#include <memory>
 #include <tuple>
+#include <type_traits>
 #include <vector>
 
 #include "itkCommand.h"
@@ -26,11 +29,15 @@
 #include "itkVariableLengthVector.h"
 #include "itkVectorImage.h"
 
+#include "Checkpoint.h"
 #include "FitFunction.h"
 #include "Log.h"
 #include "Model.h"
 #include "Monitor.h"
+#include "ScratchFile.h"
+#include "Telemetry.h"
 #include "Util.h"
+#include "VoxelQueue.h"
 
 namespace QI {
 
@@ -64,6 +71,7 @@ class ModelFitFilter
     using TInputImage = itk::VectorImage<InputPixelType, ImageDim>;
     using TFixedImage = itk::Image<FixedPixelType, ImageDim>;
     using TMaskImage  = itk::Image<float, ImageDim>;
+    using TTimeImage  = itk::Image<float, ImageDim>;
 
     static constexpr bool Blocked = FitType::Blocked;
 
@@ -81,6 +89,9 @@ class ModelFitFilter
 
     static constexpr bool Indexed    = FitType::Indexed;
     static constexpr bool HasDerived = ModelType::ND > 0;
+    static constexpr bool WarmStart  = requires { requires FitType::WarmStart; };
+    // Fits that set start points for a whole tile at once, e.g. by dictionary matching
+    static constexpr bool TileStart = requires { requires FitType::TileStart; };
 
     QI_ForwardNewMacro(Self);
     itkTypeMacro(ModelFitFilter,
@@ -180,6 +191,45 @@ class ModelFitFilter
         m_hasSubregion = true;
     }
 
+    void SetTileSize(const int ts) {
+        if (ts < 1) {
+            QI::Fail("Tile size must be at least 1, was {}", ts);
+        }
+        m_tileSize = ts;
+    }
+
+    /*
+     * Start each voxel from an already fitted neighbour in the same tile, if that fit succeeded
+     * and its RMSE was below max_rmse as a fraction of the neighbour's maximum signal
+     */
+    void SetWarmStart(const bool ws, const double max_rmse = 0.05) {
+        if (ws && !WarmStart) {
+            auto const name = typeid(FitType).name();
+            QI::Warn("{} does not support warm starts", name);
+        }
+        m_warmStart = ws && WarmStart;
+        m_warmRMSE  = max_rmse;
+    }
+
+    /*
+     * Save finished voxels to path every interval seconds. If resume is set, voxels already
+     * finished in an existing checkpoint are restored and not fitted again.
+     */
+    void SetCheckpoint(std::string const &path, const double interval, const bool resume) {
+        m_checkpointPath     = path;
+        m_checkpointInterval = interval;
+        m_resume             = resume;
+    }
+
+    /*
+     * Record a solve-time image, count failures by reason instead of printing each one, and write
+     * a JSON performance report to path
+     */
+    void SetTelemetry(std::string const &path) {
+        m_telemetryPath = path;
+        m_telemetry     = path != "" ? std::make_unique<Telemetry>() : nullptr;
+    }
+
     void SetBlocks(const int &nb) {
         if constexpr (Blocked) {
             m_blocks = nb;
@@ -251,6 +301,7 @@ class ModelFitFilter
             QI::Fail("Number of input file paths did not match number of inputs for model");
         }
 
+        TelemetryTimer timer(m_telemetry.get(), Telemetry::Stage::Read);
         for (int i = 0; i < ModelType::NI; i++) {
             SetInput(i, QI::ReadImage<TInputImage>(inputs[i], m_verbose));
         }
@@ -263,50 +314,168 @@ class ModelFitFilter
     }
 
     void WriteOutputs(std::string const &prefix) {
+        {
+            TelemetryTimer timer(m_telemetry.get(), Telemetry::Stage::Write);
+            ForEachOutput(prefix, [this](auto *image, std::string const &path) {
+                QI::WriteImage(image, path, m_verbose);
+            });
+        }
+        if (m_checkpoint) {
+            m_checkpoint->remove();
+        }
+        WriteTelemetry();
+    }
+
+    /*
+     * Read, fit and write the volume in slabs of nslices along z, so that only one slab of the
+     * inputs and outputs is held in memory. Each output slab is appended to a scratch file next to
+     * the output, and these are mapped and written out as images once every slab is done.
+     */
+    void ProcessSlabs(std::vector<std::string> const &      inputs,
+                      typename ModelType::FixedNames const &fixed,
+                      std::string const &                   mask,
+                      std::string const &                   prefix,
+                      const int                             nslices) {
+        if (static_cast<size_t>(ModelType::NI) != inputs.size()) {
+            QI::Fail("Number of input file paths did not match number of inputs for model");
+        }
+        if (nslices < 1) {
+            QI::Fail("Slab size must be at least 1 slice, was {}", nslices);
+        }
+        if (m_checkpointPath != "") {
+            QI::Fail("Checkpoints cannot be used when processing in slabs");
+        }
+        // Otherwise every slab would read the whole of each file again
+        std::vector<std::string> paths(inputs.begin(), inputs.end());
+        paths.insert(paths.end(), fixed.begin(), fixed.end());
+        paths.push_back(mask);
+        for (auto const &path : paths) {
+            if (path != "" && !QI::CanStreamRead(path)) {
+                QI::Fail("Slabs cannot be read from {}, decompress it first", path);
+            }
+        }
+        auto const full = QI::ReadImageRegion(inputs[0]);
+        if (m_hasSubregion && !full.IsInside(m_subregion)) {
+            QI::Fail("Specified subregion is not entirely inside image");
+        }
+        auto const nz = static_cast<itk::IndexValueType>(full.GetSize(2));
+        std::vector<std::unique_ptr<ScratchFile>> scratch;
+        m_slabbed = true;
+        for (itk::IndexValueType z = 0; z < nz; z += nslices) {
+            auto slab = full;
+            slab.SetIndex(2, full.GetIndex(2) + z);
+            slab.SetSize(2, std::min<itk::IndexValueType>(nslices, nz - z));
+            Info(m_verbose, "Processing slices {} to {} of {}", z, z + slab.GetSize(2) - 1, nz);
+            {
+                TelemetryTimer timer(m_telemetry.get(), Telemetry::Stage::Read);
+                for (int i = 0; i < ModelType::NI; i++) {
+                    SetInput(i, QI::ReadImageSlab<TInputImage>(inputs[i], slab, m_verbose));
+                }
+                for (int f = 0; f < ModelType::NF; f++) {
+                    if (fixed[f] != "")
+                        SetFixed(f, QI::ReadImageSlab<TFixedImage>(fixed[f], slab, m_verbose));
+                }
+                if (mask != "")
+                    SetMask(QI::ReadImageSlab<TMaskImage>(mask, slab, m_verbose));
+            }
+            // The previous slab's requested region is no longer valid
+            this->UpdateLargestPossibleRegion();
+            TelemetryTimer timer(m_telemetry.get(), Telemetry::Stage::Write);
+            size_t         o = 0;
+            ForEachOutput(prefix, [&](auto *image, std::string const &path) {
+                if (o == scratch.size()) {
+                    scratch.push_back(std::make_unique<ScratchFile>(path + ".slabs"));
+                }
+                scratch[o++]->append(image->GetBufferPointer(), ImageBytes(image));
+            });
+        }
+        m_slabbed = false;
+
+        {
+            TelemetryTimer timer(m_telemetry.get(), Telemetry::Stage::Write);
+            size_t         o = 0;
+            ForEachOutput(prefix, [&](auto *slab_image, std::string const &path) {
+                using TImage     = std::remove_pointer_t<decltype(slab_image)>;
+                using TInternal  = typename TImage::InternalPixelType;
+                auto const ncomp = slab_image->GetNumberOfComponentsPerPixel();
+                auto       image = TImage::New();
+                image->CopyInformation(slab_image);
+                image->SetRegions(full);
+                image->SetNumberOfComponentsPerPixel(ncomp);
+                auto *const buffer = static_cast<TInternal *>(scratch[o++]->map());
+                image->GetPixelContainer()->SetImportPointer(
+                    buffer, full.GetNumberOfPixels() * ncomp, false);
+                QI::WriteImage(image.GetPointer(), path, m_verbose);
+            });
+        }
+        WriteTelemetry();
+    }
+
+  private:
+    ModelFitFilter(const Self &); // purposely not implemented
+    void operator=(const Self &); // purposely not implemented
+
+  protected:
+    /*
+     * Call f(image, path) for every output that will be written, always in the same order
+     */
+    template <typename F> void ForEachOutput(std::string const &prefix, F &&f) {
         for (int i = 0; i < ModelType::NV; i++) {
-            QI::WriteImage(
-                GetOutput(i), prefix + m_fit->model.varying_names.at(i) + QI::OutExt(), m_verbose);
+            f(GetOutput(i), prefix + m_fit->model.varying_names.at(i) + QI::OutExt());
         }
         if constexpr (ModelType::ND > 0) {
             for (int i = 0; i < ModelType::ND; i++) {
-                QI::WriteImage(GetDerivedOutput(i),
-                               prefix + m_fit->model.derived_names.at(i) + QI::OutExt(),
-                               m_verbose);
+                f(GetDerivedOutput(i), prefix + m_fit->model.derived_names.at(i) + QI::OutExt());
             }
         }
-        QI::WriteImage(GetRMSErrorOutput(), prefix + "rmse" + QI::OutExt(), m_verbose);
-        QI::WriteImage(GetFlagOutput(), prefix + "iterations" + QI::OutExt(), m_verbose);
+        f(GetRMSErrorOutput(), prefix + "rmse" + QI::OutExt());
+        f(GetFlagOutput(), prefix + "iterations" + QI::OutExt());
         if (m_covar) {
             for (int ii = 0; ii < ModelType::NV; ii++) {
                 auto const &name = m_fit->model.varying_names.at(ii);
-                QI::WriteImage(
-                    GetCovarOutput(ii), prefix + "CoV_" + name + QI::OutExt(), m_verbose);
+                f(GetCovarOutput(ii), prefix + "CoV_" + name + QI::OutExt());
             }
             int index = ModelType::NV;
             for (int ii = 0; ii < ModelType::NV; ii++) {
                 auto const &name1 = m_fit->model.varying_names.at(ii);
                 for (int jj = ii + 1; jj < ModelType::NV; jj++) {
                     auto const &name2 = m_fit->model.varying_names.at(jj);
-                    QI::WriteImage(GetCovarOutput(index++),
-                                   prefix + "Corr_" + name1 + "_" + name2 + QI::OutExt(),
-                                   m_verbose);
+                    f(GetCovarOutput(index++),
+                      prefix + "Corr_" + name1 + "_" + name2 + QI::OutExt());
                 }
             }
         }
         if (m_allResiduals) {
             for (int i = 0; i < ModelType::NI; i++) {
-                QI::WriteImage(GetResidualsOutput(i),
-                               prefix + "residuals_" + std::to_string(i) + QI::OutExt(),
-                               m_verbose);
+                f(GetResidualsOutput(i), prefix + "residuals_" + std::to_string(i) + QI::OutExt());
             }
         }
+        if (m_telemetry) {
+            f(m_timeImage.GetPointer(), prefix + "time_ns" + QI::OutExt());
+        }
     }
 
-  private:
-    ModelFitFilter(const Self &); // purposely not implemented
-    void operator=(const Self &); // purposely not implemented
+    // Called once all outputs have been written
+    void WriteTelemetry() const {
+        if (m_telemetry) {
+            m_telemetry->logFailures(m_verbose);
+            json report = m_telemetry->report();
+            // Fits can add their own statistics
+            if constexpr (requires { m_fit->addTelemetry(report); }) {
+                m_fit->addTelemetry(report);
+            }
+            QI::WriteJSON(m_telemetryPath, report);
+        }
+    }
+
+    template <typename TImage> static size_t PixelBytes(TImage const *image) {
+        return image->GetNumberOfComponentsPerPixel() * sizeof(*image->GetBufferPointer());
+    }
+
+    template <typename TImage> static size_t ImageBytes(TImage const *image) {
+        return image->GetBufferedRegion().GetNumberOfPixels() * PixelBytes(image);
+    }
 
-  protected:
     itk::DataObject::Pointer
     MakeOutput(itk::ProcessObject::DataObjectPointerArraySizeType idx) override {
         using itype = itk::ProcessObject::DataObjectPointerArraySizeType; // Stop unsigned long
@@ -335,7 +504,20 @@ class ModelFitFilter
     const bool     m_verbose, m_allResiduals, m_covar;
     bool           m_hasSubregion = false;
     TRegion        m_subregion;
-    int            m_blocks = 1;
+    int            m_blocks    = 1;
+    int            m_tileSize  = 64;
+    bool           m_warmStart = false;
+    double         m_warmRMSE  = 0.05;
+    std::string    m_checkpointPath;
+    double         m_checkpointInterval = 600;
+    bool           m_resume             = false;
+    bool           m_slabbed            = false;
+    std::string    m_telemetryPath;
+
+    std::unique_ptr<Telemetry>   m_telemetry;
+    typename TTimeImage::Pointer m_timeImage;
+
+    std::unique_ptr<Checkpoint> m_checkpoint;
 
     virtual void GenerateOutputInformation() override {
         Superclass::GenerateOutputInformation();
@@ -348,6 +530,17 @@ class ModelFitFilter
                 QI::Fail("Input parameter images are not all the same size");
             }
         }
+        // Voxels are addressed by buffer offset, so fixed maps and the mask must match as well
+        for (int f = 0; f < ModelType::NF; f++) {
+            const auto fp = this->GetFixed(f);
+            if (fp && (ip->GetLargestPossibleRegion() != fp->GetLargestPossibleRegion())) {
+                QI::Fail("Fixed parameter image {} is not the same size as the input", f);
+            }
+        }
+        const auto mp = this->GetMask();
+        if (mp && (ip->GetLargestPossibleRegion() != mp->GetLargestPossibleRegion())) {
+            QI::Fail("Mask image is not the same size as the input");
+        }
 
         for (int i = 0; i < ModelType::NI; i++) {
             if ((m_fit->input_size(i) * m_blocks) !=
@@ -437,11 +630,26 @@ class ModelFitFilter
                 res->Allocate(true);
             }
         }
+
+        if (m_telemetry) {
+            m_timeImage = TTimeImage::New();
+            m_timeImage->SetRegions(region);
+            m_timeImage->SetSpacing(spacing);
+            m_timeImage->SetOrigin(origin);
+            m_timeImage->SetDirection(direction);
+            m_timeImage->Allocate(true);
+        }
     }
 
     virtual void GenerateData() override {
+        TelemetryTimer timer(m_telemetry.get(), Telemetry::Stage::Fit);
         auto region = this->GetInput(0)->GetLargestPossibleRegion();
-        if (m_hasSubregion) {
+        if (m_hasSubregion && m_slabbed) {
+            // Only fit the part of the subregion inside this slab, which may be nothing
+            if (!region.Crop(m_subregion)) {
+                region.SetSize(TRegion::SizeType::Filled(0));
+            }
+        } else if (m_hasSubregion) {
             if (region.IsInside(m_subregion)) {
                 region = m_subregion;
             } else {
@@ -449,215 +657,350 @@ class ModelFitFilter
             }
         }
 
-        Info(m_verbose, "Processing...");
-        this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
-        this->GetMultiThreader()->template ParallelizeImageRegion<ImageDim>(
-            region,
-            [this](const typename TOutputImage::RegionType &outputRegion) {
-                this->DynamicThreadedGenerateData(outputRegion);
-            },
-            this);
+        auto const input = this->GetInput(0);
+        VoxelQueue queue(input.GetPointer(), region, this->GetMask().GetPointer());
+        if (m_checkpointPath != "") {
+            StartCheckpoint(queue);
+        }
+        auto const nthreads = this->GetNumberOfWorkUnits();
+        queue.setChunkSize(nthreads, m_tileSize);
+        Info(m_verbose,
+             "Processing {} voxels in chunks of {} on {} threads...",
+             queue.size(),
+             queue.chunkSize(),
+             nthreads);
+        auto const loads = ProcessQueue(
+            queue, this->GetMultiThreader(), this, nthreads, [this, &queue, &input]() {
+                // Chunks are never larger than a tile, so each one is fitted in a single pass
+                return [this, &queue, &input, tile = MakeTile()](size_t start, size_t end) mutable {
+                    for (size_t q = start; q < end; q++) {
+                        tile.offsets[tile.count] = queue.data()[q];
+                        tile.indices[tile.count] = input->ComputeIndex(queue.data()[q]);
+                        tile.count++;
+                    }
+                    ProcessTile(tile);
+                    if (m_checkpoint) {
+                        for (size_t q = start; q < end; q++) {
+                            m_checkpoint->markDone(queue.data()[q]);
+                        }
+                    }
+                };
+            });
+        if (m_checkpoint) {
+            m_checkpoint->stop();
+        }
         Info(m_verbose, "Finished processing.");
+        LogThreadLoads(m_verbose, loads);
+        if (m_telemetry) {
+            m_telemetry->addLoads(loads);
+        }
     }
 
-    virtual void DynamicThreadedGenerateData(const TRegion &region) override {
-        itk::ImageRegionConstIterator<TMaskImage> mask_iter;
-        const auto                                mask = this->GetMask();
-        if (mask) {
-            mask_iter = itk::ImageRegionConstIterator<TMaskImage>(mask, region);
-        }
+    /*
+     * Register every output with the checkpoint, restore a previous run if requested, and start
+     * the background writer
+     */
+    void StartCheckpoint(VoxelQueue &queue) {
+        auto const nvoxels = this->GetInput(0)->GetLargestPossibleRegion().GetNumberOfPixels();
+        m_checkpoint       = std::make_unique<Checkpoint>(
+            m_checkpointPath, nvoxels, m_checkpointInterval, m_verbose);
+        ForEachOutput("", [this](auto *image, std::string const &) {
+            m_checkpoint->addBuffer(image->GetBufferPointer(), PixelBytes(image));
+        });
+        if (m_resume && m_checkpoint->load() > 0) {
+            queue.removeIf([this](auto const offset) { return m_checkpoint->done(offset); });
+        }
+        m_checkpoint->start();
+    }
 
-        std::vector<itk::ImageRegionConstIterator<TInputImage>> input_iters(ModelType::NI);
-        std::vector<itk::ImageRegionIterator<TResidualsImage>>  residuals_iters(ModelType::NI);
+    /*
+     * Per-thread scratch space. Each chunk of masked voxels taken from the queue is gathered into
+     * a tile with one column per voxel (inputs) or per voxel/block slot (outputs), fitted, and then
+     * scattered back to the output buffers. Everything is sized once so that the voxel loop never
+     * touches the allocator. Voxels outside the mask are never visited and keep the zero value
+     * that Allocate(true) gave them in GenerateOutputInformation.
+     */
+    struct VoxelTile {
+        using DataBlock  = Eigen::Array<DataType, Eigen::Dynamic, Eigen::Dynamic>;
+        using ParamBlock = Eigen::Array<ParameterType, Eigen::Dynamic, Eigen::Dynamic>;
+
+        int                               count = 0;
+        std::vector<TIndex>               indices;
+        std::vector<itk::OffsetValueType> offsets;
+
+        std::vector<DataBlock>                  data, residuals;
+        ParamBlock                              fixed, varying, derived, covar;
+        std::vector<RMSErrorType>               rmse;
+        std::vector<typename FitType::FlagType> flags;
+        std::vector<char>                       good;  // Suitable as a warm start
+        std::vector<float>                      times; // Solve time per voxel (ns)
+
+        // Arguments to FitType::fit(), re-used for every slot
+        std::vector<DataArray>           fit_inputs;
+        std::vector<ResidualArray>       fit_residuals; // Left empty if not requested
+        FixedArray                       fit_fixed;
+        VaryingArray                     fit_varying;
+        typename ModelType::DerivedArray fit_derived;
+        CovarArray                       fit_covar;
+
+        // Raw buffer pointers, fetched once per thread
+        std::vector<InputPixelType const *>               input_ptrs;
+        std::array<FixedPixelType const *, ModelType::NF> fixed_ptrs;
+        std::array<OutputPixelType *, ModelType::NV>      varying_ptrs;
+        std::array<OutputPixelType *, ModelType::ND>      derived_ptrs;
+        std::array<OutputPixelType *, ModelType::NCov>    covar_ptrs;
+        std::vector<InputPixelType *>                     residual_ptrs;
+        typename FitType::FlagType *                      flag_ptr;
+        RMSErrorPixelType *                               rmse_ptr;
+        float *                                           time_ptr = nullptr;
+        TelemetryCounters *                               counters = nullptr;
+    };
+
+    VoxelTile MakeTile() {
+        VoxelTile tile;
+        const int nslots = m_tileSize * m_blocks;
+        tile.indices.resize(m_tileSize);
+        tile.offsets.resize(m_tileSize);
         for (int i = 0; i < ModelType::NI; i++) {
-            input_iters[i] = itk::ImageRegionConstIterator<TInputImage>(this->GetInput(i), region);
+            const int n = m_fit->input_size(i);
+            tile.data.emplace_back(n * m_blocks, m_tileSize);
+            tile.fit_inputs.emplace_back(n);
             if (m_allResiduals) {
-                residuals_iters[i] =
-                    itk::ImageRegionIterator<TResidualsImage>(this->GetResidualsOutput(i), region);
+                tile.residuals.emplace_back(n * m_blocks, m_tileSize);
+                tile.fit_residuals.emplace_back(n);
             }
-        }
-        std::array<itk::ImageRegionConstIterator<TFixedImage>, ModelType::NF> fixed_iters;
-        for (int i = 0; i < ModelType::NF; i++) {
-            typename TFixedImage::ConstPointer c = this->GetFixed(i);
-            if (c) {
-                fixed_iters[i] = itk::ImageRegionConstIterator<TFixedImage>(c, region);
+            tile.input_ptrs.push_back(this->GetInput(i)->GetBufferPointer());
+            if (m_allResiduals) {
+                tile.residual_ptrs.push_back(this->GetResidualsOutput(i)->GetBufferPointer());
             }
         }
-
-        std::array<itk::ImageRegionIterator<TOutputImage>, ModelType::NV> output_iters;
+        for (int f = 0; f < ModelType::NF; f++) {
+            auto const fimg    = this->GetFixed(f);
+            tile.fixed_ptrs[f] = fimg ? fimg->GetBufferPointer() : nullptr;
+        }
         for (int i = 0; i < ModelType::NV; i++) {
-            output_iters[i] = itk::ImageRegionIterator<TOutputImage>(this->GetOutput(i), region);
+            tile.varying_ptrs[i] = this->GetOutput(i)->GetBufferPointer();
         }
-
-        std::array<itk::ImageRegionIterator<TOutputImage>, ModelType::ND> derived_iters;
         if constexpr (HasDerived) {
             for (int i = 0; i < ModelType::ND; i++) {
-                derived_iters[i] =
-                    itk::ImageRegionIterator<TOutputImage>(this->GetDerivedOutput(i), region);
+                tile.derived_ptrs[i] = this->GetDerivedOutput(i)->GetBufferPointer();
             }
         }
-
-        std::array<itk::ImageRegionIterator<TOutputImage>, ModelType::NCov> covar_iters;
         if (m_covar) {
             for (int ii = 0; ii < ModelType::NCov; ii++) {
-                covar_iters[ii] =
-                    itk::ImageRegionIterator<TOutputImage>(this->GetCovarOutput(ii), region);
-            }
-        }
-
-        // Keep the index on this one to report voxel locations where algorithm fails.
-        itk::ImageRegionIteratorWithIndex<TRMSErrorImage> rmse_iter(this->GetRMSErrorOutput(),
-                                                                    region);
-        itk::ImageRegionIterator<TFlagImage>              flag_iter(this->GetFlagOutput(), region);
-
-        VaryingArray outputs;
-        FixedArray   fixed;
-        CovarArray * covar = m_covar ? new CovarArray : nullptr;
-
-        while (!input_iters[0].IsAtEnd()) {
-            if (!mask || mask_iter.Get()) {
-                for (int b = 0; b < m_blocks; b++) {
-                    std::vector<DataArray> inputs(ModelType::NI);
-                    for (int i = 0; i < ModelType::NI; i++) {
-                        auto input_data       = input_iters[i].Get();
-                        inputs[i]             = DataArray(m_fit->input_size(i));
-                        const int block_start = b * m_fit->input_size(i);
-                        for (Eigen::Index j = 0; j < m_fit->input_size(i); j++) {
-                            inputs[i][j] = input_data[j + block_start];
-                        }
-                    }
+                tile.covar_ptrs[ii] = this->GetCovarOutput(ii)->GetBufferPointer();
+            }
+        }
+        tile.flag_ptr = this->GetFlagOutput()->GetBufferPointer();
+        tile.rmse_ptr = this->GetRMSErrorOutput()->GetBufferPointer();
+        tile.fixed   = typename VoxelTile::ParamBlock(ModelType::NF, m_tileSize);
+        tile.varying = typename VoxelTile::ParamBlock(ModelType::NV, nslots);
+        tile.derived = typename VoxelTile::ParamBlock(ModelType::ND, nslots);
+        if (m_covar) {
+            tile.covar = typename VoxelTile::ParamBlock(ModelType::NCov, nslots);
+        }
+        tile.rmse.resize(nslots);
+        tile.flags.resize(nslots);
+        tile.good.resize(nslots);
+        if (m_telemetry) {
+            tile.times.resize(m_tileSize);
+            tile.time_ptr = m_timeImage->GetBufferPointer();
+            tile.counters = &m_telemetry->newCounters();
+        }
+        return tile;
+    }
 
-                    outputs = VaryingArray::Zero();
-                    if constexpr (ModelType::NF > 0) {
-                        fixed = m_fit->model.fixed_defaults;
-                        for (size_t i = 0; i < fixed_iters.size(); i++) {
-                            if (this->GetFixed(i)) {
-                                fixed[i] = fixed_iters[i].Get();
-                            }
-                        }
-                    }
-                    if (m_covar) {
-                        *covar = CovarArray::Zero();
-                    }
+    void ProcessTile(VoxelTile &tile) {
+        GatherTile(tile);
+        FitTile(tile);
+        ScatterTile(tile);
+        tile.count = 0;
+    }
 
-                    typename FitType::RMSErrorType rmse = 0;
-                    typename FitType::FlagType     flag = 0;
-                    std::vector<ResidualArray>     rs; // Leave size 0 if user doesn't want them
-                    if (m_allResiduals) {
-                        for (int i = 0; i < ModelType::NI; i++) {
-                            const int block_size = m_fit->input_size(i);
-                            rs.push_back(ResidualArray::Zero(block_size));
-                        }
+    void GatherTile(VoxelTile &tile) const {
+        for (int i = 0; i < ModelType::NI; i++) {
+            auto const *ptr = tile.input_ptrs[i];
+            auto &      dst = tile.data[i];
+            const auto  nc  = dst.rows();
+            for (int v = 0; v < tile.count; v++) {
+                auto const *src = ptr + tile.offsets[v] * nc;
+                for (Eigen::Index j = 0; j < nc; j++) {
+                    dst(j, v) = static_cast<DataType>(src[j]);
+                }
+            }
+        }
+        if constexpr (ModelType::NF > 0) {
+            for (int v = 0; v < tile.count; v++) {
+                tile.fixed.col(v) = m_fit->model.fixed_defaults;
+            }
+            for (int f = 0; f < ModelType::NF; f++) {
+                if (auto const *ptr = tile.fixed_ptrs[f]) {
+                    for (int v = 0; v < tile.count; v++) {
+                        tile.fixed(f, v) = ptr[tile.offsets[v]];
                     }
+                }
+            }
+        }
+    }
 
-                    QI::FitReturnType status;
-                    if constexpr (Blocked && Indexed) {
-                        status = m_fit->fit(
-                            inputs, fixed, outputs, covar, rmse, rs, flag, b, rmse_iter.GetIndex());
-                    } else if constexpr (Blocked) {
-                        status = m_fit->fit(inputs, fixed, outputs, covar, rmse, rs, flag, b);
-                    } else if constexpr (Indexed) {
-                        status = m_fit->fit(
-                            inputs, fixed, outputs, covar, rmse, rs, flag, rmse_iter.GetIndex());
-                    } else if constexpr (HasDerived) {
-                        typename ModelType::DerivedArray derived;
-                        status = m_fit->fit(inputs, fixed, outputs, derived, covar, rmse, rs, flag);
-                        for (int i = 0; i < ModelType::ND; i++) {
-                            derived_iters[i].Set(derived[i]);
-                        }
-                    } else {
-                        status = m_fit->fit(inputs, fixed, outputs, covar, rmse, rs, flag);
-                    }
+    void FitTile(VoxelTile &tile) const {
+        auto &inputs = tile.fit_inputs;
+        auto &fixed  = tile.fit_fixed;
+        auto &rs     = tile.fit_residuals;
+        auto *covar  = m_covar ? &tile.fit_covar : nullptr;
+        if constexpr (TileStart) {
+            static_assert(!Blocked, "Tile start points are only supported for unblocked fits");
+            m_fit->tileStart(tile.data, tile.fixed, tile.count, tile.varying);
+        }
+        for (int v = 0; v < tile.count; v++) {
+            using Clock      = std::chrono::steady_clock;
+            auto const begin = tile.counters ? Clock::now() : Clock::time_point{};
+            if constexpr (ModelType::NF > 0) {
+                fixed = tile.fixed.col(v);
+            }
+            for (int b = 0; b < m_blocks; b++) {
+                const int slot = v * m_blocks + b;
+                for (int i = 0; i < ModelType::NI; i++) {
+                    const int n = m_fit->input_size(i);
+                    inputs[i]   = tile.data[i].col(v).segment(b * n, n);
+                }
+                for (auto &r : rs) {
+                    r.setZero();
+                }
+                if (covar) {
+                    covar->setZero();
+                }
+                auto &outputs = tile.fit_varying;
+                if constexpr (TileStart) {
+                    outputs = tile.varying.col(slot);
+                } else if constexpr (WarmStart) {
+                    outputs = NeighbourStart(tile, v, b);
+                } else {
+                    outputs = NoWarmStart<VaryingArray>();
+                }
 
-                    if (!status.success && m_verbose) {
-                        QI::Warn(
-                            "Fit failed for voxel {}: {}", rmse_iter.GetIndex(), status.message);
-                    }
+                typename FitType::RMSErrorType rmse = 0;
+                typename FitType::FlagType     flag = 0;
+                QI::FitReturnType              status;
+                if constexpr (Blocked && Indexed) {
+                    status = m_fit->fit(
+                        inputs, fixed, outputs, covar, rmse, rs, flag, b, tile.indices[v]);
+                } else if constexpr (Blocked) {
+                    status = m_fit->fit(inputs, fixed, outputs, covar, rmse, rs, flag, b);
+                } else if constexpr (Indexed) {
+                    status =
+                        m_fit->fit(inputs, fixed, outputs, covar, rmse, rs, flag, tile.indices[v]);
+                } else if constexpr (HasDerived) {
+                    auto &derived = tile.fit_derived;
+                    derived       = ModelType::DerivedArray::Zero();
+                    status = m_fit->fit(inputs, fixed, outputs, derived, covar, rmse, rs, flag);
+                    tile.derived.col(slot) = derived;
+                } else {
+                    status = m_fit->fit(inputs, fixed, outputs, covar, rmse, rs, flag);
+                }
 
-                    if constexpr (Blocked) {
-                        flag_iter.Get()[b] = flag;
-                        rmse_iter.Get()[b] = rmse;
-                        for (int i = 0; i < ModelType::NV; i++) {
-                            output_iters[i].Get()[b] = outputs[i];
-                        }
-                    } else {
-                        flag_iter.Set(flag);
-                        rmse_iter.Set(rmse);
-                        for (int i = 0; i < ModelType::NV; i++) {
-                            output_iters[i].Set(outputs[i]);
-                        }
-                        if (m_covar) {
-                            for (int ii = 0; ii < ModelType::NCov; ii++) {
-                                covar_iters[ii].Set((*covar)[ii]);
-                            }
-                        }
-                    }
-                    if (m_allResiduals) {
-                        for (int i = 0; i < ModelType::NI; i++) {
-                            const int block_start = m_fit->input_size(i) * b;
-                            for (int j = 0; j < m_fit->input_size(i); j++) {
-                                residuals_iters[i].Get()[j + block_start] = rs[i][j];
-                            }
-                        }
-                    }
+                if (tile.counters) {
+                    tile.counters->addFit(
+                        std::max(0l, static_cast<long>(flag)), status.success, status.message);
+                } else if (!status.success && m_verbose) {
+                    QI::Warn("Fit failed for voxel {}: {}", tile.indices[v], status.message);
                 }
-            } else {
-                if constexpr (Blocked) {
-                    flag_iter.Get().Fill(0);
-                    rmse_iter.Get().Fill(0);
-                    for (auto &o : output_iters) {
-                        o.Get().Fill(0);
-                    }
-                } else {
-                    flag_iter.Set(0);
-                    flag_iter.Set(0);
-                    for (auto &o : output_iters) {
-                        o.Set(0);
-                    }
-                    if (m_covar) {
-                        for (auto &c : covar_iters) {
-                            c.Set(0);
-                        }
-                    }
+
+                if (!status.success && !outputs.allFinite()) {
+                    // Failed before writing a result, so do not leave the NaN start in the output
+                    outputs = outputs.isFinite().select(outputs, 0.0);
                 }
-                if constexpr (HasDerived) {
-                    for (auto &d : derived_iters) {
-                        d.Set(0);
-                    }
+                tile.varying.col(slot) = outputs;
+                tile.rmse[slot]        = rmse;
+                tile.flags[slot]       = flag;
+                if (m_warmStart) {
+                    tile.good[slot] =
+                        status.success && (rmse <= m_warmRMSE * inputs[0].abs().maxCoeff());
                 }
-                if (m_allResiduals) {
-                    for (auto &r : residuals_iters) {
-                        r.Get().Fill(0);
-                    }
+                if (covar) {
+                    tile.covar.col(slot) = *covar;
+                }
+                for (size_t i = 0; i < rs.size(); i++) {
+                    const int n = m_fit->input_size(i);
+                    tile.residuals[i].col(v).segment(b * n, n) = rs[i];
                 }
             }
+            if (tile.counters) {
+                auto const ns =
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin);
+                tile.times[v] = ns.count();
+                tile.counters->addVoxel(ns.count());
+            }
+        }
+    }
 
-            if (this->GetMask())
-                ++mask_iter;
-            for (int i = 0; i < ModelType::NI; i++) {
-                ++input_iters[i];
-                if (m_allResiduals)
-                    ++residuals_iters[i];
+    /*
+     * Find the start point for a voxel from the nearest earlier voxel in the tile that shares a
+     * face with it and was fitted well. Tiles are in raster order, so this is usually the previous
+     * voxel along the row.
+     */
+    VaryingArray NeighbourStart(VoxelTile const &tile, int const v, int const b) const {
+        if (m_warmStart) {
+            auto const &index = tile.indices[v];
+            for (int n = v - 1; n >= 0; n--) {
+                auto const &other = tile.indices[n];
+                long        dist  = 0;
+                for (int d = 0; d < ImageDim; d++) {
+                    dist += std::abs(index[d] - other[d]);
+                }
+                int const slot = n * m_blocks + b;
+                if (dist == 1 && tile.good[slot]) {
+                    return tile.varying.col(slot);
+                }
             }
-            for (int i = 0; i < ModelType::NF; i++) {
-                if (this->GetFixed(i))
-                    ++fixed_iters[i];
+        }
+        return NoWarmStart<VaryingArray>();
+    }
+
+    /*
+     * Write a row of the tile out to an image buffer. Blocked outputs are VectorImages with one
+     * component per block, which for m_blocks == 1 has the same layout as a plain Image.
+     */
+    template <typename TPixel, typename TRow>
+    void ScatterRow(TPixel *ptr, TRow const &row, VoxelTile const &tile) const {
+        for (int v = 0; v < tile.count; v++) {
+            TPixel *dst = ptr + tile.offsets[v] * m_blocks;
+            for (int b = 0; b < m_blocks; b++) {
+                dst[b] = static_cast<TPixel>(row[v * m_blocks + b]);
             }
-            for (int i = 0; i < ModelType::NV; i++) {
-                ++output_iters[i];
+        }
+    }
+
+    void ScatterTile(VoxelTile const &tile) const {
+        for (int i = 0; i < ModelType::NV; i++) {
+            ScatterRow(tile.varying_ptrs[i], tile.varying.row(i), tile);
+        }
+        if constexpr (HasDerived && !Blocked && !Indexed) {
+            for (int i = 0; i < ModelType::ND; i++) {
+                ScatterRow(tile.derived_ptrs[i], tile.derived.row(i), tile);
             }
-            if constexpr (HasDerived) {
-                for (auto &d : derived_iters) {
-                    ++d;
-                }
+        }
+        ScatterRow(tile.flag_ptr, tile.flags, tile);
+        ScatterRow(tile.rmse_ptr, tile.rmse, tile);
+        if (tile.time_ptr) {
+            for (int v = 0; v < tile.count; v++) {
+                tile.time_ptr[tile.offsets[v]] = tile.times[v];
             }
-            if (m_covar) {
-                for (auto &c : covar_iters) {
-                    ++c;
+        }
+        if (m_covar) {
+            for (int ii = 0; ii < ModelType::NCov; ii++) {
+                ScatterRow(tile.covar_ptrs[ii], tile.covar.row(ii), tile);
+            }
+        }
+        for (size_t i = 0; i < tile.residual_ptrs.size(); i++) {
+            auto const &src = tile.residuals[i];
+            const auto  nc  = src.rows();
+            for (int v = 0; v < tile.count; v++) {
+                InputPixelType *dst = tile.residual_ptrs[i] + tile.offsets[v] * nc;
+                for (Eigen::Index j = 0; j < nc; j++) {
+                    dst[j] = static_cast<InputPixelType>(src(j, v));
                 }
             }
-            ++flag_iter;
-            ++rmse_iter;
         }
     }
 }; // namespace QI
@@ -0,0 +1,297 @@
+#pragma once
+
+/*
+ *  ModelMonteCarloFilter.h
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include "itkImageToImageFilter.h"
+
+#include "FitFunction.h"
+#include "ImageTypes.h"
+#include "Model.h"
+#include "Util.h"
+#include "VoxelQueue.h"
+
+namespace QI {
+
+/*
+ *  Estimate the precision of a fit by simulating each voxel from its true parameters, adding
+ *  noise and fitting it again, many times over. The signals and fits never leave memory. The
+ *  estimates are accumulated with Welford's algorithm, and the outputs are the mean, standard
+ *  deviation and bias of each varying parameter followed by the number of failed fits.
+ *
+ *  The noise for realisation r of a voxel is the same as --simulate would add with the same seed
+ *  when r is 0, and independent of it otherwise.
+ */
+template <typename FitType>
+class ModelMonteCarloFilter : public itk::ImageToImageFilter<VolumeF, VolumeF> {
+  public:
+    using ModelType    = typename FitType::ModelType;
+    using DataArray    = QI_ARRAY(typename ModelType::DataType);
+    using VaryingArray = typename ModelType::VaryingArray;
+    using Self         = ModelMonteCarloFilter;
+    using Superclass   = itk::ImageToImageFilter<VolumeF, VolumeF>;
+    using Pointer      = itk::SmartPointer<Self>;
+    using RegionType   = typename VolumeF::RegionType;
+    QI_ForwardNewMacro(Self);
+    itkTypeMacro(Self, Superclass);
+
+    static_assert(!FitType::Blocked, "Monte Carlo is not supported for blocked fits");
+    static constexpr bool HasDerived = ModelType::ND > 0;
+    static constexpr bool TileStart  = requires { requires FitType::TileStart; };
+    static constexpr int  NOutputs   = 3 * ModelType::NV + 1;
+
+    // For fits that set start points for many voxels at once, the realisations are the tile
+    using DataBlock  = Eigen::Array<typename ModelType::DataType, -1, -1>;
+    using ParamBlock = Eigen::Array<typename ModelType::ParameterType, -1, -1>;
+
+    ModelMonteCarloFilter(FitType const *    fit,
+                          bool const         verbose,
+                          int const          nThreads,
+                          std::string const &subregion) :
+        m_fit{fit}, m_verbose{verbose} {
+        this->SetNumberOfRequiredInputs(ModelType::NV);
+        this->SetNumberOfRequiredOutputs(NOutputs);
+        for (int i = 0; i < NOutputs; i++) {
+            this->SetNthOutput(i, this->MakeOutput(i));
+        }
+        if (subregion != "") {
+            m_subregion    = RegionFromString<RegionType>(subregion);
+            m_hasSubregion = true;
+        }
+        this->DynamicMultiThreadingOn();
+        this->SetNumberOfWorkUnits(nThreads);
+    }
+
+    void SetVarying(int const i, VolumeF const *image) {
+        if (i < ModelType::NV) {
+            this->SetNthInput(i, const_cast<VolumeF *>(image));
+        } else {
+            QI::Fail("Requested varying input {} does not exist ({} inputs)", i, ModelType::NV);
+        }
+    }
+
+    void SetFixed(int const i, VolumeF const *image) {
+        if (i < ModelType::NF) {
+            this->SetNthInput(ModelType::NV + i, const_cast<VolumeF *>(image));
+        } else {
+            QI::Fail("Requested fixed input {} does not exist ({} inputs)", i, ModelType::NF);
+        }
+    }
+
+    VolumeF const *GetFixed(int const i) const {
+        return static_cast<VolumeF const *>(this->itk::ProcessObject::GetInput(ModelType::NV + i));
+    }
+
+    void SetMask(VolumeF const *mask) {
+        this->SetNthInput(ModelType::NV + ModelType::NF, const_cast<VolumeF *>(mask));
+    }
+
+    VolumeF const *GetMask() const {
+        return static_cast<VolumeF const *>(
+            this->itk::ProcessObject::GetInput(ModelType::NV + ModelType::NF));
+    }
+
+    VolumeF *GetMeanOutput(int const i) { return this->GetOutput(i); }
+    VolumeF *GetSDOutput(int const i) { return this->GetOutput(ModelType::NV + i); }
+    VolumeF *GetBiasOutput(int const i) { return this->GetOutput(2 * ModelType::NV + i); }
+    VolumeF *GetFailuresOutput() { return this->GetOutput(3 * ModelType::NV); }
+
+    void SetNoise(double const s) { m_sigma = s; }
+    void SetSeed(uint64_t const s) { m_seed = s; }
+    void SetRealisations(int const n) { m_realisations = n; }
+
+  protected:
+    FitType const *m_fit;
+    bool const     m_verbose;
+    double         m_sigma        = 0.0;
+    uint64_t       m_seed         = 0;
+    int            m_realisations = 100;
+    bool           m_hasSubregion = false;
+    RegionType     m_subregion;
+
+    ModelMonteCarloFilter(Self const &) = delete;
+    void operator=(Self const &) = delete;
+
+    void GenerateOutputInformation() override {
+        Superclass::GenerateOutputInformation();
+        auto const ip = this->GetInput(0);
+        for (int i = 1; i < ModelType::NV; i++) {
+            if (ip->GetLargestPossibleRegion() != this->GetInput(i)->GetLargestPossibleRegion()) {
+                QI::Fail("Input parameter images are not all the same size");
+            }
+        }
+        for (int f = 0; f < ModelType::NF; f++) {
+            auto const fp = this->GetFixed(f);
+            if (fp && (ip->GetLargestPossibleRegion() != fp->GetLargestPossibleRegion())) {
+                QI::Fail("Fixed parameter image {} is not the same size as the input", f);
+            }
+        }
+        auto const mp = this->GetMask();
+        if (mp && (ip->GetLargestPossibleRegion() != mp->GetLargestPossibleRegion())) {
+            QI::Fail("Mask image is not the same size as the input");
+        }
+        for (int i = 0; i < NOutputs; i++) {
+            auto op = this->GetOutput(i);
+            op->SetRegions(ip->GetLargestPossibleRegion());
+            op->SetSpacing(ip->GetSpacing());
+            op->SetOrigin(ip->GetOrigin());
+            op->SetDirection(ip->GetDirection());
+            op->Allocate(true);
+        }
+    }
+
+    void GenerateData() override {
+        auto region = this->GetInput(0)->GetLargestPossibleRegion();
+        if (m_hasSubregion) {
+            if (region.IsInside(m_subregion)) {
+                region = m_subregion;
+            } else {
+                QI::Fail("Specified subregion is not entirely inside image.");
+            }
+        }
+        VoxelQueue queue(this->GetInput(0), region, this->GetMask());
+        auto const nthreads = this->GetNumberOfWorkUnits();
+        queue.setChunkSize(nthreads, 64);
+        Info(m_verbose,
+             "Fitting {} realisations of {} voxels on {} threads...",
+             m_realisations,
+             queue.size(),
+             nthreads);
+        auto const loads =
+            ProcessQueue(queue, this->GetMultiThreader(), this, nthreads, [this, &queue]() {
+                return [this, &queue](size_t start, size_t end) {
+                    this->ProcessVoxels(queue.data() + start, queue.data() + end);
+                };
+            });
+        Info(m_verbose, "Finished Monte Carlo.");
+        LogThreadLoads(m_verbose, loads);
+    }
+
+    std::vector<DataArray> Signals(VaryingArray const &                  varying,
+                                   typename ModelType::FixedArray const &fixed) const {
+        if constexpr (ModelType::NI > 1) {
+            auto const             s = m_fit->model.signals(varying, fixed);
+            std::vector<DataArray> signals(s.begin(), s.end());
+            return signals;
+        } else {
+            return {m_fit->model.signal(varying, fixed)};
+        }
+    }
+
+    void ProcessVoxels(VoxelQueue::OffsetType const *begin, VoxelQueue::OffsetType const *end) {
+        std::array<float const *, ModelType::NV> truth_ptrs;
+        for (int i = 0; i < ModelType::NV; i++) {
+            truth_ptrs[i] = this->GetInput(i)->GetBufferPointer();
+        }
+        std::array<float const *, ModelType::NF> fixed_ptrs;
+        for (int i = 0; i < ModelType::NF; i++) {
+            auto const fixed_img = this->GetFixed(i);
+            fixed_ptrs[i]        = fixed_img ? fixed_img->GetBufferPointer() : nullptr;
+        }
+        std::array<float *, NOutputs> output_ptrs;
+        for (int i = 0; i < NOutputs; i++) {
+            output_ptrs[i] = this->GetOutput(i)->GetBufferPointer();
+        }
+
+        VaryingArray                     truth, varying, mean, m2;
+        typename ModelType::FixedArray   fixed;
+        typename ModelType::DerivedArray derived;
+        std::vector<DataArray>           inputs(ModelType::NI), residuals;
+        std::vector<DataBlock>           tile_data;
+        ParamBlock                       tile_fixed, tile_varying;
+        if constexpr (TileStart) {
+            for (int i = 0; i < ModelType::NI; i++) {
+                tile_data.emplace_back(m_fit->input_size(i), m_realisations);
+            }
+            tile_fixed.resize(ModelType::NF, m_realisations);
+            tile_varying.resize(ModelType::NV, m_realisations);
+        }
+        for (auto it = begin; it != end; it++) {
+            auto const offset = *it;
+            for (int i = 0; i < ModelType::NV; i++) {
+                truth[i] = truth_ptrs[i][offset];
+            }
+            if constexpr (ModelType::NF > 0) {
+                fixed = m_fit->model.fixed_defaults;
+                for (int i = 0; i < ModelType::NF; i++) {
+                    if (fixed_ptrs[i]) {
+                        fixed[i] = fixed_ptrs[i][offset];
+                    }
+                }
+            }
+            auto const signals = Signals(truth, fixed);
+            auto const noisy   = [&](int const r, int const i) {
+                NoiseStream stream(m_seed, offset, r * ModelType::NI + i);
+                return NoiseFromModelType<ModelType>::add_noise(signals[i], m_sigma, stream);
+            };
+            if constexpr (TileStart) {
+                for (int r = 0; r < m_realisations; r++) {
+                    for (int i = 0; i < ModelType::NI; i++) {
+                        tile_data[i].col(r) = noisy(r, i);
+                    }
+                    if constexpr (ModelType::NF > 0) {
+                        tile_fixed.col(r) = fixed;
+                    }
+                }
+                m_fit->tileStart(tile_data, tile_fixed, m_realisations, tile_varying);
+            }
+
+            mean.setZero();
+            m2.setZero();
+            int good = 0, failures = 0;
+            for (int r = 0; r < m_realisations; r++) {
+                if constexpr (TileStart) {
+                    for (int i = 0; i < ModelType::NI; i++) {
+                        inputs[i] = tile_data[i].col(r);
+                    }
+                    varying = tile_varying.col(r);
+                } else {
+                    for (int i = 0; i < ModelType::NI; i++) {
+                        inputs[i] = noisy(r, i);
+                    }
+                    varying = NoWarmStart<VaryingArray>();
+                }
+                typename FitType::RMSErrorType rmse = 0;
+                typename FitType::FlagType     flag = 0;
+                FitReturnType                  status;
+                if constexpr (FitType::Indexed) {
+                    auto const index = this->GetInput(0)->ComputeIndex(offset);
+                    status =
+                        m_fit->fit(inputs, fixed, varying, nullptr, rmse, residuals, flag, index);
+                } else if constexpr (HasDerived) {
+                    status =
+                        m_fit->fit(inputs, fixed, varying, derived, nullptr, rmse, residuals, flag);
+                } else {
+                    status = m_fit->fit(inputs, fixed, varying, nullptr, rmse, residuals, flag);
+                }
+                if (!status.success || !varying.allFinite()) {
+                    failures++;
+                    continue;
+                }
+                good++;
+                VaryingArray const delta = varying - mean;
+                mean += delta / good;
+                m2 += delta * (varying - mean);
+            }
+
+            for (int i = 0; i < ModelType::NV; i++) {
+                double const sd   = good > 1 ? std::sqrt(m2[i] / (good - 1)) : 0.;
+                double const bias = good > 0 ? mean[i] - truth[i] : 0.;
+                output_ptrs[i][offset]                     = mean[i];
+                output_ptrs[ModelType::NV + i][offset]     = sd;
+                output_ptrs[2 * ModelType::NV + i][offset] = bias;
+            }
+            output_ptrs[3 * ModelType::NV][offset] = failures;
+        }
+    }
+};
+
+} // namespace QI
@@ -20,6 +20,7 @@
 #include "ImageTypes.h"
 #include "Model.h"
 #include "Util.h"
+#include "VoxelQueue.h"
 
 namespace QI {
 
@@ -118,6 +119,7 @@ class ModelSimFilter
     }
 
     void SetNoise(const double s) { m_sigma = s; }
+    void SetSeed(const uint64_t s) { m_seed = s; }
 
   private:
     ModelSimFilter(const Self &); // purposely not implemented
@@ -126,6 +128,7 @@ class ModelSimFilter
   protected:
     ModelType  m_model;
     double     m_sigma = 0.0;
+    uint64_t   m_seed  = 0;
     const bool m_verbose;
     bool       m_hasSubregion = false;
     RegionType m_subregion;
@@ -156,6 +159,17 @@ class ModelSimFilter
                 QI::Fail("Input parameter images are not all the same size");
             }
         }
+        // Voxels are addressed by buffer offset, so fixed maps and the mask must match as well
+        for (int f = 0; f < ModelType::NF; f++) {
+            const auto fp = this->GetFixed(f);
+            if (fp && (ip->GetLargestPossibleRegion() != fp->GetLargestPossibleRegion())) {
+                QI::Fail("Fixed parameter image {} is not the same size as the input", f);
+            }
+        }
+        const auto mp = this->GetMask();
+        if (mp && (ip->GetLargestPossibleRegion() != mp->GetLargestPossibleRegion())) {
+            QI::Fail("Mask image is not the same size as the input");
+        }
 
         for (size_t i = 0; i < this->GetNumberOfRequiredOutputs(); i++) {
             const auto op = this->GetOutput(i);
@@ -182,100 +196,78 @@ class ModelSimFilter
             }
         }
 
-        Info(m_verbose, "Simulating...");
-        this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
-        this->GetMultiThreader()->template ParallelizeImageRegion<ImageDim>(
-            region,
-            [this](const RegionType &outputRegion) {
-                this->DynamicThreadedGenerateData(outputRegion);
-            },
-            this);
+        VoxelQueue queue(this->GetInput(0), region, this->GetMask().GetPointer());
+        auto const nthreads = this->GetNumberOfWorkUnits();
+        queue.setChunkSize(nthreads, 1024);
+        Info(m_verbose,
+             "Simulating {} voxels in chunks of {} on {} threads...",
+             queue.size(),
+             queue.chunkSize(),
+             nthreads);
+        auto const loads =
+            ProcessQueue(queue, this->GetMultiThreader(), this, nthreads, [this, &queue]() {
+                return [this, &queue](size_t start, size_t end) {
+                    this->SimulateVoxels(queue.data() + start, queue.data() + end);
+                };
+            });
         Info(m_verbose, "Finished simulating.");
+        LogThreadLoads(m_verbose, loads);
     }
 
-    void DynamicThreadedGenerateData(const RegionType &region) override {
-        std::vector<itk::ImageRegionConstIterator<QI::VolumeF>> varying_iters(ModelType::NV);
+    /*
+     * Voxels outside the mask are never visited, they keep the zero value from Allocate(true)
+     */
+    void SimulateVoxels(VoxelQueue::OffsetType const *begin, VoxelQueue::OffsetType const *end) {
+        std::array<float const *, ModelType::NV> varying_ptrs;
         for (int i = 0; i < ModelType::NV; i++) {
-            varying_iters[i] =
-                itk::ImageRegionConstIterator<QI::VolumeF>(this->GetInput(i), region);
+            varying_ptrs[i] = this->GetInput(i)->GetBufferPointer();
         }
-        std::vector<itk::ImageRegionConstIterator<QI::VolumeF>> fixed_iters(ModelType::NF);
+        std::array<float const *, ModelType::NF> fixed_ptrs;
         for (int i = 0; i < ModelType::NF; i++) {
-            if (this->GetFixed(i)) {
-                fixed_iters[i] =
-                    itk::ImageRegionConstIterator<QI::VolumeF>(this->GetFixed(i), region);
-            }
-        }
-
-        itk::ImageRegionConstIterator<QI::VolumeF> mask_iter;
-        const auto                                 mask = this->GetMask();
-        if (mask) {
-            mask_iter = itk::ImageRegionConstIterator<QI::VolumeF>(mask, region);
+            auto const fixed_img = this->GetFixed(i);
+            fixed_ptrs[i]        = fixed_img ? fixed_img->GetBufferPointer() : nullptr;
         }
-
-        std::vector<itk::ImageRegionIterator<OutputImageType>> output_iters(
-            this->GetNumberOfRequiredOutputs());
-        for (size_t i = 0; i < this->GetNumberOfRequiredOutputs(); i++) {
-            output_iters[i] = itk::ImageRegionIterator<OutputImageType>(this->GetOutput(i), region);
+        std::vector<OutputPixelType *> output_ptrs(this->GetNumberOfRequiredOutputs());
+        std::vector<size_t>            output_sizes(this->GetNumberOfRequiredOutputs());
+        for (size_t i = 0; i < output_ptrs.size(); i++) {
+            output_ptrs[i]  = this->GetOutput(i)->GetBufferPointer();
+            output_sizes[i] = this->GetOutput(i)->GetNumberOfComponentsPerPixel();
         }
 
-        while (!output_iters[0].IsAtEnd()) {
-            if (!mask || mask_iter.Get()) {
-                QI_ARRAYN(double, ModelType::NV) varying;
-                for (int i = 0; i < ModelType::NV; i++) {
-                    varying[i] = varying_iters[i].Get();
-                }
+        auto write = [&](size_t const i, VoxelQueue::OffsetType const offset, auto const &signal) {
+            // Noise depends only on the seed and the voxel, not on which thread simulates it
+            NoiseStream      stream(m_seed, offset, i);
+            auto const       output =
+                NoiseFromModelType<ModelType>::add_noise(signal, m_sigma, stream);
+            OutputPixelType *dst    = output_ptrs[i] + offset * output_sizes[i];
+            for (size_t j = 0; j < output_sizes[i]; j++) {
+                dst[j] = static_cast<OutputPixelType>(output[j]);
+            }
+        };
 
-                typename ModelType::FixedArray fixed;
-                if constexpr (ModelType::NF > 0) {
-                    fixed = m_model.fixed_defaults;
-                    for (int i = 0; i < ModelType::NF; i++) {
-                        if (this->GetFixed(i)) {
-                            fixed[i] = fixed_iters[i].Get();
-                        }
+        QI_ARRAYN(double, ModelType::NV) varying;
+        typename ModelType::FixedArray   fixed;
+        for (auto it = begin; it != end; it++) {
+            auto const offset = *it;
+            for (int i = 0; i < ModelType::NV; i++) {
+                varying[i] = varying_ptrs[i][offset];
+            }
+            if constexpr (ModelType::NF > 0) {
+                fixed = m_model.fixed_defaults;
+                for (int i = 0; i < ModelType::NF; i++) {
+                    if (fixed_ptrs[i]) {
+                        fixed[i] = fixed_ptrs[i][offset];
                     }
                 }
+            }
 
-                if constexpr (MultiOutput) {
-                    const auto signals = m_model.signals(varying, fixed);
-                    for (size_t i = 0; i < signals.size(); i++) {
-                        const auto output =
-                            NoiseFromModelType<ModelType>::add_noise(signals[i], m_sigma);
-                        const auto output_io = output.template cast<OutputPixelType>().eval();
-                        itk::VariableLengthVector<OutputPixelType> data_out(output_io.data(),
-                                                                            output_io.rows());
-                        output_iters[i].Set(data_out);
-                    }
-                } else {
-                    const auto signal = m_model.signal(varying, fixed);
-                    const auto output = NoiseFromModelType<ModelType>::add_noise(signal, m_sigma);
-                    const auto output_io = output.template cast<OutputPixelType>().eval();
-                    itk::VariableLengthVector<OutputPixelType> data_out(output_io.data(),
-                                                                        output_io.rows());
-                    output_iters[0].Set(data_out);
+            if constexpr (MultiOutput) {
+                const auto signals = m_model.signals(varying, fixed);
+                for (size_t i = 0; i < signals.size(); i++) {
+                    write(i, offset, signals[i]);
                 }
             } else {
-                if constexpr (MultiOutput) {
-                    for (auto &o : output_iters) {
-                        o.Get().Fill(0);
-                    }
-                } else {
-                    output_iters[0].Get().Fill(0);
-                }
-            }
-            if (mask) {
-                ++mask_iter;
-            }
-            for (int i = 0; i < ModelType::NV; i++) {
-                ++varying_iters[i];
-            }
-            for (int i = 0; i < ModelType::NF; i++) {
-                if (this->GetFixed(i)) {
-                    ++fixed_iters[i];
-                }
-            }
-            for (size_t i = 0; i < this->GetNumberOfRequiredOutputs(); i++) {
-                ++output_iters[i];
+                write(0, offset, m_model.signal(varying, fixed));
             }
         }
     }
@@ -0,0 +1,105 @@
+/*
+ *  Philox.h - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#include <Eigen/Core>
+
+namespace QI {
+
+/*
+ *  The Philox4x32-10 counter-based generator (Salmon et al, SC11). Each block of four 32-bit
+ *  outputs is a pure function of a 128-bit counter and a 64-bit key, so there is no state to
+ *  share between threads and any sample can be regenerated on its own.
+ */
+struct Philox4x32 {
+    using Block = std::array<uint32_t, 4>;
+    using Key   = std::array<uint32_t, 2>;
+
+    static Block Generate(Block c, Key k) {
+        for (int r = 0; r < 10; r++) {
+            uint64_t const p0 = uint64_t{0xD2511F53} * c[0];
+            uint64_t const p1 = uint64_t{0xCD9E8D57} * c[2];
+            c = {static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k[0],
+                 static_cast<uint32_t>(p1),
+                 static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k[1],
+                 static_cast<uint32_t>(p0)};
+            k[0] += 0x9E3779B9;
+            k[1] += 0xBB67AE85;
+        }
+        return c;
+    }
+};
+
+/*
+ *  Noise for one stream of samples, for example one output of one voxel. The samples depend
+ *  only on the seed, the stream and their position in the stream, so simulations give the same
+ *  result for any number of threads.
+ */
+class NoiseStream {
+  public:
+    NoiseStream(uint64_t const seed, uint64_t const stream, uint32_t const substream = 0) :
+        m_key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)},
+        m_stream{static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)},
+        m_substream{substream} {}
+
+    // Uniform on the open interval (0, 1), with 53 random bits
+    void uniform(Eigen::Ref<Eigen::ArrayXd> u) {
+        for (Eigen::Index i = 0; i < u.rows(); i += 2) {
+            auto const b = next();
+            u[i]         = ToDouble(b[0], b[1]);
+            if (i + 1 < u.rows()) {
+                u[i + 1] = ToDouble(b[2], b[3]);
+            }
+        }
+    }
+
+    /*
+     *  Standard normal by the Box-Muller transform. Each pair of uniforms gives a cosine and a
+     *  sine sample, and the transcendentals are whole-array operations so Eigen vectorises them.
+     */
+    void normal(Eigen::Ref<Eigen::ArrayXd> n) {
+        thread_local Eigen::ArrayXd u, v;
+        Eigen::Index const          m = (n.rows() + 1) / 2;
+        u.resize(m);
+        v.resize(m);
+        for (Eigen::Index i = 0; i < m; i++) {
+            auto const b = next();
+            u[i]         = ToDouble(b[0], b[1]);
+            v[i]         = ToDouble(b[2], b[3]);
+        }
+        u                    = (-2. * u.log()).sqrt();
+        v                    = (2. * M_PI) * v;
+        n.head(m)            = u * v.cos();
+        n.tail(n.rows() - m) = (u * v.sin()).head(n.rows() - m);
+    }
+
+  protected:
+    Philox4x32::Key const         m_key;
+    std::array<uint32_t, 2> const m_stream;
+    uint32_t const                m_substream;
+    uint32_t                      m_counter = 0;
+
+    Philox4x32::Block next() {
+        return Philox4x32::Generate({m_counter++, m_substream, m_stream[0], m_stream[1]}, m_key);
+    }
+
+    static double ToDouble(uint32_t const hi, uint32_t const lo) {
+        uint64_t const bits = ((uint64_t{hi} << 32) | lo) >> 11;
+        return (bits + 0.5) * 0x1.0p-53;
+    }
+};
+
+} // namespace QI
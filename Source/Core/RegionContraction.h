@@ -16,11 +16,14 @@
 #include <random>
 #include <vector>
 
+#include <algorithm>
 #include <atomic>
 #include <cmath>
+#include <optional>
 
 #include <Eigen/Core>
 
+#include "Sobol.h"
 #include "Util.h"
 
 namespace QI {
@@ -50,9 +53,13 @@ enum class RCStatus {
     NoImprovement,
     IterationLimit,
     ErrorInvalid,
-    ErrorResidual
+    ErrorResidual,
+    Stabilised
 };
 
+// Random draws i.i.d. samples, Sobol uses a scrambled low-discrepancy sequence
+enum class RCSampler { Random, Sobol };
+
 std::ostream &operator<<(std::ostream &os, const RCStatus &s) {
     switch (s) {
     case RCStatus::NotStarted:
@@ -73,20 +80,49 @@ std::ostream &operator<<(std::ostream &os, const RCStatus &s) {
     case RCStatus::ErrorResidual:
         os << "Infinite residual found";
         break;
+    case RCStatus::Stabilised:
+        os << "Retained samples stabilised";
+        break;
     }
     return os;
 }
 
+/*
+ *  The functor must provide inputs(), constraint(sample) and operator()(sample), which returns the
+ *  cost for one sample. If it also provides batch(samples, costs), where samples has one candidate
+ *  per column, then each contraction evaluates all of its samples with a single call to that
+ *  instead, so the functor can share work between samples.
+ *
+ *  With an adaptive schedule the number of samples drawn shrinks in proportion to the widest
+ *  remaining parameter range, and contraction stops early once the best and worst retained costs
+ *  both change by less than 1%.
+ */
 template <typename Functor_t> class RegionContraction {
   private:
+    static constexpr bool HasBatch =
+        requires(Functor_t &f, Eigen::ArrayXXd const &s, Eigen::ArrayXd &r) { f.batch(s, r); };
+
     Functor_t &     m_f;
     std::mt19937_64 m_rng;
     Eigen::ArrayXXd m_startBounds, m_currentBounds;
     Eigen::ArrayXd  m_threshes;
     size_t          m_nS, m_nR, m_maxContractions, m_contractions;
     double          m_expand, m_SoS;
+    size_t          m_evaluations = 0;
     RCStatus        m_status;
-    bool            m_gaussian, m_debug;
+    RCSampler       m_sampler = RCSampler::Random;
+    bool            m_gaussian, m_debug, m_adaptive = false;
+
+    // Samples to draw for the next contraction
+    size_t sampleCount() const {
+        if (!m_adaptive) {
+            return m_nS;
+        }
+        Eigen::ArrayXd const start = startWidth();
+        double const         frac  = (start > 0.).select(width() / start, 0.).maxCoeff();
+        size_t const         lower = std::min(m_nS, std::max(4 * m_nR, m_nS / 8));
+        return std::clamp(static_cast<size_t>(std::ceil(frac * m_nS)), lower, m_nS);
+    }
 
   public:
     RegionContraction(Functor_t &f, const Eigen::ArrayXd &loBounds, const Eigen::ArrayXd &hiBounds,
@@ -124,7 +160,10 @@ template <typename Functor_t> class RegionContraction {
         eigen_assert((t >= 0.).all() && (t <= 1.).all());
         m_threshes = t;
     }
+    void                   setSampler(RCSampler const s) { m_sampler = s; }
+    void                   setAdaptive(bool const a) { m_adaptive = a; }
     size_t                 contractions() const { return m_contractions; }
+    size_t                 evaluations() const { return m_evaluations; }
     RCStatus               status() const { return m_status; }
     const Eigen::ArrayXXd &currentBounds() const { return m_currentBounds; }
     double                 SoS() const { return m_SoS; }
@@ -140,13 +179,14 @@ template <typename Functor_t> class RegionContraction {
 
         eigen_assert(m_f.inputs() == params.size());
         int                 nP = static_cast<int>(params.size());
-        Eigen::ArrayXXd     samples(m_f.inputs(), m_nS);
+        Eigen::ArrayXXd     samples;
         Eigen::ArrayXXd     retained(m_f.inputs(), m_nR);
-        Eigen::ArrayXd      residuals(m_nS);
+        Eigen::ArrayXd      residuals;
         Eigen::ArrayXd      retainedRes(m_nR);
         Eigen::ArrayXd      gauss_mu(m_f.inputs()), gauss_sigma(m_f.inputs());
         std::vector<size_t> indices(m_nR);
         m_currentBounds = m_startBounds;
+        m_evaluations   = 0;
         if ((m_startBounds != m_startBounds).any() ||
             (m_startBounds >= std::numeric_limits<double>::infinity()).any() ||
             (m_startBounds.col(1) < m_startBounds.col(0)).any()) {
@@ -171,33 +211,53 @@ template <typename Functor_t> class RegionContraction {
         }
 
         std::uniform_real_distribution<double> uniform(0., 1.);
+        std::normal_distribution<double>       normal(0., 1.);
+        Eigen::ArrayXd                         tempSample(nP), lo(nP), w(nP), u(nP);
+        std::optional<SobolSequence>           sobol;
+        if (m_sampler == RCSampler::Sobol) {
+            sobol.emplace(nP, m_rng);
+        }
         m_status = RCStatus::IterationLimit;
         for (m_contractions = 0; m_contractions < m_maxContractions; m_contractions++) {
-            size_t startSample = 0;
-            /*if (m_contractions > 0) {
-                    // Keep the retained samples to prevent boundary contracting too fast
-                    for (size_t s = 0; s < m_nR; s++) {
-                            samples.col(s) = retained.col(s);
-                            residuals.col(s) = retainedRes.col(s);
-                    }
-                    startSample = m_nR;
-            }*/
-            for (size_t s = startSample; s < m_nS; s++) {
-                Eigen::ArrayXd tempSample(nP);
-                size_t         nTries = 0;
+            size_t const nS = sampleCount();
+            samples.resize(nP, nS);
+            residuals.resize(nS);
+            lo = m_currentBounds.col(0);
+            w  = width();
+            if (sobol && m_contractions > 0) {
+                sobol->scramble(m_rng);
+            }
+            // Draw all the samples first, so that functors with a batch interface can evaluate
+            // them in one call
+            for (size_t s = 0; s < nS; s++) {
+                size_t nTries = 0;
                 do {
+                    if (sobol) {
+                        sobol->next(u);
+                    }
                     if (!m_gaussian || (m_contractions == 0)) {
                         for (int p = 0; p < nP; p++) {
-                            tempSample(p) = uniform(m_rng);
+                            tempSample(p) = lo(p) + w(p) * (sobol ? u(p) : uniform(m_rng));
+                        }
+                    } else if (sobol) {
+                        // Invert the CDF of the normal truncated to the current bounds
+                        for (int p = 0; p < nP; p++) {
+                            double const mu = gauss_mu(p), sigma = gauss_sigma(p);
+                            double const blo = m_currentBounds(p, 0), bhi = m_currentBounds(p, 1);
+                            if (std::isfinite(sigma) && sigma > 0.) {
+                                double const a = NormalCDF((blo - mu) / sigma);
+                                double const b = NormalCDF((bhi - mu) / sigma);
+                                tempSample(p)  = std::clamp(
+                                    mu + sigma * InverseNormalCDF(a + u(p) * (b - a)), blo, bhi);
+                            } else {
+                                tempSample(p) = gauss_mu(p);
+                            }
                         }
-                        tempSample *= width();
-                        tempSample += m_currentBounds.col(0);
                     } else {
                         for (int p = 0; p < nP; p++) {
                             if (std::isfinite(gauss_sigma(p))) {
-                                std::normal_distribution<double> gauss(gauss_mu(p), gauss_sigma(p));
                                 do {
-                                    tempSample(p) = gauss(m_rng);
+                                    tempSample(p) = gauss_mu(p) + gauss_sigma(p) * normal(m_rng);
                                 } while ((tempSample(p) < m_currentBounds(p, 0)) ||
                                          (tempSample(p) > m_currentBounds(p, 1)));
                             } else {
@@ -222,8 +282,19 @@ template <typename Functor_t> class RegionContraction {
                         return false;
                     }
                 } while (!m_f.constraint(tempSample));
+                samples.col(s) = tempSample;
+            }
 
-                residuals[s] = m_f(tempSample);
+            if constexpr (HasBatch) {
+                m_f.batch(samples, residuals);
+            } else {
+                for (size_t s = 0; s < nS; s++) {
+                    tempSample   = samples.col(s);
+                    residuals[s] = m_f(tempSample);
+                }
+            }
+            m_evaluations += nS;
+            for (size_t s = 0; s < nS; s++) {
                 if (!std::isfinite(residuals[s])) {
                     warn_mtx.lock();
                     if (!finiteWarning) {
@@ -232,17 +303,18 @@ template <typename Functor_t> class RegionContraction {
                             << "Warning: Non-finite residual found!" << std::endl
                             << "Result may be meaningless. This warning will only be printed once."
                             << std::endl
-                            << "Parameters were " << tempSample.transpose() << std::endl;
+                            << "Parameters were " << samples.col(s).transpose() << std::endl;
                     }
                     warn_mtx.unlock();
                     params   = retained.col(0);
                     m_status = RCStatus::ErrorResidual;
                     return false;
                 }
-                samples.col(s) = tempSample;
             }
-            indices                     = index_partial_sort(residuals, m_nR);
-            Eigen::ArrayXd previousBest = retained.col(0);
+            indices                      = index_partial_sort(residuals, m_nR);
+            Eigen::ArrayXd previousBest     = retained.col(0);
+            double const   previousBestRes  = retainedRes(0);
+            double const   previousWorstRes = retainedRes(m_nR - 1);
             for (size_t i = 0; i < m_nR; i++) {
                 retained.col(i) = samples.col(indices[i]);
                 retainedRes(i)  = residuals(indices[i]);
@@ -283,6 +355,13 @@ template <typename Functor_t> class RegionContraction {
                 m_status = RCStatus::NoImprovement;
                 m_contractions++; // Just to give an accurate contraction count.
                 break;
+            } else if (m_adaptive && (m_contractions > 0) &&
+                       (std::abs(retainedRes(0) - previousBestRes) <= 0.01 * previousBestRes) &&
+                       (std::abs(retainedRes(m_nR - 1) - previousWorstRes) <=
+                        0.01 * previousWorstRes)) {
+                m_status = RCStatus::Stabilised;
+                m_contractions++; // Just to give an accurate contraction count.
+                break;
             }
 
             if (m_expand != 0) {
@@ -0,0 +1,68 @@
+/*
+ *  ScratchFile.cpp
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Log.h"
+#include "ScratchFile.h"
+
+namespace QI {
+
+ScratchFile::ScratchFile(std::string const &path) : m_path(path) {
+    m_fd = ::open(m_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (m_fd < 0) {
+        QI::Fail("Could not create scratch file {}: {}", m_path, std::strerror(errno));
+    }
+}
+
+ScratchFile::~ScratchFile() {
+    if (m_map) {
+        ::munmap(m_map, m_size);
+    }
+    ::close(m_fd);
+    ::unlink(m_path.c_str());
+}
+
+void ScratchFile::append(void const *data, size_t const bytes) {
+    if (m_map) {
+        QI::Fail("Cannot append to scratch file {} after it has been mapped", m_path);
+    }
+    auto const *src  = static_cast<char const *>(data);
+    size_t      done = 0;
+    while (done < bytes) {
+        auto const n = ::write(m_fd, src + done, bytes - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            QI::Fail("Could not write to scratch file {}: {}", m_path, std::strerror(errno));
+        }
+        done += n;
+    }
+    m_size += bytes;
+}
+
+void *ScratchFile::map() {
+    if (!m_map && m_size > 0) {
+        m_map = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, m_fd, 0);
+        if (m_map == MAP_FAILED) {
+            m_map = nullptr;
+            QI::Fail("Could not map scratch file {}: {}", m_path, std::strerror(errno));
+        }
+    }
+    return m_map;
+}
+
+} // namespace QI
@@ -0,0 +1,46 @@
+/*
+ *  ScratchFile.h
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include <string>
+
+namespace QI {
+
+/*
+ *  A temporary file that is built up by appending, then memory-mapped so that it can be read
+ *  back as a single buffer without holding it all in RAM. The file is deleted on destruction.
+ */
+class ScratchFile {
+  public:
+    explicit ScratchFile(std::string const &path);
+    ~ScratchFile();
+
+    ScratchFile(ScratchFile const &) = delete;
+    ScratchFile &operator=(ScratchFile const &) = delete;
+
+    void   append(void const *data, size_t const bytes);
+    size_t size() const { return m_size; }
+
+    /*
+     *  Map the whole file. The mapping is private, so writes to it do not reach the file, and stays
+     *  valid until the ScratchFile is destroyed. Nothing can be appended afterwards.
+     */
+    void *map();
+
+  protected:
+    std::string m_path;
+    int         m_fd   = -1;
+    size_t      m_size = 0;
+    void *      m_map  = nullptr;
+};
+
+} // namespace QI
@@ -14,6 +14,7 @@
 
 #include "ImageIO.h"
 #include "JSON.h"
+#include "ModelMonteCarloFilter.h"
 #include "ModelSimFilter.h"
 
 namespace QI {
@@ -27,12 +28,14 @@ void SimulateModel(json &                                    json,
                    bool const                                verbose,
                    double const                              noise,
                    int const                                 nThreads,
-                   std::string const &                       subRegion) {
+                   std::string const &                       subRegion,
+                   uint64_t const                            seed) {
     auto simulator = QI::ModelSimFilter<Model, MultiOutput>::New(model,
                                                                  verbose,
                                                                  nThreads,
                                                                  subRegion);
     simulator->SetNoise(noise);
+    simulator->SetSeed(seed);
     for (auto i = 0; i < Model::NV; i++) {
         const std::string vname = fmt::format("{}_map", model.varying_names[i]);
         const std::string vfile = json.at(vname).get<std::string>();
@@ -57,8 +60,7 @@ void SimulateModel(json &                                    json,
     if (mask_path != "") {
         simulator->SetMask(QI::ReadImage(mask_path, verbose));
     }
-    QI::Log(verbose, "Noise level is {}\nSimulating model...", noise);
-    srand((unsigned int)time(0));
+    QI::Log(verbose, "Noise level is {} with seed {}\nSimulating model...", noise, seed);
     simulator->Update();
     QI::Log(verbose, "Finished");
     if constexpr (MultiOutput) {
@@ -75,6 +77,68 @@ void SimulateModel(json &                                    json,
     }
 }
 
+/*
+ *  Simulate the parameter maps named in the JSON many times with noise, fit each realisation in
+ *  memory, and write the mean, SD and bias of each parameter and the number of failed fits
+ */
+template <typename FitType>
+void MonteCarloModel(json &                                         json,
+                     FitType const &                                fit,
+                     typename FitType::ModelType::FixedNames const &fixedpaths,
+                     std::string const &                            mask_path,
+                     bool const                                     verbose,
+                     double const                                   noise,
+                     int const                                      realisations,
+                     uint64_t const                                 seed,
+                     int const                                      nThreads,
+                     std::string const &                            subRegion,
+                     std::string const &                            prefix) {
+    using Model = typename FitType::ModelType;
+    if (realisations < 1) {
+        QI::Fail("Monte Carlo needs at least one realisation");
+    }
+    if (!(noise > 0)) {
+        QI::Fail("Monte Carlo needs --simulate with a noise level above zero");
+    }
+    auto mc = QI::ModelMonteCarloFilter<FitType>::New(&fit, verbose, nThreads, subRegion);
+    mc->SetNoise(noise);
+    mc->SetSeed(seed);
+    mc->SetRealisations(realisations);
+    for (auto i = 0; i < Model::NV; i++) {
+        const std::string vname = fmt::format("{}_map", fit.model.varying_names[i]);
+        const std::string vfile = json.at(vname).get<std::string>();
+        QI::Log(verbose, "Reading {} from file: {}", vname, vfile);
+        mc->SetVarying(i, QI::ReadImage(vfile, false));
+    }
+    if constexpr (Model::NF > 0) {
+        if (fixedpaths.size() != Model::NF) {
+            QI::Fail("Number of fixed paths {} does not match number of parameters {}",
+                     fixedpaths.size(),
+                     Model::NF);
+        }
+        for (auto i = 0; i < Model::NF; i++) {
+            if (fixedpaths[i].size() > 0) {
+                QI::Log(
+                    verbose, "Reading {} from file: {}", fit.model.fixed_names[i], fixedpaths[i]);
+                mc->SetFixed(i, QI::ReadImage(fixedpaths[i], false));
+            }
+        }
+    }
+    if (mask_path != "") {
+        mc->SetMask(QI::ReadImage(mask_path, verbose));
+    }
+    QI::Log(verbose, "Noise level is {} with seed {}", noise, seed);
+    mc->Update();
+    for (auto i = 0; i < Model::NV; i++) {
+        auto const &name = fit.model.varying_names[i];
+        QI::WriteImage(mc->GetMeanOutput(i), prefix + name + "_mc_mean" + QI::OutExt(), verbose);
+        QI::WriteImage(mc->GetSDOutput(i), prefix + name + "_mc_sd" + QI::OutExt(), verbose);
+        QI::WriteImage(mc->GetBiasOutput(i), prefix + name + "_mc_bias" + QI::OutExt(), verbose);
+    }
+    QI::WriteImage(mc->GetFailuresOutput(), prefix + "mc_failures" + QI::OutExt(), verbose);
+    QI::Log(verbose, "Finished");
+}
+
 } // End namespace QI
 
 #endif // SIMULATEMODEL_H
\ No newline at end of file
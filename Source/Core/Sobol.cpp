@@ -0,0 +1,141 @@
+/*
+ *  Sobol.cpp
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include <bit>
+#include <cmath>
+
+#include "Log.h"
+#include "Sobol.h"
+
+namespace QI {
+
+namespace {
+// Degree, coefficients and initial direction numbers for dimensions 2 onwards (Joe & Kuo, 2008)
+struct Primitive {
+    int                s;
+    uint32_t           a;
+    std::array<int, 6> m;
+};
+std::array<Primitive, SobolSequence::MaxDimensions - 1> const Primitives{
+    {{1, 0, {1}},           {2, 1, {1, 3}},          {3, 1, {1, 3, 1}},
+     {3, 2, {1, 1, 1}},     {4, 1, {1, 1, 3, 3}},    {4, 4, {1, 3, 5, 13}},
+     {5, 2, {1, 1, 5, 5, 17}},   {5, 4, {1, 1, 5, 5, 5}},    {5, 7, {1, 1, 7, 11, 19}},
+     {5, 11, {1, 1, 5, 1, 1}},   {5, 13, {1, 1, 1, 3, 11}},  {5, 14, {1, 3, 5, 5, 31}},
+     {6, 1, {1, 3, 3, 9, 7, 49}}, {6, 13, {1, 1, 1, 15, 21, 21}}, {6, 16, {1, 3, 1, 13, 27, 49}}}};
+} // namespace
+
+SobolSequence::SobolSequence(int const dimensions, std::mt19937_64 &rng) :
+    m_dims(dimensions), m_base(dimensions), m_directions(dimensions), m_x(dimensions) {
+    if (dimensions < 1 || dimensions > MaxDimensions) {
+        QI::Fail("Sobol sequences support 1 to {} dimensions, not {}", MaxDimensions, dimensions);
+    }
+    // Direction number k (from 0) holds the k+1'th binary digit in the top bits
+    for (int k = 0; k < 32; k++) {
+        m_base[0][k] = 1u << (31 - k);
+    }
+    for (int d = 1; d < m_dims; d++) {
+        auto const &p = Primitives[d - 1];
+        auto &      v = m_base[d];
+        for (int k = 0; k < p.s; k++) {
+            v[k] = static_cast<uint32_t>(p.m[k]) << (31 - k);
+        }
+        for (int k = p.s; k < 32; k++) {
+            v[k] = v[k - p.s] ^ (v[k - p.s] >> p.s);
+            for (int i = 1; i < p.s; i++) {
+                if ((p.a >> (p.s - 1 - i)) & 1) {
+                    v[k] ^= v[k - i];
+                }
+            }
+        }
+    }
+    scramble(rng);
+}
+
+void SobolSequence::scramble(std::mt19937_64 &rng) {
+    for (int d = 0; d < m_dims; d++) {
+        // Random lower-triangular matrix with a unit diagonal. Output digit b depends on input
+        // digit b and any of the more significant digits.
+        std::array<uint32_t, 32> rows;
+        for (int b = 0; b < 32; b++) {
+            uint32_t const higher = static_cast<uint32_t>(~0ull << (b + 1));
+            rows[b]               = (1u << b) | (static_cast<uint32_t>(rng()) & higher);
+        }
+        for (int k = 0; k < 32; k++) {
+            uint32_t v = 0;
+            for (int b = 0; b < 32; b++) {
+                v |= static_cast<uint32_t>(std::popcount(rows[b] & m_base[d][k]) & 1) << b;
+            }
+            m_directions[d][k] = v;
+        }
+        m_x[d] = static_cast<uint32_t>(rng()); // Digital shift
+    }
+    m_index = 0;
+}
+
+void SobolSequence::next(Eigen::Ref<Eigen::ArrayXd> point) {
+    for (int d = 0; d < m_dims; d++) {
+        point[d] = (m_x[d] + 0.5) / 4294967296.0;
+    }
+    // Gray code order, so each point differs from the last by a single direction number
+    int const c = std::countr_one(m_index);
+    if (c < 32) {
+        for (int d = 0; d < m_dims; d++) {
+            m_x[d] ^= m_directions[d][c];
+        }
+    }
+    m_index++;
+}
+
+double InverseNormalCDF(double const p) {
+    // Acklam's rational approximation
+    static double const a[] = {-3.969683028665376e+01,
+                               2.209460984245205e+02,
+                               -2.759285104469687e+02,
+                               1.383577518672690e+02,
+                               -3.066479806614716e+01,
+                               2.506628277459239e+00};
+    static double const b[] = {-5.447609879822406e+01,
+                               1.615858368580409e+02,
+                               -1.556989798598866e+02,
+                               6.680131188771972e+01,
+                               -1.328068155288572e+01};
+    static double const c[] = {-7.784894002430293e-03,
+                               -3.223964580411365e-01,
+                               -2.400758277161838e+00,
+                               -2.549732539343734e+00,
+                               4.374664141464968e+00,
+                               2.938163982698783e+00};
+    static double const d[] = {7.784695709041462e-03,
+                               3.224671290700398e-01,
+                               2.445134137142996e+00,
+                               3.754408661907416e+00};
+    double const        p_low = 0.02425;
+    if (p <= 0.) {
+        return -std::numeric_limits<double>::infinity();
+    } else if (p >= 1.) {
+        return std::numeric_limits<double>::infinity();
+    } else if (p < p_low) {
+        double const q = std::sqrt(-2 * std::log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    } else if (p <= 1 - p_low) {
+        double const q = p - 0.5;
+        double const r = q * q;
+        return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+               (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+    } else {
+        double const q = std::sqrt(-2 * std::log1p(-p));
+        return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+}
+
+} // namespace QI
@@ -0,0 +1,57 @@
+/*
+ *  Sobol.h
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace QI {
+
+/*
+ *  Scrambled Sobol low-discrepancy sequence in up to MaxDimensions dimensions, using the Joe & Kuo
+ *  direction numbers. Each call to scramble() applies a new random linear matrix scramble and
+ *  digital shift and restarts the sequence, so successive blocks of points are independent
+ *  randomisations that each keep the stratification of the Sobol points.
+ */
+class SobolSequence {
+  public:
+    static constexpr int MaxDimensions = 16;
+
+    SobolSequence(int const dimensions, std::mt19937_64 &rng);
+
+    void scramble(std::mt19937_64 &rng);
+    void next(Eigen::Ref<Eigen::ArrayXd> point); // Next point, each coordinate in (0, 1)
+
+  protected:
+    using Directions = std::array<uint32_t, 32>;
+
+    int                     m_dims;
+    uint32_t                m_index = 0;
+    std::vector<Directions> m_base, m_directions;
+    std::vector<uint32_t>   m_x;
+};
+
+/*
+ *  Inverse of the standard normal CDF, with a relative error below 1.2e-9. Used to map quasi-random
+ *  points to (truncated) normal distributions.
+ */
+double InverseNormalCDF(double const p);
+inline double NormalCDF(double const x) {
+    return 0.5 * std::erfc(-x / std::sqrt(2.));
+}
+
+} // namespace QI
@@ -12,6 +12,8 @@
 #include "Log.h"
 #include "Spline.h"
 
+#include <algorithm>
+#include <numeric>
 #include <set>
 
 namespace QI {
@@ -83,4 +85,95 @@ std::ostream &operator<<(std::ostream &ostr, const SplineInterpolator &sp) {
     return ostr;
 }
 
+BatchSplineInterpolator::BatchSplineInterpolator(Eigen::ArrayXd const &     x,
+                                                 const int                  order,
+                                                 std::vector<size_t> const &indices) {
+    if (x.size() == 0) {
+        QI::Fail("Cannot create a spline with no control points");
+    }
+    std::vector<size_t> sorted = indices;
+    if (sorted.size() == 0) {
+        sorted.resize(x.size());
+        std::iota(sorted.begin(), sorted.end(), 0);
+    }
+    const Eigen::Index n = sorted.size();
+    Eigen::ArrayXd     sx(n);
+    std::transform(sorted.begin(), sorted.end(), &sx[0], [&](std::size_t i) { return x[i]; });
+
+    m_min    = sx[0];
+    m_width  = sx[n - 1] - m_min;
+    m_degree = std::min<int>(n - 1, order);
+    const TSpline::KnotVectorType u = ((sx - m_min) / m_width).transpose();
+    Eigen::KnotAveraging(u, m_degree, m_knots);
+
+    // As in Eigen::SplineFitting::Interpolate, but solved for the identity
+    Eigen::MatrixXd A = Eigen::MatrixXd::Zero(n, n);
+    for (Eigen::Index i = 1; i < n - 1; i++) {
+        const auto span = TSpline::Span(u[i], m_degree, m_knots);
+        A.row(i).segment(span - m_degree, m_degree + 1) =
+            TSpline::BasisFunctions(u[i], m_degree, m_knots);
+    }
+    A(0, 0)                    = 1.0;
+    A(n - 1, n - 1)            = 1.0;
+    const Eigen::MatrixXd Ainv = A.householderQr().solve(Eigen::MatrixXd::Identity(n, n));
+    m_fit                      = Eigen::MatrixXd::Zero(n, x.size());
+    for (Eigen::Index i = 0; i < n; i++) {
+        m_fit.col(sorted[i]) = Ainv.col(i);
+    }
+}
+
+Eigen::MatrixXd BatchSplineInterpolator::fit(Eigen::MatrixXd const &y) const {
+    return m_fit * y;
+}
+
+double BatchSplineInterpolator::evaluate(Eigen::Ref<const Eigen::VectorXd> const &ctrls,
+                                         const double                             x) const {
+    const double sx    = (x - m_min) / m_width;
+    const auto   span  = TSpline::Span(sx, m_degree, m_knots);
+    const auto   basis = TSpline::BasisFunctions(sx, m_degree, m_knots);
+    return basis.matrix().dot(ctrls.segment(span - m_degree, m_degree + 1).transpose());
+}
+
+Eigen::MatrixXd BatchSplineInterpolator::weights(Eigen::ArrayXd const &x) const {
+    Eigen::MatrixXd W = Eigen::MatrixXd::Zero(x.rows(), m_fit.cols());
+    for (Eigen::Index i = 0; i < x.rows(); i++) {
+        const double sx    = (x[i] - m_min) / m_width;
+        const auto   span  = TSpline::Span(sx, m_degree, m_knots);
+        const auto   basis = TSpline::BasisFunctions(sx, m_degree, m_knots);
+        W.row(i) = basis.matrix() * m_fit.middleRows(span - m_degree, m_degree + 1);
+    }
+    return W;
+}
+
+namespace {
+Eigen::ArrayXd
+SampleSpline(SplineInterpolator const &spline, const double x0, const double step, const int size) {
+    Eigen::ArrayXd vals(size);
+    for (int i = 0; i < size; i++) {
+        vals[i] = spline(x0 + i * step);
+    }
+    return vals;
+}
+} // namespace
+
+SplineTable::SplineTable(SplineInterpolator const &spline,
+                         const double              x0,
+                         const double              x1,
+                         const int                 size) :
+    m_spline{spline},
+    m_size{size}, m_step{(x1 - x0) / (size - 3)}, m_min{x0 - m_step},
+    m_table{SampleSpline(spline, m_min, m_step, size)} {
+    if (size < 4) {
+        QI::Fail("Spline table must have at least 4 entries");
+    }
+}
+
+double SplineTable::operator()(const double x) const {
+    const double i = (x - m_min) / m_step;
+    if ((i < 1.0) || (i > m_size - 2.0)) {
+        return m_spline(x);
+    }
+    return m_table.Evaluate(i);
+}
+
 } // End namespace QI
\ No newline at end of file
@@ -12,6 +12,7 @@
 #ifndef QI_SPLINE_H
 #define QI_SPLINE_H
 
+#include "CubicTable.h"
 #include "Eigen/Core"
 #include <unsupported/Eigen/Splines>
 
@@ -44,6 +45,50 @@ class SplineInterpolator {
 
 std::ostream &operator<<(std::ostream &ostr, const SplineInterpolator &sp);
 
+/*
+ * The spline through a fixed set of abscissae is a linear operator on the ordinates. Build it
+ * once, then interpolate many datasets (one per column) with matrix multiplies instead of fitting
+ * a SplineInterpolator to each. The ordinates are in the original order, indices only sort them.
+ */
+class BatchSplineInterpolator {
+  public:
+    typedef SplineInterpolator::TSpline TSpline;
+
+    BatchSplineInterpolator(Eigen::ArrayXd const &     x,
+                            const int                  order   = 3,
+                            std::vector<size_t> const &indices = std::vector<size_t>());
+    // Control points, one column per dataset
+    Eigen::MatrixXd fit(Eigen::MatrixXd const &y) const;
+    // Value at x of the spline with the given control points
+    double evaluate(Eigen::Ref<const Eigen::VectorXd> const &ctrls, const double x) const;
+    // Operator mapping datasets to their values at each x, one row per x
+    Eigen::MatrixXd weights(Eigen::ArrayXd const &x) const;
+
+  protected:
+    TSpline::KnotVectorType m_knots;
+    int                     m_degree;
+    Eigen::MatrixXd         m_fit;
+    double                  m_min;
+    double                  m_width;
+};
+
+/*
+ * Samples a spline on a uniform grid, with one extra sample beyond each end, so it can be
+ * evaluated in constant time. Points outside the grid are passed to the spline itself.
+ */
+class SplineTable {
+  public:
+    SplineTable(SplineInterpolator const &spline, const double x0, const double x1, const int size);
+    double operator()(const double x) const;
+
+  protected:
+    SplineInterpolator m_spline;
+    int                m_size;
+    double             m_step;
+    double             m_min;
+    CubicTable         m_table;
+};
+
 } // End namespace QI
 
 #endif // QI_SPLINE_H
\ No newline at end of file
@@ -0,0 +1,109 @@
+/*
+ *  Telemetry.cpp
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include "Telemetry.h"
+#include "Log.h"
+
+namespace QI {
+
+namespace {
+json HistogramJSON(TelemetryCounters::Histogram const &hist) {
+    json bins = json::array();
+    for (size_t b = 0; b < hist.size(); b++) {
+        if (hist[b] > 0) {
+            uint64_t const lo = b ? (uint64_t{1} << (b - 1)) : 0;
+            uint64_t const hi = b ? (lo * 2 - 1) : 0;
+            bins.push_back({{"min", lo}, {"max", hi}, {"count", hist[b]}});
+        }
+    }
+    return bins;
+}
+} // namespace
+
+void TelemetryCounters::addFailure(std::string const &message) {
+    auto const reason = message.substr(0, std::min<size_t>(message.find('\n'), 120));
+    failures[reason.empty() ? "Unknown" : reason]++;
+}
+
+TelemetryCounters &Telemetry::newCounters() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_counters.push_back(std::make_unique<TelemetryCounters>());
+    return *m_counters.back();
+}
+
+void Telemetry::addLoads(std::vector<ThreadLoad> const &loads) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_loads.size() < loads.size()) {
+        m_loads.resize(loads.size());
+    }
+    for (size_t t = 0; t < loads.size(); t++) {
+        m_loads[t].voxels += loads[t].voxels;
+        m_loads[t].chunks += loads[t].chunks;
+        m_loads[t].seconds += loads[t].seconds;
+    }
+}
+
+void Telemetry::addTime(Stage const stage, double const seconds) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_seconds[static_cast<int>(stage)] += seconds;
+}
+
+TelemetryCounters Telemetry::merged() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    TelemetryCounters           all;
+    for (auto const &c : m_counters) {
+        for (size_t b = 0; b < all.time_ns.size(); b++) {
+            all.time_ns[b] += c->time_ns[b];
+            all.iterations[b] += c->iterations[b];
+        }
+        for (auto const &[reason, count] : c->failures) {
+            all.failures[reason] += count;
+        }
+        all.voxels += c->voxels;
+        all.fits += c->fits;
+    }
+    return all;
+}
+
+void Telemetry::logFailures(bool const verbose) const {
+    auto const all = merged();
+    for (auto const &[reason, count] : all.failures) {
+        Log(verbose, "{} of {} fits failed: {}", count, all.fits, reason);
+    }
+}
+
+json Telemetry::report() const {
+    auto const all = merged();
+    size_t     failed = 0;
+    for (auto const &[reason, count] : all.failures) {
+        failed += count;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    json                        threads = json::array();
+    for (auto const &l : m_loads) {
+        threads.push_back({{"voxels", l.voxels},
+                           {"chunks", l.chunks},
+                           {"seconds", l.seconds},
+                           {"voxels_per_second", l.seconds > 0 ? l.voxels / l.seconds : 0.0}});
+    }
+    return json{{"voxels", all.voxels},
+                {"fits", all.fits},
+                {"failed", failed},
+                {"failures", all.failures},
+                {"seconds",
+                 {{"read", m_seconds[0]}, {"fit", m_seconds[1]}, {"write", m_seconds[2]}}},
+                {"threads", threads},
+                {"time_ns", HistogramJSON(all.time_ns)},
+                {"iterations", HistogramJSON(all.iterations)}};
+}
+
+} // namespace QI
@@ -0,0 +1,101 @@
+/*
+ *  Telemetry.h
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "JSON.h"
+#include "VoxelQueue.h"
+
+namespace QI {
+
+/*
+ *  Counters filled in by a single worker thread, so that recording needs no locks. Histograms have
+ *  power-of-two bins, bin b holding values in [2^(b-1), 2^b) and bin 0 holding zero.
+ */
+struct TelemetryCounters {
+    using Histogram = std::array<size_t, 65>;
+    Histogram                     time_ns{}, iterations{};
+    std::map<std::string, size_t> failures;
+    size_t                        voxels = 0, fits = 0;
+
+    void addVoxel(uint64_t const ns) {
+        time_ns[std::bit_width(ns)]++;
+        voxels++;
+    }
+
+    void addFit(uint64_t const its, bool const success, std::string const &message) {
+        iterations[std::bit_width(its)]++;
+        fits++;
+        if (!success) {
+            addFailure(message);
+        }
+    }
+
+    // Failures are grouped by the first line of their message
+    void addFailure(std::string const &message);
+};
+
+/*
+ *  Optional performance report for ModelFitFilter. Collects the histograms and failure counts from
+ *  every worker, the load on each thread, and the time spent reading, fitting and writing.
+ */
+class Telemetry {
+  public:
+    enum class Stage { Read = 0, Fit, Write };
+
+    TelemetryCounters &newCounters(); // One set per worker, valid until the Telemetry is destroyed
+    void               addLoads(std::vector<ThreadLoad> const &loads);
+    void               addTime(Stage const stage, double const seconds);
+
+    void logFailures(bool const verbose) const; // Print how many fits failed for each reason
+    json report() const;
+
+  protected:
+    TelemetryCounters merged() const;
+
+    mutable std::mutex                              m_mutex;
+    std::vector<std::unique_ptr<TelemetryCounters>> m_counters;
+    std::vector<ThreadLoad>                         m_loads;
+    std::array<double, 3>                           m_seconds{};
+};
+
+/*
+ *  Adds the time until it goes out of scope to a stage. Does nothing if telemetry is null.
+ */
+class TelemetryTimer {
+  public:
+    TelemetryTimer(Telemetry *telemetry, Telemetry::Stage const stage) :
+        m_telemetry(telemetry), m_stage(stage), m_begin(std::chrono::steady_clock::now()) {}
+    ~TelemetryTimer() {
+        if (m_telemetry) {
+            m_telemetry->addTime(
+                m_stage,
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - m_begin).count());
+        }
+    }
+
+  protected:
+    Telemetry *                           m_telemetry;
+    Telemetry::Stage                      m_stage;
+    std::chrono::steady_clock::time_point m_begin;
+};
+
+} // namespace QI
@@ -0,0 +1,41 @@
+/*
+ *  VoxelQueue.cpp
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include "VoxelQueue.h"
+#include "Log.h"
+
+namespace QI {
+
+void LogThreadLoads(bool const verbose, std::vector<ThreadLoad> const &loads) {
+    if (!verbose || loads.empty()) {
+        return;
+    }
+    double max_seconds = 0, total_seconds = 0;
+    for (size_t t = 0; t < loads.size(); t++) {
+        auto const &l = loads[t];
+        Log(verbose,
+            "Thread {:3d}: {:8d} voxels in {:6d} chunks, {:.2f} s",
+            t,
+            l.voxels,
+            l.chunks,
+            l.seconds);
+        max_seconds = std::max(max_seconds, l.seconds);
+        total_seconds += l.seconds;
+    }
+    double const mean_seconds = total_seconds / loads.size();
+    Log(verbose,
+        "Thread time mean {:.2f} s, max {:.2f} s, imbalance {:.2f}",
+        mean_seconds,
+        max_seconds,
+        mean_seconds > 0 ? max_seconds / mean_seconds : 1.0);
+}
+
+} // namespace QI
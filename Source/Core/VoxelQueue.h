@@ -0,0 +1,133 @@
+/*
+ *  VoxelQueue.h
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "itkIndexRange.h"
+#include "itkMultiThreaderBase.h"
+#include "itkTotalProgressReporter.h"
+
+namespace QI {
+
+/*
+ *  A packed list of the buffer offsets of every voxel in a region that is inside the mask. The list
+ *  is handed out in small, contiguous chunks to whichever thread asks next, so a thread that lands
+ *  on expensive voxels does not hold up the others.
+ */
+class VoxelQueue {
+  public:
+    using OffsetType = itk::OffsetValueType;
+
+    template <typename TImage, typename TMask>
+    VoxelQueue(TImage const *                      ref,
+               typename TImage::RegionType const &region,
+               TMask const *                       mask) {
+        auto const *mask_ptr = mask ? mask->GetBufferPointer() : nullptr;
+        m_offsets.reserve(region.GetNumberOfPixels());
+        for (auto const &index : itk::ImageRegionIndexRange<TImage::ImageDimension>(region)) {
+            auto const offset = ref->ComputeOffset(index);
+            if (!mask_ptr || mask_ptr[offset]) {
+                m_offsets.push_back(offset);
+            }
+        }
+        m_offsets.shrink_to_fit();
+    }
+
+    size_t size() const { return m_offsets.size(); }
+    size_t chunkSize() const { return m_chunk; }
+
+    OffsetType const *data() const { return m_offsets.data(); }
+
+    /*
+     *  Drop voxels that do not need processing, e.g. those restored from a checkpoint. Must be
+     *  called before any chunks are handed out.
+     */
+    template <typename Pred> void removeIf(Pred &&pred) {
+        m_offsets.erase(std::remove_if(m_offsets.begin(), m_offsets.end(), pred), m_offsets.end());
+    }
+
+    /*
+     *  Pick a chunk size that gives each thread plenty of chunks to balance with, without making
+     *  the shared counter a bottleneck for cheap voxels
+     */
+    void setChunkSize(size_t const nthreads, size_t const max_chunk) {
+        m_chunk = std::clamp<size_t>(size() / (32 * std::max<size_t>(nthreads, 1)), 1, max_chunk);
+    }
+
+    /*
+     *  Claim the next chunk. Returns false when the queue is exhausted.
+     */
+    bool next(size_t &start, size_t &end) {
+        start = m_next.fetch_add(m_chunk, std::memory_order_relaxed);
+        if (start >= size()) {
+            return false;
+        }
+        end = std::min(start + m_chunk, size());
+        return true;
+    }
+
+  protected:
+    std::vector<OffsetType> m_offsets;
+    std::atomic<size_t>     m_next  = 0;
+    size_t                  m_chunk = 1;
+};
+
+struct ThreadLoad {
+    size_t voxels = 0, chunks = 0;
+    double seconds = 0;
+};
+
+/*
+ *  Print how the voxels were shared out between threads
+ */
+void LogThreadLoads(bool const verbose, std::vector<ThreadLoad> const &loads);
+
+/*
+ *  Drain the queue with nthreads workers. make_worker is called once on each thread and must
+ *  return a callable taking a [start, end) range of the queue, so per-thread scratch space can be
+ *  captured by the worker.
+ */
+template <typename MakeWorker>
+std::vector<ThreadLoad> ProcessQueue(VoxelQueue &             queue,
+                                     itk::MultiThreaderBase *threader,
+                                     itk::ProcessObject *     filter,
+                                     size_t const             nthreads,
+                                     MakeWorker &&            make_worker) {
+    std::vector<ThreadLoad> loads(nthreads);
+    threader->SetNumberOfWorkUnits(nthreads);
+    threader->ParallelizeArray(
+        0,
+        nthreads,
+        [&](itk::SizeValueType const thread) {
+            auto const                 begin = std::chrono::steady_clock::now();
+            itk::TotalProgressReporter progress(filter, queue.size());
+            auto                       worker = make_worker();
+            ThreadLoad &               load   = loads[thread];
+            size_t                     start, end;
+            while (queue.next(start, end)) {
+                worker(start, end);
+                load.voxels += (end - start);
+                load.chunks++;
+                progress.Completed(end - start);
+            }
+            load.seconds =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        },
+        nullptr);
+    return loads;
+}
+
+} // namespace QI
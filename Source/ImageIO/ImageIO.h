@@ -18,6 +18,27 @@ namespace QI {
 template <typename TImg = QI::VolumeF>
 extern auto ReadImage(const std::string &path, const bool verbose) -> typename TImg::Pointer;
 
+/*
+ * Read only the given region of an image. For a VectorImage the region covers the first three
+ * dimensions and every volume is read. Files that ITK can stream (e.g. uncompressed NIfTI) are not
+ * read in full.
+ */
+template <typename TImg = QI::VolumeF>
+extern auto ReadImageSlab(const std::string &              path,
+                          const typename TImg::RegionType &region,
+                          const bool                       verbose) -> typename TImg::Pointer;
+
+/*
+ * Return the region covered by the first three dimensions of an image, without reading it
+ */
+itk::ImageRegion<3> ReadImageRegion(const std::string &path);
+
+/*
+ * Return true if ITK can read part of an image without reading the whole file. Compressed files
+ * are read from the start every time, so ReadImageSlab would decompress them once per slab.
+ */
+bool CanStreamRead(const std::string &path);
+
 template <typename TImg = QI::VolumeF>
 extern auto ReadMagnitudeImage(const std::string &path, const bool verbose) ->
     typename TImg::Pointer;
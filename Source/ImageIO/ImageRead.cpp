@@ -15,8 +15,11 @@
 
 #include "ImageIO.h"
 #include "Log.h"
+#include "MappedNifti.h"
 #include "itkComplexToModulusImageFilter.h"
+#include "itkExtractImageFilter.h"
 #include "itkImageFileReader.h"
+#include "itkImageIOFactory.h"
 
 namespace QI {
 
@@ -26,6 +29,21 @@ auto ReadImage(const std::string &path, const bool verbose) -> typename TImg::Po
     typename TReader::Pointer          file = TReader::New();
     file->SetFileName(path);
     QI::Log(verbose, "Reading image: {}", path);
+    // Uncompressed NIfTI of the right type is used in place, ITK supplies the geometry
+    auto const mapped = MappedNifti::Open(path);
+    if (mapped && mapped->holds<typename TImg::PixelType>()) {
+        file->UpdateOutputInformation();
+        auto const region = file->GetOutput()->GetLargestPossibleRegion();
+        if (region.GetNumberOfPixels() == mapped->voxels()) {
+            auto container = MappedImageContainer<typename TImg::PixelType>::New();
+            container->SetMapping(mapped);
+            typename TImg::Pointer img = TImg::New();
+            img->CopyInformation(file->GetOutput());
+            img->SetRegions(region);
+            img->SetPixelContainer(container);
+            return img;
+        }
+    }
     file->Update();
     typename TImg::Pointer img = file->GetOutput();
     if (!img) {
@@ -35,6 +53,42 @@ auto ReadImage(const std::string &path, const bool verbose) -> typename TImg::Po
     return img;
 }
 
+template <typename TImg>
+auto ReadImageSlab(const std::string &              path,
+                   const typename TImg::RegionType &region,
+                   const bool                       verbose) -> typename TImg::Pointer {
+    auto file = itk::ImageFileReader<TImg>::New();
+    file->SetFileName(path);
+    auto slab = itk::ExtractImageFilter<TImg, TImg>::New();
+    slab->SetInput(file->GetOutput());
+    slab->SetExtractionRegion(region);
+    slab->SetDirectionCollapseToSubmatrix();
+    QI::Log(verbose, "Reading slab from image: {}", path);
+    slab->Update();
+    typename TImg::Pointer img = slab->GetOutput();
+    if (!img) {
+        QI::Fail("Failed to read file: {}", path);
+    }
+    img->DisconnectPipeline();
+    return img;
+}
+
+itk::ImageRegion<3> ReadImageRegion(const std::string &path) {
+    auto file = itk::ImageFileReader<SeriesF>::New();
+    file->SetFileName(path);
+    file->UpdateOutputInformation();
+    return file->GetOutput()->GetLargestPossibleRegion().Slice(3);
+}
+
+bool CanStreamRead(const std::string &path) {
+    auto io = itk::ImageIOFactory::CreateImageIO(path.c_str(), itk::ImageIOFactory::ReadMode);
+    if (!io) {
+        QI::Fail("Could not find an image reader for: {}", path);
+    }
+    bool const compressed = (path.size() > 3) && (path.compare(path.size() - 3, 3, ".gz") == 0);
+    return io->CanStreamRead() && !compressed;
+}
+
 template <typename TImg>
 auto ReadMagnitudeImage(const std::string &path, const bool verbose) -> typename TImg::Pointer {
     typedef itk::Image<std::complex<typename TImg::PixelType>, TImg::ImageDimension> TComplex;
@@ -69,6 +123,10 @@ template auto ReadImage<SeriesXF>(const std::string &path, const bool verbose) -
     typename SeriesXF::Pointer;
 template auto ReadImage<SeriesXD>(const std::string &path, const bool verbose) ->
     typename SeriesXD::Pointer;
+template auto ReadImageSlab<VolumeF>(const std::string &       path,
+                                    const VolumeF::RegionType &region,
+                                    const bool                 verbose) ->
+    typename VolumeF::Pointer;
 template auto ReadMagnitudeImage<VolumeF>(const std::string &path, const bool verbose) ->
     typename VolumeF::Pointer;
 template auto ReadMagnitudeImage<SeriesF>(const std::string &path, const bool verbose) ->
@@ -17,6 +17,7 @@
 
 #include "ImageIO.h"
 #include "Log.h"
+#include "MappedNifti.h"
 
 namespace QI {
 
@@ -27,6 +28,7 @@ void WriteImage(const TImg *ptr, const std::string &path, const bool verbose) {
     file->SetFileName(path);
     file->SetInput(ptr);
     QI::Log(verbose, "Writing image: {}", path);
+    QI::MappedNifti::DetachFile(path);
     file->Update();
 }
 
@@ -0,0 +1,158 @@
+/*
+ *  MappedNifti.cpp
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MappedNifti.h"
+
+namespace QI {
+
+namespace {
+// Offsets into the 348 byte NIfTI-1 header
+constexpr size_t hdr_size       = 348;
+constexpr size_t dim_offset     = 40;
+constexpr size_t dtype_offset   = 70;
+constexpr size_t bitpix_offset  = 72;
+constexpr size_t vox_offset     = 108;
+constexpr size_t slope_offset   = 112;
+constexpr size_t inter_offset   = 116;
+constexpr size_t magic_offset   = 344;
+constexpr char   single_magic[] = "n+1";
+
+template <typename T> T HeaderField(char const *hdr, size_t const offset) {
+    T val;
+    std::memcpy(&val, hdr + offset, sizeof(T));
+    return val;
+}
+
+// Files with a live mapping, so that writers can avoid truncating them underneath it
+std::mutex &RegistryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::multiset<std::pair<dev_t, ino_t>> &Registry() {
+    static std::multiset<std::pair<dev_t, ino_t>> registry;
+    return registry;
+}
+} // namespace
+
+std::shared_ptr<MappedNifti> MappedNifti::Open(std::string const &path) {
+    // .nii.gz and .hdr/.img pairs are left to ITK
+    if ((path.size() < 4) || (path.compare(path.size() - 4, 4, ".nii") != 0)) {
+        return nullptr;
+    }
+    int const fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if ((::fstat(fd, &st) != 0) || (static_cast<size_t>(st.st_size) < hdr_size)) {
+        ::close(fd);
+        return nullptr;
+    }
+    std::shared_ptr<MappedNifti> mapped(new MappedNifti);
+    mapped->m_size = st.st_size;
+    mapped->m_map  = ::mmap(nullptr, mapped->m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped->m_map == MAP_FAILED) {
+        mapped->m_map = nullptr;
+        return nullptr;
+    }
+
+    char const *hdr = static_cast<char const *>(mapped->m_map);
+    // A byte-swapped header fails the size check
+    if ((HeaderField<int32_t>(hdr, 0) != static_cast<int32_t>(hdr_size)) ||
+        (std::memcmp(hdr + magic_offset, single_magic, sizeof(single_magic)) != 0)) {
+        return nullptr;
+    }
+    float const slope = HeaderField<float>(hdr, slope_offset);
+    float const inter = HeaderField<float>(hdr, inter_offset);
+    if (((slope != 0.f) && (slope != 1.f)) || (inter != 0.f)) {
+        return nullptr;
+    }
+    int16_t const ndim = HeaderField<int16_t>(hdr, dim_offset);
+    if ((ndim < 1) || (ndim > 7)) {
+        return nullptr;
+    }
+    size_t voxels = 1;
+    for (int i = 1; i <= ndim; i++) {
+        int16_t const d = HeaderField<int16_t>(hdr, dim_offset + 2 * i);
+        if (d < 1) {
+            return nullptr;
+        }
+        voxels *= d;
+    }
+    int16_t const bitpix = HeaderField<int16_t>(hdr, bitpix_offset);
+    float const   vox    = HeaderField<float>(hdr, vox_offset);
+    if ((bitpix < 8) || !(vox >= hdr_size) || (vox > mapped->m_size)) {
+        return nullptr;
+    }
+    size_t const offset = vox;
+    if ((offset % 16 != 0) || (offset + voxels * (bitpix / 8) > mapped->m_size)) {
+        return nullptr;
+    }
+    mapped->m_offset   = offset;
+    mapped->m_voxels   = voxels;
+    mapped->m_datatype = HeaderField<int16_t>(hdr, dtype_offset);
+    mapped->m_bitpix   = bitpix;
+    mapped->m_device   = st.st_dev;
+    mapped->m_inode    = st.st_ino;
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    Registry().emplace(st.st_dev, st.st_ino);
+    return mapped;
+}
+
+MappedNifti::~MappedNifti() {
+    if (m_map) {
+        ::munmap(m_map, m_size);
+    }
+    if (m_inode) {
+        std::lock_guard<std::mutex> lock(RegistryMutex());
+        auto const                  it = Registry().find({m_device, m_inode});
+        if (it != Registry().end()) {
+            Registry().erase(it);
+        }
+    }
+}
+
+void MappedNifti::DetachFile(std::string const &path) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    // The mapping keeps the unlinked inode alive until it is unmapped
+    if (Registry().count({st.st_dev, st.st_ino})) {
+        ::unlink(path.c_str());
+    }
+}
+
+void MappedNifti::release(size_t const begin, size_t const end) const {
+    // Pages are dropped whole. The file is never written through the mapping, so a page that was
+    // also holding data still needed is simply read back in from the file.
+    size_t const page  = ::sysconf(_SC_PAGESIZE);
+    size_t const first = (m_offset + begin) / page * page;
+    size_t const last  = (m_offset + end) / page * page;
+    if (last > first) {
+        ::madvise(static_cast<char *>(m_map) + first, last - first, MADV_DONTNEED);
+    }
+}
+
+} // namespace QI
@@ -0,0 +1,111 @@
+/*
+ *  MappedNifti.h
+ *
+ *  Copyright (c) 2019 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include <complex>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <sys/types.h>
+
+#include "itkImportImageContainer.h"
+
+namespace QI {
+
+template <typename T> constexpr short NiftiDatatype() {
+    if constexpr (std::is_same_v<T, unsigned char>) {
+        return 2;
+    } else if constexpr (std::is_same_v<T, int>) {
+        return 8;
+    } else if constexpr (std::is_same_v<T, float>) {
+        return 16;
+    } else if constexpr (std::is_same_v<T, std::complex<float>>) {
+        return 32;
+    } else if constexpr (std::is_same_v<T, double>) {
+        return 64;
+    } else if constexpr (std::is_same_v<T, unsigned int>) {
+        return 768;
+    } else if constexpr (std::is_same_v<T, std::complex<double>>) {
+        return 1792;
+    } else {
+        return 0;
+    }
+}
+
+/*
+ *  An uncompressed single-file NIfTI-1 image in native byte order and without intensity scaling,
+ *  memory-mapped so that the voxel data can be used where it lies. The mapping is private, so
+ *  writes to it never reach the file.
+ */
+class MappedNifti {
+  public:
+    // Returns nullptr for anything else, which should be read through ITK instead
+    static std::shared_ptr<MappedNifti> Open(std::string const &path);
+    ~MappedNifti();
+
+    MappedNifti(MappedNifti const &) = delete;
+    MappedNifti &operator=(MappedNifti const &) = delete;
+
+    template <typename T> bool holds() const {
+        return (m_datatype == NiftiDatatype<T>()) &&
+               (static_cast<size_t>(m_bitpix) == 8 * sizeof(T));
+    }
+    size_t                     voxels() const { return m_voxels; }
+    void *                     data() const { return static_cast<char *>(m_map) + m_offset; }
+
+    // Drop the mapped pages between these byte offsets into the data to free memory
+    void release(size_t const begin, size_t const end) const;
+
+    /*
+     *  Call before writing to path. If the file there is still mapped it is unlinked, so the writer
+     *  creates a new file instead of truncating the one the mapping is reading from.
+     */
+    static void DetachFile(std::string const &path);
+
+  protected:
+    MappedNifti() = default;
+
+    void * m_map      = nullptr;
+    dev_t  m_device   = 0;
+    ino_t  m_inode    = 0;
+    size_t m_size     = 0;
+    size_t m_offset   = 0;
+    size_t m_voxels   = 0;
+    short  m_datatype = 0;
+    short  m_bitpix   = 0;
+};
+
+/*
+ *  Pixel container that keeps the mapping alive for as long as the image holding it
+ */
+template <typename TElement>
+class MappedImageContainer : public itk::ImportImageContainer<itk::SizeValueType, TElement> {
+  public:
+    using Self       = MappedImageContainer;
+    using Superclass = itk::ImportImageContainer<itk::SizeValueType, TElement>;
+    using Pointer    = itk::SmartPointer<Self>;
+    itkNewMacro(Self);
+    itkTypeMacro(Self, ImportImageContainer);
+
+    void SetMapping(std::shared_ptr<MappedNifti> const &mapped) {
+        m_mapped = mapped;
+        this->SetImportPointer(static_cast<TElement *>(mapped->data()), mapped->voxels(), false);
+    }
+
+  protected:
+    MappedImageContainer()           = default;
+    ~MappedImageContainer() override = default;
+
+    std::shared_ptr<MappedNifti> m_mapped;
+};
+
+} // namespace QI
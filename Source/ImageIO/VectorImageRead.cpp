@@ -14,11 +14,63 @@
 #include "ImageIO.h"
 #include "ImageToVectorFilter.h"
 #include "Log.h"
+#include "MappedNifti.h"
+#include "itkExtractImageFilter.h"
 #include "itkImageFileReader.h"
+#include <algorithm>
 #include <string>
 
 namespace QI {
 
+/*
+ *  NIfTI stores volumes one after another but a VectorImage interleaves them, so the data cannot
+ *  be used in place. Instead it is transposed straight out of the mapping in blocks of voxels,
+ *  dropping the input pages behind each block, which avoids a full intermediate copy.
+ */
+template <typename TVectorImg>
+auto MappedToVector(itk::Image<typename TVectorImg::InternalPixelType, 4> const *series,
+                    MappedNifti const &mapped) -> typename TVectorImg::Pointer {
+    using TPixel = typename TVectorImg::InternalPixelType;
+
+    auto const   series_region = series->GetLargestPossibleRegion();
+    size_t const n_vols        = series_region.GetSize()[3];
+
+    typename TVectorImg::SpacingType   spacing;
+    typename TVectorImg::PointType     origin;
+    typename TVectorImg::DirectionType direction;
+    for (int i = 0; i < 3; i++) {
+        spacing[i] = series->GetSpacing()[i];
+        origin[i]  = series->GetOrigin()[i];
+        for (int j = 0; j < 3; j++) {
+            direction[i][j] = series->GetDirection()[i][j];
+        }
+    }
+    auto vols = TVectorImg::New();
+    vols->SetRegions(series_region.Slice(3));
+    vols->SetSpacing(spacing);
+    vols->SetOrigin(origin);
+    vols->SetDirection(direction);
+    vols->SetNumberOfComponentsPerPixel(n_vols);
+    vols->Allocate();
+
+    size_t const  n_vox = vols->GetLargestPossibleRegion().GetNumberOfPixels();
+    size_t const  block = 16384;
+    TPixel const *in    = static_cast<TPixel const *>(mapped.data());
+    TPixel *      out   = vols->GetBufferPointer();
+    for (size_t start = 0; start < n_vox; start += block) {
+        size_t const end = std::min(start + block, n_vox);
+        for (size_t v = 0; v < n_vols; v++) {
+            TPixel const *vol = in + v * n_vox;
+            for (size_t i = start; i < end; i++) {
+                out[i * n_vols + v] = vol[i];
+            }
+            mapped.release((v * n_vox + start) * sizeof(TPixel),
+                           (v * n_vox + end) * sizeof(TPixel));
+        }
+    }
+    return vols;
+}
+
 template <typename TVectorImg>
 auto ReadImage(const std::string &path, const bool verbose) -> typename TVectorImg::Pointer {
 
@@ -30,6 +82,14 @@ auto ReadImage(const std::string &path, const bool verbose) -> typename TVectorI
     auto file = TReader::New();
     file->SetFileName(path);
     QI::Log(verbose, "Reading image: {}", path);
+    auto const mapped = MappedNifti::Open(path);
+    if (mapped && mapped->holds<TPixel>()) {
+        file->UpdateOutputInformation();
+        if (file->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels() ==
+            mapped->voxels()) {
+            return MappedToVector<TVectorImg>(file->GetOutput(), *mapped);
+        }
+    }
     file->Update();
 
     auto convert = TToVector::New();
@@ -44,10 +104,55 @@ auto ReadImage(const std::string &path, const bool verbose) -> typename TVectorI
     return vols;
 }
 
+template <typename TVectorImg>
+auto ReadImageSlab(const std::string &                    path,
+                   const typename TVectorImg::RegionType &region,
+                   const bool                             verbose) -> typename TVectorImg::Pointer {
+
+    using TPixel    = typename TVectorImg::InternalPixelType;
+    using TSeries   = itk::Image<TPixel, 4>;
+    using TReader   = itk::ImageFileReader<TSeries>;
+    using TExtract  = itk::ExtractImageFilter<TSeries, TSeries>;
+    using TToVector = itk::ImageToVectorFilter<TSeries>;
+
+    auto file = TReader::New();
+    file->SetFileName(path);
+    file->UpdateOutputInformation();
+    // Keep every volume
+    auto series_region = file->GetOutput()->GetLargestPossibleRegion();
+    for (int i = 0; i < 3; i++) {
+        series_region.SetIndex(i, region.GetIndex(i));
+        series_region.SetSize(i, region.GetSize(i));
+    }
+    auto slab = TExtract::New();
+    slab->SetInput(file->GetOutput());
+    slab->SetExtractionRegion(series_region);
+    slab->SetDirectionCollapseToSubmatrix();
+
+    auto convert = TToVector::New();
+    convert->SetInput(slab->GetOutput());
+    QI::Log(verbose, "Reading slab from image: {}", path);
+    convert->Update();
+    typename TVectorImg::Pointer vols = convert->GetOutput();
+    if (!vols) {
+        QI::Fail("Failed to read image: {}", path);
+    }
+    vols->DisconnectPipeline();
+    return vols;
+}
+
 template auto ReadImage<QI::VectorVolumeF>(const std::string &path, const bool verbose)
     -> QI::VectorVolumeF::Pointer;
 template auto ReadImage<QI::VectorVolumeXF>(const std::string &path, const bool verbose)
     -> QI::VectorVolumeXF::Pointer;
+template auto ReadImageSlab<QI::VectorVolumeF>(const std::string &                  path,
+                                               const QI::VectorVolumeF::RegionType &region,
+                                               const bool                           verbose)
+    -> QI::VectorVolumeF::Pointer;
+template auto ReadImageSlab<QI::VectorVolumeXF>(const std::string &                   path,
+                                                const QI::VectorVolumeXF::RegionType &region,
+                                                const bool                            verbose)
+    -> QI::VectorVolumeXF::Pointer;
 
 } // namespace QI
 
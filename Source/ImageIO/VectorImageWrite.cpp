@@ -9,6 +9,7 @@
  *
  */
 
+#include <algorithm>
 #include <string>
 
 #include "itkComplexToModulusImageFilter.h"
@@ -19,9 +20,26 @@
 
 #include "ImageIO.h"
 #include "Log.h"
+#include "MappedNifti.h"
 
 namespace QI {
 
+namespace {
+/*
+ *  Formats that support it are written a few volumes at a time, so the volume-major copy of the
+ *  data never exists in full. Others, e.g. compressed NIfTI, are written in one piece.
+ */
+template <typename TVImg> unsigned int StreamDivisions(const TVImg *img) {
+    using TPixel              = typename TVImg::InternalPixelType;
+    size_t const piece_bytes  = 16 << 20;
+    size_t const n_vox        = img->GetLargestPossibleRegion().GetNumberOfPixels();
+    size_t const n_vols       = img->GetNumberOfComponentsPerPixel();
+    size_t const volume_bytes = std::max<size_t>(1, n_vox * sizeof(TPixel));
+    size_t const per_piece    = std::max<size_t>(1, piece_bytes / volume_bytes);
+    return std::max<size_t>(1, (n_vols + per_piece - 1) / per_piece);
+}
+} // namespace
+
 template <typename TVImg>
 void WriteImage(const TVImg *img, const std::string &path, const bool verbose) {
     using TToSeries = itk::VectorToImageFilter<TVImg>;
@@ -29,12 +47,13 @@ void WriteImage(const TVImg *img, const std::string &path, const bool verbose) {
 
     typename TToSeries::Pointer convert = TToSeries::New();
     convert->SetInput(img);
-    convert->Update();
 
     typename TWriter::Pointer file = TWriter::New();
     file->SetFileName(path);
     file->SetInput(convert->GetOutput());
+    file->SetNumberOfStreamDivisions(StreamDivisions(img));
     QI::Log(verbose, "Writing image: {}", path);
+    QI::MappedNifti::DetachFile(path);
     file->Update();
 }
 
@@ -56,13 +75,14 @@ void WriteMagnitudeImage(const TVImg *img, const std::string &path, const bool v
 
     auto mag = itk::ComplexToModulusImageFilter<TSeries, TRealSeries>::New();
     mag->SetInput(convert->GetOutput());
-    mag->Update();
 
     using TWriter = itk::ImageFileWriter<TRealSeries>;
     auto file     = TWriter::New();
     file->SetFileName(path);
     file->SetInput(mag->GetOutput());
+    file->SetNumberOfStreamDivisions(StreamDivisions(img));
     QI::Log(verbose, "Writing magnitude image: {}", path);
+    QI::MappedNifti::DetachFile(path);
     file->Update();
 }
 
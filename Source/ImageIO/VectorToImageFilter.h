@@ -3,11 +3,14 @@
 
 #include "itkImageToImageFilter.h"
 #include "itkVectorImage.h"
-#include "itkVectorIndexSelectionCastImageFilter.h"
-#include "itkTileImageFilter.h"
 
 namespace itk {
 
+/*
+ * Converts a VectorImage to an image with one more dimension, the components becoming the last
+ * dimension. The output is transposed directly from the interleaved input. Only the volumes in
+ * the requested region are generated, so a streaming writer can take a few at a time.
+ */
 template<typename TInput>
 class VectorToImageFilter  : public ImageToImageFilter<TInput, Image<typename TInput::InternalPixelType, TInput::ImageDimension + 1>>
 {
@@ -16,8 +19,6 @@ public:
 	static const size_t OutputDimension = TInput::ImageDimension + 1;
 	typedef typename TInput::InternalPixelType TPixel;
 	typedef Image<TPixel, OutputDimension>     TOutput;
-	typedef Image<TPixel, InputDimension>      TVolume;
-
 
 	typedef VectorToImageFilter                      Self;
 	typedef itk::ImageToImageFilter<TInput, TOutput> Superclass;
@@ -26,19 +27,14 @@ public:
 	itkNewMacro(Self)
 	itkTypeMacro(Self, Superclass);
 
-    void SetInput(const TInput *img) ITK_OVERRIDE;
-    
 protected:
-	typedef itk::VectorIndexSelectionCastImageFilter<TInput, TVolume> TIndexer;
-	typedef itk::TileImageFilter<TVolume, TOutput> TTiler;
-	typename TTiler::Pointer m_tiler;
-	std::vector<typename TIndexer::Pointer> m_indexers;
-
-	VectorToImageFilter();
+	VectorToImageFilter(){}
 	~VectorToImageFilter(){}
 
     void GenerateOutputInformation() ITK_OVERRIDE; // Because output will be different dimension to input
-    void GenerateData() ITK_OVERRIDE; // Don't need a GenerateData, just call m_tiler->Update()
+    void GenerateInputRequestedRegion() ITK_OVERRIDE;
+    void EnlargeOutputRequestedRegion(DataObject *output) ITK_OVERRIDE; // Whole volumes only
+    void GenerateData() ITK_OVERRIDE;
 
 private:
 	VectorToImageFilter(const Self &); //purposely not implemented
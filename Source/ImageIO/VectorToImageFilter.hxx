@@ -1,35 +1,9 @@
 #ifndef VECTORTOIMAGEFILTER_HXX
 #define VECTORTOIMAGEFILTER_HXX
 
-namespace itk {
-
-template<typename TInput>
-VectorToImageFilter<TInput>::VectorToImageFilter() {
-	m_tiler = TTiler::New();
-}
+#include <algorithm>
 
-template<typename TInput>
-void VectorToImageFilter<TInput>::SetInput(const TInput *img) {
-    Superclass::SetInput(img);
-    
-    auto in  = this->GetInput();
-    if (!in) {
-        return;
-    }
-    itk::FixedArray<unsigned int, 4> layout;
-    layout[0] = layout[1] = layout[2] = 1;
-    layout[3] = in->GetNumberOfComponentsPerPixel();
-    m_tiler->SetLayout(layout);
-    m_indexers.resize(in->GetNumberOfComponentsPerPixel());
-    for (size_t i =0; i < in->GetNumberOfComponentsPerPixel(); i++) {
-        m_indexers[i] = TIndexer::New();
-        m_indexers[i]->SetIndex(i);
-        m_indexers[i]->SetInput(in);
-        m_tiler->SetInput(i, m_indexers[i]->GetOutput());
-    }
-    m_tiler->UpdateLargestPossibleRegion();
-    this->GraftOutput(m_tiler->GetOutput());
-}
+namespace itk {
 
 template<typename TInput>
 void VectorToImageFilter<TInput>::GenerateOutputInformation() {
@@ -71,19 +45,60 @@ void VectorToImageFilter<TInput>::GenerateOutputInformation() {
     out->SetLargestPossibleRegion(outRegion);
 }
 
+template<typename TInput>
+void VectorToImageFilter<TInput>::GenerateInputRequestedRegion() {
+    Superclass::GenerateInputRequestedRegion();
+    auto in = const_cast<TInput *>(this->GetInput());
+    if (in) {
+        in->SetRequestedRegionToLargestPossibleRegion();
+    }
+}
+
+template<typename TInput>
+void VectorToImageFilter<TInput>::EnlargeOutputRequestedRegion(DataObject *output) {
+    auto out = dynamic_cast<TOutput *>(output);
+    if (!out) {
+        return;
+    }
+    auto requested = out->GetRequestedRegion();
+    auto const largest = out->GetLargestPossibleRegion();
+    for (size_t i = 0; i < InputDimension; i++) {
+        requested.SetIndex(i, largest.GetIndex(i));
+        requested.SetSize(i, largest.GetSize(i));
+    }
+    out->SetRequestedRegion(requested);
+}
+
 template<typename TInput>
 void VectorToImageFilter<TInput>::GenerateData() {
-    typename TInput::Pointer input = TInput::New();
-    input->Graft(const_cast<TInput *>(this->GetInput()));
-    auto spacing = this->GetOutput()->GetSpacing();
-    auto direction = this->GetOutput()->GetDirection();
-    auto origin = this->GetOutput()->GetOrigin();
-    m_tiler->UpdateLargestPossibleRegion();
-    this->GraftOutput(m_tiler->GetOutput());
-    // Reset space information because tiler messes it up
-    this->GetOutput()->SetSpacing(spacing);
-    this->GetOutput()->SetDirection(direction);
-    this->GetOutput()->SetOrigin(origin);
+    auto in  = this->GetInput();
+    auto out = this->GetOutput();
+    auto const region = out->GetRequestedRegion();
+    out->SetBufferedRegion(region);
+    out->Allocate();
+    if (region.GetNumberOfPixels() == 0) {
+        return;
+    }
+
+    // Each output volume is a contiguous block. Work through tiles of voxels so the reads of the
+    // interleaved input stay in cache while every volume is written sequentially.
+    size_t const n_comp  = in->GetNumberOfComponentsPerPixel();
+    size_t const first   = region.GetIndex(InputDimension);
+    size_t const n_vols  = region.GetSize(InputDimension);
+    size_t const n_vox   = region.GetNumberOfPixels() / n_vols;
+    size_t const tile    = 4096;
+    TPixel const *in_buf = in->GetBufferPointer();
+    TPixel *out_buf      = out->GetBufferPointer();
+    for (size_t start = 0; start < n_vox; start += tile) {
+        size_t const end = std::min(start + tile, n_vox);
+        for (size_t v = 0; v < n_vols; v++) {
+            TPixel const *in_vol  = in_buf + first + v;
+            TPixel *      out_vol = out_buf + v * n_vox;
+            for (size_t i = start; i < end; i++) {
+                out_vol[i] = in_vol[i * n_comp];
+            }
+        }
+    }
 }
 
 } // End namespace itk
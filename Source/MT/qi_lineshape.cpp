@@ -35,6 +35,10 @@ int lineshape_main(args::Subparser &parser) {
                                         "Spacing of frequencies (default 1000 Hz)",
                                         {'p', "frq_space"},
                                         1e3);
+    args::Flag quadrature(parser,
+                          "QUADRATURE",
+                          "Integrate the Super-Lorentzian directly instead of using the table",
+                          {"quadrature"});
     parser.Parse();
     QI::Log(verbose, "Bound-pool T2: {}", T2b.Get());
     auto frqs =
@@ -48,7 +52,8 @@ int lineshape_main(args::Subparser &parser) {
     } else if (shape_arg.Get() == "Lorentzian") {
         values = QI::Lorentzian(frqs, T2b.Get());
     } else if (shape_arg.Get() == "SuperLorentzian") {
-        values = QI::SuperLorentzian(frqs, T2b.Get());
+        values = quadrature ? QI::SuperLorentzian(frqs, T2b.Get()) :
+                              QI::SuperLorentzianTable::Get()(frqs, T2b.Get());
     } else {
         QI::Fail("Unknown lineshape: {}", shape_arg.Get());
     }
@@ -175,7 +175,8 @@ int lorentzian_main(args::Subparser &parser) {
                                          verbose,
                                          simulate.Get(),
                                          threads.Get(),
-                                         subregion.Get());
+                                         subregion.Get(),
+                                         seed.Get());
         } else {
             LFit fit{model};
             auto fit_filter =
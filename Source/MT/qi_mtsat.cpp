@@ -52,7 +52,8 @@ int mtsat_main(args::Subparser &parser) {
             verbose,
             simulate.Get(),
             threads.Get(),
-            subregion.Get());
+            subregion.Get(),
+            seed.Get());
     } else {
         auto pdw_img = QI::ReadImage(QI::CheckPos(pdw_path), verbose);
         auto t1w_img = QI::ReadImage(QI::CheckPos(t1w_path), verbose);
@@ -15,7 +15,9 @@
 // #define QI_DEBUG_BUILD 1
 #include "Args.h"
 #include "FitFunction.h"
+#include "FitLM.h"
 #include "FitScaledAuto.h"
+#include "FitVarPro.h"
 #include "ImageIO.h"
 #include "Lineshape.h"
 #include "MTSequences.h"
@@ -67,7 +69,7 @@ struct RamaniModel : QI::Model<double, double, 5, 3, 1, 2> {
             lsv = QI::Lorentzian((sequence.sat_f0 + f0), T2b);
             break;
         case QI::Lineshapes::SuperLorentzian:
-            lsv = QI::SuperLorentzian((sequence.sat_f0 + f0), T2b);
+            lsv = QI::SuperLorentzianTable::Get()((sequence.sat_f0 + f0), T2b);
             break;
         case QI::Lineshapes::Interpolated:
             lsv = (*interp)((sequence.sat_f0 + f0), T2b);
@@ -115,6 +117,8 @@ struct RamaniModel : QI::Model<double, double, 5, 3, 1, 2> {
 };
 
 using RamaniFitFunction = QI::ScaledAutoDiffFit<RamaniModel>;
+using RamaniLMFunction  = QI::LMFit<RamaniModel>;
+using RamaniVarPro      = QI::VarProFit<RamaniModel>;
 
 //******************************************************************************
 // Main
@@ -122,6 +126,8 @@ using RamaniFitFunction = QI::ScaledAutoDiffFit<RamaniModel>;
 int qmt_main(args::Subparser &parser) {
     args::Positional<std::string> mtsat_path(parser, "MTSAT FILE", "Path to MT-Sat data");
     QI_COMMON_ARGS;
+    QI_VARPRO_ARG;
+    QI_TELEMETRY_ARG;
     args::ValueFlag<std::string> T1(parser, "T1", "T1 map (seconds) file ** REQUIRED **", {"T1"});
     args::ValueFlag<std::string> f0(parser, "f0", "f0 map (Hz) file", {'f', "f0"});
     args::ValueFlag<std::string> B1(parser, "B1", "B1 map (ratio) file", {'b', "B1"});
@@ -134,6 +140,8 @@ int qmt_main(args::Subparser &parser) {
     args::ValueFlag<float> R1_b(
         parser, "R1b", "R1 (not T1) of the bound pool. Default 2.5s^-1", {'r', "R1b"}, 2.5f);
     args::ValueFlag<float> hloss(parser, "H", "Huber Loss parameter (1)", {'h', "hloss"}, 1.f);
+    args::Flag lm(parser, "LM", "Use the fixed-size LM solver instead of Ceres", {"lm"});
+    args::Flag warm(parser, "WARM", "Start from already fitted neighbours", {"warm"});
     parser.Parse();
     QI::CheckPos(mtsat_path);
     QI::Log(verbose, "Reading sequence information");
@@ -150,6 +158,7 @@ int qmt_main(args::Subparser &parser) {
     } else if (lineshape_arg.Get() == "Superlorentzian") {
         QI::Log(verbose, "Using a Super-Lorentzian lineshape");
         lineshape = QI::Lineshapes::SuperLorentzian;
+        QI::SuperLorentzianTable::Get(); // Build the table before the fitting threads start
     } else {
         QI::Log(verbose, "Reading lineshape file: {}", lineshape_arg.Get());
         json ls_file = QI::ReadJSON(lineshape_arg.Get());
@@ -168,16 +177,35 @@ int qmt_main(args::Subparser &parser) {
                                               verbose,
                                               simulate.Get(),
                                               threads.Get(),
-                                              subregion.Get());
+                                              subregion.Get(),
+                                              seed.Get());
     } else {
-        RamaniFitFunction fit{model, hloss.Get()};
-
-        auto fit_filter = QI::ModelFitFilter<RamaniFitFunction>::New(
-            &fit, verbose, covar, resids, threads.Get(), subregion.Get());
-        fit_filter->ReadInputs(
-            {mtsat_path.Get()}, {f0.Get(), B1.Get(), QI::CheckValue(T1)}, mask.Get());
-        fit_filter->Update();
-        fit_filter->WriteOutputs(prefix.Get() + "QMT_");
+        auto process = [&](auto &fit) {
+            using FitType   = std::remove_reference_t<decltype(fit)>;
+            auto fit_filter = QI::ModelFitFilter<FitType>::New(
+                &fit, verbose, covar, resids, threads.Get(), subregion.Get());
+            fit_filter->SetWarmStart(warm);
+            fit_filter->SetTelemetry(telemetry.Get());
+            fit_filter->ReadInputs(
+                {mtsat_path.Get()}, {f0.Get(), B1.Get(), QI::CheckValue(T1)}, mask.Get());
+            fit_filter->Update();
+            fit_filter->WriteOutputs(prefix.Get() + "QMT_");
+        };
+        if (varpro) {
+            if (hloss && hloss.Get() > 0) {
+                QI::Fail("Variable Projection fits by least-squares, --hloss cannot be used");
+            }
+            QI::Log(verbose, "Using Variable Projection (least-squares)");
+            RamaniVarPro fit{model};
+            process(fit);
+        } else if (lm) {
+            QI::Log(verbose, "Using fixed-size LM solver");
+            RamaniLMFunction fit{model, hloss.Get()};
+            process(fit);
+        } else {
+            RamaniFitFunction fit{model, hloss.Get()};
+            process(fit);
+        }
         QI::Log(verbose, "Finished.");
     }
     return EXIT_SUCCESS;
@@ -213,7 +213,8 @@ int ssfp_emt_main(args::Subparser &parser) {
                                           verbose,
                                           simulate.Get(),
                                           threads.Get(),
-                                          subregion.Get());
+                                          subregion.Get(),
+                                          seed.Get());
     } else {
         // First calculate T2_f
         auto a_input = QI::ReadImage<QI::VectorVolumeF>(a_path.Get(), verbose);
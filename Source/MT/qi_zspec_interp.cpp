@@ -77,10 +77,15 @@ int zspec_interp_main(args::Subparser &parser) {
     output->SetNumberOfComponentsPerPixel(out_freqs.rows());
     output->Allocate(true);
 
-    std::vector<size_t> indices        = QI::SortedUniqueIndices(in_freqs);
-    auto const          process_region = subregion ?
-                                    QI::RegionFromString<QI::VolumeF::RegionType>(subregion.Get()) :
-                                    input->GetBufferedRegion();
+    std::vector<size_t> const         indices = QI::SortedUniqueIndices(in_freqs);
+    QI::BatchSplineInterpolator const zspec(in_freqs, order.Get(), indices);
+    // Without an f0 map every voxel is interpolated at the same frequencies
+    Eigen::MatrixXd const weights = asym ? Eigen::MatrixXd(zspec.weights(-out_freqs) -
+                                                           zspec.weights(out_freqs)) :
+                                           zspec.weights(out_freqs);
+    auto const process_region =
+        subregion ? QI::RegionFromString<QI::VolumeF::RegionType>(subregion.Get()) :
+                    input->GetBufferedRegion();
     auto mt = itk::MultiThreaderBase::New();
     QI::Log(verbose, "Processing");
     mt->SetNumberOfWorkUnits(threads.Get());
@@ -96,37 +101,58 @@ int zspec_interp_main(args::Subparser &parser) {
             if (mask_image)
                 mask_it = itk::ImageRegionConstIterator<QI::VolumeF>(mask_image, region);
             itk::ImageRegionIterator<QI::VectorVolumeF> out_it(output, region);
-            for (in_it.GoToBegin(); !in_it.IsAtEnd(); ++in_it, ++out_it) {
-                itk::VariableLengthVector<float> interped(out_freqs.rows());
-                if (!mask_image || mask_it.Get()) {
-                    const Eigen::Map<const Eigen::ArrayXf> zdata(in_it.Get().GetDataPointer(),
-                                                                 in_freqs.rows());
-                    QI::SplineInterpolator                 zspec(
-                        in_freqs, zdata.cast<double>(), order.Get(), indices);
 
-                    float f0 = f0_image ? f0_it.Get() : 0.0;
-                    for (int f = 0; f < out_freqs.rows(); f++) {
-                        if (asym) {
-                            const double p_frq = f0 + out_freqs[f];
-                            const double m_frq = f0 - out_freqs[f];
-                            interped[f]        = zspec(m_frq) - zspec(p_frq);
-                        } else {
-                            const double frq = f0 + out_freqs[f];
-                            interped[f]      = zspec(frq);
-                        }
+            // Interpolate tiles of voxels at once
+            int const       tile_size = 1024;
+            Eigen::MatrixXd zdata(in_freqs.rows(), tile_size);
+            Eigen::MatrixXd interped(out_freqs.rows(), tile_size);
+            Eigen::ArrayXd  f0(tile_size);
+            in_it.GoToBegin();
+            while (!in_it.IsAtEnd()) {
+                int n = 0;
+                for (; (n < tile_size) && !in_it.IsAtEnd(); ++n, ++in_it) {
+                    zdata.col(n) = Eigen::Map<const Eigen::VectorXf>(in_it.Get().GetDataPointer(),
+                                                                     in_freqs.rows())
+                                       .cast<double>();
+                    if (f0_image) {
+                        f0[n] = f0_it.Get();
+                        ++f0_it;
                     }
-                    if (ref_arg) {
-                        interped *= (100. / ref_it.Get());
-                        ++ref_it;
+                }
+                if (f0_image) {
+                    Eigen::MatrixXd const ctrls = zspec.fit(zdata.leftCols(n));
+                    for (int v = 0; v < n; v++) {
+                        auto const c = ctrls.col(v);
+                        for (int f = 0; f < out_freqs.rows(); f++) {
+                            if (asym) {
+                                interped(f, v) = zspec.evaluate(c, f0[v] - out_freqs[f]) -
+                                                 zspec.evaluate(c, f0[v] + out_freqs[f]);
+                            } else {
+                                interped(f, v) = zspec.evaluate(c, f0[v] + out_freqs[f]);
+                            }
+                        }
                     }
                 } else {
-                    interped.Fill(0.0);
+                    interped.leftCols(n).noalias() = weights * zdata.leftCols(n);
+                }
+                for (int v = 0; v < n; v++, ++out_it) {
+                    itk::VariableLengthVector<float> out_vec(out_freqs.rows());
+                    if (!mask_image || mask_it.Get()) {
+                        for (int f = 0; f < out_freqs.rows(); f++) {
+                            out_vec[f] = interped(f, v);
+                        }
+                        if (ref_image) {
+                            out_vec *= (100. / ref_it.Get());
+                        }
+                    } else {
+                        out_vec.Fill(0.0);
+                    }
+                    out_it.Set(out_vec);
+                    if (ref_image)
+                        ++ref_it;
+                    if (mask_image)
+                        ++mask_it;
                 }
-                out_it.Set(interped);
-                if (f0_image)
-                    ++f0_it;
-                if (mask_image)
-                    ++mask_it;
             }
         },
         nullptr);
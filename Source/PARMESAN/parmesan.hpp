@@ -1,9 +1,27 @@
 #pragma once
 
 #include "Macro.h"
+#include "ceres/jet.h"
 #include <Eigen/Dense>
 #include <functional>
-#include <unsupported/Eigen/MatrixFunctions>
+
+/*
+ *  The model signals are written once for any scalar type in the .cpp files, and instantiated for
+ *  double (simulation and final residuals) and for the Jets used by ScaledAutoDiffFit. Models that
+ *  VarProFit can fit also need the Jets over everything except the amplitude.
+ */
+template <typename Model> using ParmesanJet = ceres::Jet<double, Model::NV>;
+template <typename Model> using VarProJet   = ceres::Jet<double, Model::NV - 1>;
+
+#define PARMESAN_INSTANTIATE_SIGNAL(Model)                                                         \
+    template auto Model::typed_signal<double>(QI_ARRAYN(double, Model::NV) const &) const          \
+        -> QI_ARRAY(double);                                                                       \
+    template auto Model::typed_signal<ParmesanJet<Model>>(                                         \
+        QI_ARRAYN(ParmesanJet<Model>, Model::NV) const &) const -> QI_ARRAY(ParmesanJet<Model>);
+
+#define PARMESAN_INSTANTIATE_VARPRO(Model)                                                         \
+    template auto Model::typed_signal<VarProJet<Model>>(                                           \
+        QI_ARRAYN(VarProJet<Model>, Model::NV) const &) const -> QI_ARRAY(VarProJet<Model>);
 
 template <typename AugmentedMatrix>
 auto SolveSteadyState(AugmentedMatrix const &X)
@@ -19,7 +37,7 @@ auto SolveSteadyState(AugmentedMatrix const &X)
     ReducedVector   b    = -X.template topRightCorner<N - 1, 1>();
     ReducedVector   m_ss = Xr.partialPivLu().solve(b);
     AugmentedVector m_aug;
-    m_aug << m_ss, 1.;
+    m_aug << m_ss, T(1.);
     return m_aug;
 }
 
@@ -37,8 +55,27 @@ auto GeometricAvg(AugmentedMatrix const &X,
 
     AugmentedMatrix const LHS = (AugmentedMatrix::Identity() - X);
     ReducedVector const   RHS = ((AugmentedMatrix::Identity() - Xn) * a).template head<N - 1>() -
-                              (n * LHS.template topRightCorner<N - 1, 1>());
+                              (double(n) * LHS.template topRightCorner<N - 1, 1>());
     ReducedVector const m_gm =
-        LHS.template topLeftCorner<N - 1, N - 1>().partialPivLu().solve(RHS) / n;
+        LHS.template topLeftCorner<N - 1, N - 1>().partialPivLu().solve(RHS) / double(n);
     return m_gm;
 }
+
+/*
+ *  GeometricAvg() is linear in the start vector a, so when the same X is started from many vectors
+ *  factorise once and return G with GeometricAvg(X, Xn, a, n) = G * a
+ */
+template <typename AugmentedMatrix>
+auto GeometricAvgMatrix(AugmentedMatrix const &X, AugmentedMatrix const &Xn, int const &n)
+    -> Eigen::Matrix<typename AugmentedMatrix::Scalar,
+                     AugmentedMatrix::RowsAtCompileTime - 1,
+                     AugmentedMatrix::RowsAtCompileTime> {
+    const long N = AugmentedMatrix::RowsAtCompileTime;
+
+    AugmentedMatrix const LHS = (AugmentedMatrix::Identity() - X);
+    AugmentedMatrix       RHS = (AugmentedMatrix::Identity() - Xn);
+    RHS.template topRightCorner<N - 1, 1>() -= double(n) * LHS.template topRightCorner<N - 1, 1>();
+    return LHS.template topLeftCorner<N - 1, N - 1>().partialPivLu().solve(
+               RHS.template topRows<N - 1>()) /
+           double(n);
+}
@@ -0,0 +1,258 @@
+#pragma once
+
+/*
+ *  Propagators for the augmented Bloch equations used by the PARMESAN models. The magnetisation
+ *  vector has a trailing 1 so that recovery towards M0 is linear, and the propagator over time t
+ *  is the exponential of the augmented system matrix. Where at most two components are coupled
+ *  this has a closed form. Otherwise ExpPade() is used, which is cheaper than Eigen's general
+ *  MatrixFunctions because it only handles small fixed-size matrices.
+ *
+ *  Everything is templated on the scalar type so it can be used with Jets. Jets cannot be built
+ *  implicitly from a double, hence the T(0.) and T(1.) in the comma initializers.
+ */
+
+#include <Eigen/Dense>
+#include <cmath>
+
+/*
+ *  exp(A t) for a real 2x2 matrix. With mean eigenvalue m and d = ((a00 - a11) / 2)^2 + a01 a10,
+ *  exp(A t) = exp(m t) (C I + S (A - m I)), where C and S are cosh and sinh / sqrt(d) if d > 0,
+ *  or cos and sin / sqrt(-d) if d < 0, with series expansions when d t^2 is small.
+ */
+template <typename T> Eigen::Matrix<T, 2, 2> Exp2(Eigen::Matrix<T, 2, 2> const &A, double const t) {
+    using std::cos;
+    using std::cosh;
+    using std::exp;
+    using std::sin;
+    using std::sinh;
+    using std::sqrt;
+    T const m   = 0.5 * (A(0, 0) + A(1, 1));
+    T const h   = 0.5 * (A(0, 0) - A(1, 1));
+    T const d   = h * h + A(0, 1) * A(1, 0);
+    T const dt2 = d * (t * t);
+    T       C, S;
+    if (dt2 > 1e-8) {
+        T const q = sqrt(d);
+        C         = cosh(q * t);
+        S         = sinh(q * t) / q;
+    } else if (dt2 < -1e-8) {
+        T const q = sqrt(-d);
+        C         = cos(q * t);
+        S         = sin(q * t) / q;
+    } else {
+        C = 1. + dt2 / 2.;
+        S = t * (1. + dt2 / 6.);
+    }
+    T const                em = exp(m * t);
+    Eigen::Matrix<T, 2, 2> E;
+    E << em * (C + S * h), em * S * A(0, 1), //
+        em * S * A(1, 0), em * (C - S * h);
+    return E;
+}
+
+/*
+ *  Propagator for dm/dt = A m + b over time t for two coupled components, augmented to 3x3. The
+ *  constant term is A^-1 (exp(A t) - I) b, so A must be invertible, which is the case whenever
+ *  both components relax.
+ */
+template <typename T>
+Eigen::Matrix<T, 3, 3>
+AugmentedExp2(Eigen::Matrix<T, 2, 2> const &A, Eigen::Vector<T, 2> const &b, double const t) {
+    Eigen::Matrix<T, 2, 2> const E   = Exp2(A, t);
+    Eigen::Vector<T, 2> const    Db  = (E - Eigen::Matrix<T, 2, 2>::Identity()) * b;
+    T const                      det = A(0, 0) * A(1, 1) - A(0, 1) * A(1, 0);
+    Eigen::Matrix<T, 3, 3>       P;
+    P << E(0, 0), E(0, 1), (A(1, 1) * Db[0] - A(0, 1) * Db[1]) / det, //
+        E(1, 0), E(1, 1), (A(0, 0) * Db[1] - A(1, 0) * Db[0]) / det,  //
+        T(0.), T(0.), T(1.);
+    return P;
+}
+
+/*
+ *  exp(A) for a small fixed-size matrix with a Pade approximant, following Higham (2005). The
+ *  degree is the lowest of 3, 5 or 7 that is accurate to double precision at the norm of A, and
+ *  larger norms are scaled and squared. Used where three or more components are coupled.
+ */
+template <typename Matrix> Matrix ExpPade(Matrix const &A) {
+    using T = typename Matrix::Scalar;
+    static double const b3[] = {120., 60., 12., 1.};
+    static double const b5[] = {30240., 15120., 3360., 420., 30., 1.};
+    static double const b7[] = {17297280., 8648640., 1995840., 277200., 25200., 1512., 56., 1.};
+    Matrix const        I    = Matrix::Identity();
+    T const             norm = A.cwiseAbs().colwise().sum().maxCoeff();
+    if (norm <= 1.495585217958292e-2) {
+        Matrix const A2 = A * A;
+        Matrix const U  = A * (b3[3] * A2 + b3[1] * I);
+        Matrix const V  = b3[2] * A2 + b3[0] * I;
+        return (V - U).partialPivLu().solve(V + U);
+    }
+    if (norm <= 2.539398330063230e-1) {
+        Matrix const A2 = A * A;
+        Matrix const A4 = A2 * A2;
+        Matrix const U  = A * (b5[5] * A4 + b5[3] * A2 + b5[1] * I);
+        Matrix const V  = b5[4] * A4 + b5[2] * A2 + b5[0] * I;
+        return (V - U).partialPivLu().solve(V + U);
+    }
+    double const theta  = 9.504178996162932e-1; // Largest norm for the [7/7] approximant
+    int          s      = 0;
+    T            scaled = norm;
+    while (scaled > theta) {
+        scaled *= 0.5;
+        s++;
+    }
+    Matrix const As = A * T(std::ldexp(1., -s));
+    Matrix const A2 = As * As;
+    Matrix const A4 = A2 * A2;
+    Matrix const A6 = A4 * A2;
+    Matrix const U  = As * (b7[7] * A6 + b7[5] * A4 + b7[3] * A2 + b7[1] * I);
+    Matrix const V  = b7[6] * A6 + b7[4] * A4 + b7[2] * A2 + b7[0] * I;
+    Matrix       E  = (V - U).partialPivLu().solve(V + U);
+    for (int i = 0; i < s; i++) {
+        E = E * E;
+    }
+    return E;
+}
+
+// X^n for integer n >= 0 by repeated squaring
+template <typename Matrix> Matrix Pow(Matrix X, int n) {
+    Matrix P = Matrix::Identity();
+    while (n > 0) {
+        if (n & 1) {
+            P = P * X;
+        }
+        n >>= 1;
+        if (n > 0) {
+            X = X * X;
+        }
+    }
+    return P;
+}
+
+// Longitudinal magnetisation of one pool, ordered (z, 1), relaxing towards M0
+template <typename T>
+Eigen::Matrix<T, 2, 2> LongitudinalRelax(T const &R1, T const &M0, double const t) {
+    using std::exp;
+    T const                E1 = exp(-R1 * t);
+    Eigen::Matrix<T, 2, 2> P;
+    P << E1, M0 * (1. - E1), //
+        T(0.), T(1.);
+    return P;
+}
+
+/*
+ *  One pool, ordered (x, y, z, 1), relaxing towards z = M0.
+ */
+template <typename T>
+Eigen::Matrix<T, 4, 4> OnePoolRelax(T const &R1, T const &R2, T const &M0, double const t) {
+    using std::exp;
+    T const                E1 = exp(-R1 * t);
+    T const                E2 = exp(-R2 * t);
+    Eigen::Matrix<T, 4, 4> P  = Eigen::Matrix<T, 4, 4>::Zero();
+    P(0, 0)                   = E2;
+    P(1, 1)                   = E2;
+    P(2, 2)                   = E1;
+    P(2, 3)                   = M0 * (1. - E1);
+    P(3, 3)                   = T(1.);
+    return P;
+}
+
+// As above, with an on-resonance pulse of amplitude w (radians per second) about x
+template <typename T>
+Eigen::Matrix<T, 4, 4>
+OnePoolPulse(T const &R1, T const &R2, T const &M0, T const &w, double const t) {
+    using std::exp;
+    Eigen::Matrix<T, 2, 2> A;
+    A << -R2, w, //
+        -w, -R1;
+    Eigen::Vector<T, 2> const b{T(0.), R1 * M0};
+
+    Eigen::Matrix<T, 4, 4> P             = Eigen::Matrix<T, 4, 4>::Zero();
+    P(0, 0)                              = exp(-R2 * t);
+    P.template bottomRightCorner<3, 3>() = AugmentedExp2(A, b, t);
+    return P;
+}
+
+// Rotation about (w_x, w_y, 0) in the (x, y, z, 1) ordering used by rf_sim, by Rodrigues' formula
+template <typename T>
+Eigen::Matrix<T, 4, 4> OnePoolRotation(T const &w_x, T const &w_y, double const t) {
+    using std::cos;
+    using std::sin;
+    using std::sqrt;
+    Eigen::Matrix<T, 3, 3> K;
+    K << T(0.), T(0.), -w_y, //
+        T(0.), T(0.), -w_x,  //
+        w_y, w_x, T(0.);
+    // exp(K t) = I + sin(theta) / theta K t + (1 - cos(theta)) / theta^2 (K t)^2
+    T const theta2 = (w_x * w_x + w_y * w_y) * (t * t);
+    T       a, b;
+    if (theta2 > 1e-12) {
+        T const theta = sqrt(theta2);
+        a             = sin(theta) / theta;
+        b             = (1. - cos(theta)) / theta2;
+    } else {
+        a = 1. - theta2 / 6.;
+        b = 0.5 - theta2 / 24.;
+    }
+    Eigen::Matrix<T, 4, 4> P         = Eigen::Matrix<T, 4, 4>::Identity();
+    P.template topLeftCorner<3, 3>() += (a * t) * K + (b * t * t) * (K * K);
+    return P;
+}
+
+/*
+ *  Free water and bound pools, ordered (x, y, z_f, z_b, 1), with exchange rates k_fb and k_bf and
+ *  recovery towards M0_f and M0_b. Only the free pool has transverse magnetisation.
+ */
+template <typename T>
+Eigen::Matrix<T, 5, 5> TwoPoolRelax(T const &    R1_f,
+                                    T const &    R1_b,
+                                    T const &    R2_f,
+                                    T const &    k_fb,
+                                    T const &    k_bf,
+                                    T const &    M0_f,
+                                    T const &    M0_b,
+                                    double const t) {
+    using std::exp;
+    Eigen::Matrix<T, 2, 2> A;
+    A << -R1_f - k_fb, k_bf, //
+        k_fb, -R1_b - k_bf;
+    Eigen::Vector<T, 2> const b{R1_f * M0_f, R1_b * M0_b};
+    T const                   E2 = exp(-R2_f * t);
+
+    Eigen::Matrix<T, 5, 5> P             = Eigen::Matrix<T, 5, 5>::Zero();
+    P(0, 0)                              = E2;
+    P(1, 1)                              = E2;
+    P.template bottomRightCorner<3, 3>() = AugmentedExp2(A, b, t);
+    return P;
+}
+
+/*
+ *  As above, with an on-resonance pulse of amplitude w about x that also saturates the bound
+ *  pool at rate W. Here y, z_f and z_b are all coupled, so that block uses ExpPade().
+ */
+template <typename T>
+Eigen::Matrix<T, 5, 5> TwoPoolPulse(T const &    R1_f,
+                                    T const &    R1_b,
+                                    T const &    R2_f,
+                                    T const &    k_fb,
+                                    T const &    k_bf,
+                                    T const &    M0_f,
+                                    T const &    M0_b,
+                                    T const &    w,
+                                    T const &    W,
+                                    double const t) {
+    using std::exp;
+    Eigen::Matrix<T, 4, 4> A = Eigen::Matrix<T, 4, 4>::Zero();
+    A(0, 0)                  = -R2_f;
+    A(0, 1)                  = w;
+    A(1, 0)                  = -w;
+    A(1, 1)                  = -R1_f - k_fb;
+    A(1, 2)                  = k_bf;
+    A(1, 3)                  = R1_f * M0_f;
+    A(2, 1)                  = k_fb;
+    A(2, 2)                  = -R1_b - k_bf - W;
+    A(2, 3)                  = R1_b * M0_b;
+    Eigen::Matrix<T, 5, 5> P             = Eigen::Matrix<T, 5, 5>::Zero();
+    P(0, 0)                              = exp(-R2_f * t);
+    P.template bottomRightCorner<4, 4>() = ExpPade<Eigen::Matrix<T, 4, 4>>(A * t);
+    return P;
+}
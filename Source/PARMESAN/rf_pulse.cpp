@@ -10,6 +10,11 @@ void from_json(const json &j, RFPulse &p) {
     if (p.B1x.rows() != p.B1y.rows()) {
         QI::Fail("B1x and B1y array lengths did not match {} vs {}", p.B1x.rows(), p.B1y.rows());
     }
+    if (p.timestep.rows() != p.B1x.rows()) {
+        QI::Fail("timestep and B1x array lengths did not match {} vs {}",
+                 p.timestep.rows(),
+                 p.B1x.rows());
+    }
 }
 
 void to_json(json &j, RFPulse const &p) {
@@ -10,7 +10,9 @@
  */
 
 #include <Eigen/Core>
-#include <unsupported/Eigen/MatrixFunctions>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
 
 // #define QI_DEBUG_BUILD 1
 
@@ -18,7 +20,9 @@
 #include "JSON.h"
 #include "Macro.h"
 #include "Util.h"
+#include "itkMultiThreaderBase.h"
 
+#include "propagators.hpp"
 #include "rf_pulse.h"
 #include "transient_sequence.h"
 
@@ -30,6 +34,78 @@ double round_sig(double value, int digits) {
     return std::round(value * factor) / factor;
 }
 
+/*
+ *  Integrate the on-resonance magnetisation through a shaped pulse. Shaped pulses are often
+ *  piecewise-constant, so each run of identical samples shares one rotation, and runs without RF
+ *  leave the magnetisation unchanged and are accumulated in one step.
+ */
+PrepPulse SimulatePulse(RFPulse const &pulse, double const scale) {
+    Eigen::Vector<double, 4> m_rf{0, 0, 1., 1.};
+
+    double     int_b1_sq = 0;
+    double     eff_tv    = 0;
+    double     eff_long  = 0;
+    long const n         = pulse.B1x.rows();
+    for (long ii = 0; ii < n;) {
+        long run = 1;
+        while ((ii + run < n) && (pulse.B1x[ii + run] == pulse.B1x[ii]) &&
+               (pulse.B1y[ii + run] == pulse.B1y[ii]) &&
+               (pulse.timestep[ii + run] == pulse.timestep[ii])) {
+            run++;
+        }
+
+        double const B1x   = pulse.B1x[ii] * scale;
+        double const B1y   = pulse.B1y[ii] * scale;
+        double const dt    = pulse.timestep[ii] * 1e-6;
+        double const b1_sq = (B1x * B1x + B1y * B1y);
+        int_b1_sq += run * b1_sq * dt;
+        if (b1_sq > 0.) {
+            auto const A_rf = OnePoolRotation(B1x, B1y, dt);
+            for (long ir = 0; ir < run; ir++) {
+                m_rf = A_rf * m_rf;
+                eff_tv += m_rf.head(2).norm() * dt;
+                eff_long += std::abs(m_rf[2]) * dt;
+            }
+        } else {
+            eff_tv += run * m_rf.head(2).norm() * dt;
+            eff_long += run * std::abs(m_rf[2]) * dt;
+        }
+        ii += run;
+    }
+
+    double const eff_flip_onres = atan2(m_rf.head(2).norm(), m_rf[2]);
+    return PrepPulse{round_sig(eff_flip_onres, 3),
+                     round_sig(int_b1_sq, 4),
+                     round_sig(eff_long, 4),
+                     round_sig(eff_tv, 4)};
+}
+
+/*
+ *  Cache key for a pulse, a 64-bit FNV-1a hash of the samples and units. Bump the version if the
+ *  simulation changes so old entries are ignored.
+ */
+std::string PulseKey(RFPulse const &pulse, double const scale) {
+    int const     version = 1;
+    std::uint64_t h       = 14695981039346656037ULL;
+    auto const    add     = [&](void const *data, size_t const bytes) {
+        auto const *p = static_cast<unsigned char const *>(data);
+        for (size_t i = 0; i < bytes; i++) {
+            h = (h ^ p[i]) * 1099511628211ULL;
+        }
+    };
+    auto const add_array = [&](Eigen::ArrayXd const &a) {
+        Eigen::Index const n = a.rows();
+        add(&n, sizeof(n));
+        add(a.data(), n * sizeof(double));
+    };
+    add(&version, sizeof(version));
+    add(&scale, sizeof(scale));
+    add_array(pulse.B1x);
+    add_array(pulse.B1y);
+    add_array(pulse.timestep);
+    return fmt::format("{:016x}", h);
+}
+
 /*
  * Main
  */
@@ -40,94 +116,61 @@ int rf_sim_main(args::Subparser &parser) {
                                  "Use N threads (default=hardware limit or $QUIT_THREADS)",
                                  {'T', "threads"},
                                  QI::GetDefaultThreads());
+    args::ValueFlag<std::string>  cache_dir(
+        parser, "CACHE", "Cache results for each pulse in this directory", {'c', "cache"});
     args::Positional<std::string> in_file(parser, "INPUT", "Input JSON file");
     // args::Positional<std::string> output_path(parser, "OUTPUT", "Output JSON file");
     parser.Parse();
     QI::CheckPos(in_file);
 
-    double const R1 = 1. / 1.0;
-    double const R2 = 1. / 0.1;
-    double const PD = 1.;
-
-    using AugMat = Eigen::Matrix<double, 4, 4>;
-    using AugVec = Eigen::Vector<double, 4>;
-    AugMat R;
-    R << -R2, 0, 0, 0,      //
-        0, -R2, 0, 0,       //
-        0, 0, -R1, PD * R1, //
-        0, 0, 0, 0;
-
-    AugVec m0{0, 0, PD, 1.};
-
     QI::Log(verbose, "Reading pulses");
     json input = QI::ReadJSON(in_file.Get());
 
     std::vector<RFPulse>   input_pulses = input.at("pulses").get<std::vector<RFPulse>>();
-    std::vector<PrepPulse> output_pulses;
+    std::vector<PrepPulse> output_pulses(input_pulses.size());
 
     double const scale = uT ? 267.52219 : 1.0; // radians per second per uT
 
-    for (auto const pulse : input_pulses) {
-        double int_b1    = 0;
-        double int_b1_sq = 0;
-        double max_b1    = 0;
-        double eff_tv    = 0;
-        double eff_long  = 0;
-
-        double tact_total = 0;
-        AugMat C_rf       = AugMat::Identity();
-        AugMat C_both     = AugMat::Identity();
-        AugVec m_rf       = m0;
-        for (long ii = 0; ii < pulse.B1x.rows(); ii++) {
-
-            double const &B1x = pulse.B1x[ii] * scale;
-            double const &B1y = pulse.B1y[ii] * scale;
-            auto const    dt  = pulse.timestep[ii] * 1e-6;
-
-            double b1_sq = (B1x * B1x + B1y * B1y);
-            double b1    = sqrt(b1_sq);
-            int_b1 += b1 * dt;
-            int_b1_sq += b1_sq * dt;
-            if (b1 > max_b1) {
-                max_b1 = b1;
+    // Cache entries hold FAeff (radians), int_b1_sq, T_long, T_trans
+    std::vector<std::string> cache_paths(input_pulses.size());
+    std::vector<size_t>      todo;
+    for (size_t ip = 0; ip < input_pulses.size(); ip++) {
+        if (cache_dir) {
+            auto const key  = PulseKey(input_pulses[ip], scale);
+            cache_paths[ip] = (std::filesystem::path(cache_dir.Get()) / (key + ".json")).string();
+            if (std::filesystem::exists(cache_paths[ip])) {
+                auto const e      = QI::ReadJSON(cache_paths[ip]).get<std::vector<double>>();
+                output_pulses[ip] = PrepPulse{e.at(0), e.at(1), e.at(2), e.at(3)};
+                continue;
             }
-
-            AugMat rf;
-            rf << 0, 0, -B1y, 0, //
-                0, 0, -B1x, 0,   //
-                B1y, B1x, 0, 0,  //
-                0, 0, 0, 0;
-
-            AugMat const A_rf   = (rf * dt).exp();
-            AugMat const both   = R + rf;
-            AugMat const A_both = (both * dt).exp();
-
-            C_rf   = A_rf * C_rf;
-            C_both = A_both * C_both;
-            m_rf   = A_rf * m_rf;
-            if (b1_sq > 0.) {
-                tact_total += dt;
+        }
+        todo.push_back(ip);
+    }
+    QI::Log(verbose, "Simulating {} of {} pulses", todo.size(), input_pulses.size());
+
+    auto mt = itk::MultiThreaderBase::New();
+    mt->SetNumberOfWorkUnits(threads.Get());
+    mt->ParallelizeArray(
+        0,
+        todo.size(),
+        [&](itk::SizeValueType const it) {
+            output_pulses[todo[it]] = SimulatePulse(input_pulses[todo[it]], scale);
+        },
+        nullptr);
+
+    if (cache_dir) {
+        std::filesystem::create_directories(cache_dir.Get());
+        for (auto const ip : todo) {
+            auto const &p = output_pulses[ip];
+            // Write then rename, so another run never reads a half-written entry
+            auto const tmp_path = cache_paths[ip] + ".tmp";
+            QI::WriteJSON(tmp_path, json{p.FAeff, p.int_b1_sq, p.T_long, p.T_trans});
+            if (std::rename(tmp_path.c_str(), cache_paths[ip].c_str()) != 0) {
+                QI::Warn("Failed to write cache entry {}", cache_paths[ip]);
             }
-            eff_tv += sqrt(m_rf[0] * m_rf[0] + m_rf[1] * m_rf[1]) * dt;
-            eff_long += std::abs(m_rf[2]) * dt;
         }
-
-        double const eff_flip_onres = atan2(m_rf.head(2).norm(), m_rf[2]);
-        // double const p1             = (int_b1 / tact_total) / max_b1;
-        // double const p2             = (int_b1_sq / tact_total) / (max_b1 * max_b1);
-
-        output_pulses.push_back(PrepPulse{round_sig(eff_flip_onres, 3),
-                                          round_sig(int_b1_sq, 4),
-                                          round_sig(eff_long, 4),
-                                          round_sig(eff_tv, 4)});
-
-        AugMat approx;
-        approx << 0, 0, 0, 0, //
-            0, 0, 0, 0,       //
-            0, 0, exp(-R2 * eff_tv) * cos(eff_flip_onres),
-            PD * (1 - exp(-R1 * eff_long)), //
-            0, 0, 0, 1;
     }
+
     json output;
     output["pulses"] = output_pulses;
     fmt::print("{}\n", output.dump(2));
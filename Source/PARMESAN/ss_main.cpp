@@ -14,6 +14,7 @@
 // #define QI_DEBUG_BUILD 1
 
 #include "Args.h"
+#include "FitScaledAuto.h"
 #include "FitScaledNumeric.h"
 #include "ImageIO.h"
 #include "Macro.h"
@@ -35,8 +36,16 @@ int ss_main(args::Subparser &parser) {
     args::Flag                   MT(parser, "MT", "Fit MT model", {"MT"});
     args::ValueFlag<std::string> ls_arg(
         parser, "LINESHAPE", "Path to lineshape file", {"lineshape"});
+    args::Flag                   numeric(
+        parser, "NUMERIC", "Use numeric derivatives (default depends on model)", {"numeric"});
+    args::Flag                   autodiff(
+        parser, "AUTODIFF", "Use automatic derivatives (default depends on model)", {"autodiff"});
+    QI_TELEMETRY_ARG;
     parser.Parse();
     QI::CheckPos(input_path);
+    if (numeric && autodiff) {
+        QI::Fail("--numeric and --autodiff cannot be used together");
+    }
     QI::Log(verbose, "Reading sequence parameters");
     json       doc = json_file ? QI::ReadJSON(json_file.Get()) : QI::ReadJSON(std::cin);
     SSSequence sequence(doc);
@@ -53,17 +62,28 @@ int ss_main(args::Subparser &parser) {
                                                       verbose,
                                                       simulate.Get(),
                                                       threads.Get(),
-                                                      subregion.Get());
+                                                      subregion.Get(),
+                                                      seed.Get());
         } else {
-            using FitType = QI::ScaledNumericDiffFit<decltype(model), decltype(model)::NS>;
-            FitType fit(model);
-
-            auto fit_filter =
-                QI::ModelFitFilter<FitType>::New(
+            auto run = [&](auto &fit) {
+                using FitType   = std::remove_reference_t<decltype(fit)>;
+                auto fit_filter = QI::ModelFitFilter<FitType>::New(
                     &fit, verbose, covar, resids, threads.Get(), subregion.Get());
-            fit_filter->ReadInputs({input_path.Get()}, fixed, mask.Get());
-            fit_filter->Update();
-            fit_filter->WriteOutputs(prefix.Get() + model_name);
+                fit_filter->SetTelemetry(telemetry.Get());
+                fit_filter->ReadInputs({input_path.Get()}, fixed, mask.Get());
+                fit_filter->Update();
+                fit_filter->WriteOutputs(prefix.Get() + model_name);
+            };
+            using ModelType = decltype(model);
+            if (numeric || (!autodiff && !ModelType::prefer_autodiff)) {
+                QI::Log(verbose, "Using numeric derivatives");
+                QI::ScaledNumericDiffFit<ModelType, ModelType::NS> fit{model};
+                run(fit);
+            } else {
+                QI::Log(verbose, "Using automatic derivatives");
+                QI::ScaledAutoDiffFit<ModelType, int, ModelType::NS> fit{model};
+                run(fit);
+            }
         }
     };
 
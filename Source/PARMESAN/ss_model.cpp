@@ -1,10 +1,11 @@
 // #define QI_DEBUG_BUILD 1
 #include "Macro.h"
 #include "parmesan.hpp"
+#include "propagators.hpp"
 #include "ss_model.h"
 
-auto SS_T1_Model::signal(VaryingArray const &v, FixedArray const &) const -> QI_ARRAY(double) {
-    using T      = double;
+template <typename T>
+auto SS_T1_Model::typed_signal(QI_ARRAYN(T, NV) const &v) const -> QI_ARRAY(T) {
     using AugMat = Eigen::Matrix<T, 2, 2>; // Short for Augmented Matrix
     using AugVec = Eigen::Vector<T, 2>;
 
@@ -12,27 +13,22 @@ auto SS_T1_Model::signal(VaryingArray const &v, FixedArray const &) const -> QI_
     T const &R1 = 1. / v[1];
     T const &B1 = v[2];
 
-    AugMat R;
-    R << -R1, M0 * R1, //
-        0, 0;
-
     // Setup constant matrices
-    AugMat const Rrd  = (R * sequence.TR).exp();
-    AugMat const ramp = (R * sequence.Tramp).exp();
-    // AugMat const prep_spoiler = (R * sequence.Tspoil).exp();
+    AugMat const Rrd  = LongitudinalRelax(R1, M0, sequence.TR);
+    AugMat const ramp = LongitudinalRelax(R1, M0, sequence.Tramp);
 
-    Eigen::ArrayXd sig(sequence.size());
+    QI_ARRAY(T) sig(sequence.size());
     for (long is = 0; is < sequence.size(); is++) {
         AugMat rf1;
-        rf1 << cos(B1 * sequence.FA[is]), 0, //
-            0, 1;
+        rf1 << cos(B1 * sequence.FA[is]), T(0.), //
+            T(0.), T(1.);
 
         AugMat TR_mat  = Rrd * rf1;
-        AugMat seg_mat = TR_mat.pow(sequence.spokes_per_seg);
+        AugMat seg_mat = Pow(TR_mat, sequence.spokes_per_seg);
 
         AugMat rfp;
-        rfp << cos(B1 * sequence.prep_FA[is]), 0, //
-            0, 1;
+        rfp << cos(B1 * sequence.prep_FA[is]), T(0.), //
+            T(0.), T(1.);
 
         // Calculate the steady-state just before the segment readout
         AugMat X    = AugMat::Identity();
@@ -51,3 +47,4 @@ auto SS_T1_Model::signal(VaryingArray const &v, FixedArray const &) const -> QI_
     QI_DBVEC(sig)
     return sig;
 }
+PARMESAN_INSTANTIATE_SIGNAL(SS_T1_Model)
@@ -7,13 +7,25 @@ struct SS_T1_Model : QI::Model<double, double, 3, 0> {
     static int const   NS = 1;
     SSSequence &       sequence;
     VaryingArray const start{30.0, 1.0, 1};
-    VaryingArray const lo{0.1, 0.5, 0.5};
-    VaryingArray const hi{60.0, 5.0, 1.5};
+    VaryingArray const bounds_lo{0.1, 0.5, 0.5};
+    VaryingArray const bounds_hi{60.0, 5.0, 1.5};
 
     std::array<std::string, NV> const varying_names{"M0", "T1", "B1"};
 
-    int  input_size(const int /* Unused */) const { return sequence.size(); }
-    auto signal(VaryingArray const &v, FixedArray const &) const -> QI_ARRAY(double);
+    // Whether ss_main fits with automatic derivatives by default, see qi_bench_parmesan
+    static bool const prefer_autodiff = true;
+
+    int input_size(const int /* Unused */) const { return sequence.size(); }
+
+    // Instantiated for double and Jets in the .cpp
+    template <typename T> auto typed_signal(QI_ARRAYN(T, NV) const &v) const -> QI_ARRAY(T);
+
+    template <typename Derived>
+    auto signal(Eigen::ArrayBase<Derived> const &v, FixedArray const &) const
+        -> QI_ARRAY(typename Derived::Scalar) {
+        return typed_signal<typename Derived::Scalar>(v);
+    }
+
     void derived(const VaryingArray &varying, const FixedArray &, DerivedArray &derived) const;
 };
 
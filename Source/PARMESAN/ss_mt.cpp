@@ -1,13 +1,13 @@
 // #define QI_DEBUG_BUILD 1
 #include "Macro.h"
 #include "parmesan.hpp"
+#include "propagators.hpp"
 #include "ss_mt.h"
 
-using AugMat = Eigen::Matrix<double, 5, 5>; // Short for Augmented Matrix
-using AugVec = Eigen::Vector<double, 5>;
-
-auto SS_MT_Model::signal(VaryingArray const &v, FixedArray const &) const -> QI_ARRAY(double) {
-    using T = double;
+template <typename T>
+auto SS_MT_Model::typed_signal(QI_ARRAYN(T, NV) const &v) const -> QI_ARRAY(T) {
+    using AugMat = Eigen::Matrix<T, 5, 5>; // Short for Augmented Matrix
+    using AugVec = Eigen::Vector<T, 5>;
 
     T const &M0_f = v[0];
     T const &M0_b = v[1];
@@ -21,27 +21,24 @@ auto SS_MT_Model::signal(VaryingArray const &v, FixedArray const &) const -> QI_
     T const &f0   = v[6];
     T const &B1p  = v[7];
 
-    AugMat R;
-    R << -R2_f, 0, 0, 0, 0,          //
-        0, -R2_f, 0, 0, 0,           //
-        0, 0, -R1_f, 0, M0_f * R1_f, //
-        0, 0, 0, -R1_b, M0_b * R1_b, //
-        0, 0, 0, 0, 0;
-
-    AugMat K;
-    K << 0, 0, 0, 0, 0,       //
-        0, 0, 0, 0, 0,        //
-        0, 0, -k_fb, k_bf, 0, //
-        0, 0, k_fb, -k_bf, 0, //
-        0, 0, 0, 0, 0;
-
-    AugMat const S = Eigen::DiagonalMatrix<double, 5, 5>({0, 0, 1., 1., 1.}).toDenseMatrix();
+    AugMat RpK = AugMat::Zero();
+    RpK(0, 0)  = -R2_f;
+    RpK(1, 1)  = -R2_f;
+    RpK(2, 2)  = -R1_f - k_fb;
+    RpK(2, 3)  = k_bf;
+    RpK(2, 4)  = M0_f * R1_f;
+    RpK(3, 2)  = k_fb;
+    RpK(3, 3)  = -R1_b - k_bf;
+    RpK(3, 4)  = M0_b * R1_b;
 
-    AugMat const RpK = R + K;
+    AugMat const S = Eigen::DiagonalMatrix<double, 5, 5>({0, 0, 1., 1., 1.})
+                         .toDenseMatrix()
+                         .template cast<T>();
 
     // Setup constant matrices
-    AugMat const Rrd  = (RpK * (sequence.TR - sequence.Trf)).exp();
-    AugMat const ramp = (RpK * sequence.Tramp).exp();
+    AugMat const Rrd =
+        TwoPoolRelax(R1_f, R1_b, R2_f, k_fb, k_bf, M0_f, M0_b, sequence.TR - sequence.Trf);
+    AugMat const ramp = TwoPoolRelax(R1_f, R1_b, R2_f, k_fb, k_bf, M0_f, M0_b, sequence.Tramp);
 
     auto RF = [&RpK, &T2_b, &f0, &B1p, this](double const alpha,
                                              double const tau,
@@ -54,19 +51,19 @@ auto SS_MT_Model::signal(VaryingArray const &v, FixedArray const &) const -> QI_
         T const G = this->lineshape(f0 + df, T2_b);
         T const W = M_PI * B1p * B1p * G * (p2 / (p1 * p1)) * (alpha * alpha) / (tau * tau);
 
-        AugMat rf;
-        rf << 0, dw, 0, 0, 0, //
-            -dw, 0, B1, 0, 0, //
-            0, -B1, 0, 0, 0,  //
-            0, 0, 0, -W, 0,   //
-            0, 0, 0, 0, 0;
+        AugMat rf = AugMat::Zero();
+        rf(0, 1)  = dw;
+        rf(1, 0)  = -dw;
+        rf(1, 2)  = B1;
+        rf(2, 1)  = -B1;
+        rf(3, 3)  = -W;
         QI_DBMAT(rf);
-        AugMat const Arf = ((rf + RpK) * tau).exp();
+        AugMat const Arf = ExpPade<AugMat>((rf + RpK) * tau);
         QI_DBMAT(Arf);
         return Arf;
     };
 
-    Eigen::ArrayXd sig(sequence.size());
+    QI_ARRAY(T) sig(sequence.size());
     for (long is = 0; is < sequence.size(); is++) {
         AugMat const rfp     = RF(sequence.prep_FA[is],
                               sequence.prep_Trf,
@@ -75,7 +72,7 @@ auto SS_MT_Model::signal(VaryingArray const &v, FixedArray const &) const -> QI_
                               sequence.prep_p2);
         AugMat const rf1     = RF(sequence.FA[is], sequence.Trf, 0., 1., 1.);
         AugMat       TR_mat  = S * Rrd * rf1;
-        AugMat       seg_mat = TR_mat.pow(sequence.spokes_per_seg);
+        AugMat       seg_mat = Pow(TR_mat, sequence.spokes_per_seg);
 
         // Calculate the steady-state just before the segment readout
         AugMat X    = AugMat::Identity();
@@ -88,6 +85,7 @@ auto SS_MT_Model::signal(VaryingArray const &v, FixedArray const &) const -> QI_
     QI_DBVEC(sig)
     return sig;
 }
+PARMESAN_INSTANTIATE_SIGNAL(SS_MT_Model)
 
 void SS_MT_Model::derived(const VaryingArray &varying,
                           const FixedArray & /* Unused */,
@@ -9,16 +9,27 @@ struct SS_MT_Model : QI::Model<double, double, 8, 0, 1, 1> {
     SSSequence &        sequence;
     QI::InterpLineshape lineshape;
     VaryingArray const  start{30.0, 3.0, 1.0, 0.1, 12e-6, 30., 0., 1.0};
-    VaryingArray const  lo{0.1, 5e-6, 0.5, 0.005, 5e-6, 1., -250., 0.5};
-    VaryingArray const  hi{60.0, 30.0, 5.0, 5.0, 25e-6, 100., 250., 1.5};
+    VaryingArray const  bounds_lo{0.1, 5e-6, 0.5, 0.005, 5e-6, 1., -250., 0.5};
+    VaryingArray const  bounds_hi{60.0, 30.0, 5.0, 5.0, 25e-6, 100., 250., 1.5};
 
     std::array<std::string, NV> const varying_names{
         "M0_f", "M0_b", "T1_f", "T2_f", "T2_b", "k", "f0", "B1"};
     std::array<std::string, ND> const derived_names{"f_b"};
 
+    // Whether ss_main fits with automatic derivatives by default, see qi_bench_parmesan
+    static bool const prefer_autodiff = false;
+
     int input_size(const int /* Unused */) const { return sequence.size(); }
 
-    auto signal(VaryingArray const &v, FixedArray const &) const -> QI_ARRAY(double);
+    // Instantiated for double and Jets in the .cpp
+    template <typename T> auto typed_signal(QI_ARRAYN(T, NV) const &v) const -> QI_ARRAY(T);
+
+    template <typename Derived>
+    auto signal(Eigen::ArrayBase<Derived> const &v, FixedArray const &) const
+        -> QI_ARRAY(typename Derived::Scalar) {
+        return typed_signal<typename Derived::Scalar>(v);
+    }
+
     void derived(const VaryingArray &varying, const FixedArray &, DerivedArray &derived) const;
 };
 
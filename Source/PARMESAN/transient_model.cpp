@@ -1,13 +1,15 @@
 // #define QI_DEBUG_BUILD 1
 #include "Macro.h"
 #include "parmesan.hpp"
+#include "propagators.hpp"
 #include "transient_model.h"
 
-using AugMat = Eigen::Matrix<double, 4, 4>;
-using AugVec = Eigen::Vector<double, 4>;
-
-auto MUPAModel::signal(VaryingArray const &v, FixedArray const &) const -> QI_ARRAY(double) {
-    using T = double;
+template <typename T>
+auto MUPAModel::typed_signal(QI_ARRAYN(T, NV) const &v) const -> QI_ARRAY(T) {
+    // The readout is spoiled every TR and the preps leave no transverse magnetisation, so only
+    // (z, 1) is ever needed and every propagator is reduced to that block
+    using AugMat = Eigen::Matrix<T, 2, 2>;
+    using AugVec = Eigen::Vector<T, 2>;
 
     T const &M0 = v[0];
     T const &R1 = 1. / v[1];
@@ -22,78 +24,68 @@ auto MUPAModel::signal(VaryingArray const &v, FixedArray const &) const -> QI_AR
     QI_DB(sequence.spokes_per_seg)
     QI_DBVEC(sequence.groups_per_seg)
 
-    AugMat R;
-    R << -R2, 0, 0, 0, //
-        0, -R2, 0, 0,  //
-        0, 0, -R1, R1, //
-        0, 0, 0, 0;
-
-    AugMat const Rrd  = (R * sequence.TR).exp();
-    AugMat const S    = Eigen::DiagonalMatrix<double, 4, 4>({0, 0, 1., 1.}).toDenseMatrix();
-    AugMat const ramp = (R * sequence.Tramp).exp();
+    AugMat const Rrd  = LongitudinalRelax(R1, T(1.), sequence.TR);
+    AugMat const ramp = LongitudinalRelax(R1, T(1.), sequence.Tramp);
 
-    // Setup readout segment matrices
-    std::vector<AugMat> TR_mats(sequence.size());
-    std::vector<AugMat> seg_mats(sequence.size());
-    for (int is = 0; is < sequence.size(); is++) {
-        AugMat rf;
-        float  B1x = sequence.FA[is] / sequence.Trf[is];
-        rf << 0, 0, 0, 0,  //
-            0, 0, B1x, 0,  //
-            0, -B1x, 0, 0, //
-            0, 0, 0, 0;
-        AugMat const Ard = ((R + rf) * sequence.Trf[is]).exp();
-        TR_mats[is]      = S * Rrd * Ard;
-        seg_mats[is]     = TR_mats[is].pow(sequence.spokes_per_seg / sequence.groups_per_seg[is]);
+    // Setup readout segment matrices, once for each distinct readout block
+    std::vector<AugMat> TR_mats(sequence.n_blocks());
+    std::vector<AugMat> seg_mats(sequence.n_blocks());
+    std::vector<AugVec> avg_z(sequence.n_blocks()); // z averaged over a group is avg_z . m
+    for (int ib = 0; ib < sequence.n_blocks(); ib++) {
+        int const    is  = sequence.block_first[ib];
+        T const      B1x(sequence.FA[is] / sequence.Trf[is]);
+        AugMat const Ard = OnePoolPulse(R1, R2, T(1.), B1x, sequence.Trf[is])
+                               .template bottomRightCorner<2, 2>();
+        TR_mats[ib]      = Rrd * Ard;
+        seg_mats[ib]     = Pow(TR_mats[ib], sequence.spokes_per_group[is]);
+        avg_z[ib]        =
+            GeometricAvgMatrix(TR_mats[ib], seg_mats[ib], sequence.spokes_per_group[is]).row(0);
     }
 
     // Setup pulse matrices
-    std::vector<AugMat> prep_mats(sequence.size());
-    for (int is = 0; is < sequence.size(); is++) {
-        auto const & name = sequence.prep[is];
-        auto const & p    = sequence.prep_pulses[name];
-        double const E2   = exp(-R2 * p.T_trans);
-        double const E1   = exp(-R1 * p.T_long);
+    std::vector<AugMat> prep_mats(sequence.unique_preps.size());
+    for (size_t ip = 0; ip < sequence.unique_preps.size(); ip++) {
+        auto const & p  = sequence.unique_preps[ip];
+        T const      E2 = exp(-R2 * p.T_trans);
+        T const      E1 = exp(-R1 * p.T_long);
         AugMat       C;
-        C << 0, 0, 0, 0,                            //
-            0, 0, 0, 0,                             //
-            0, 0, E1 * E2 * cos(p.FAeff), (1 - E1), //
-            0, 0, 0, 1;
-        prep_mats[is] = C;
+        C << E1 * E2 * cos(p.FAeff), 1. - E1, //
+            T(0.), T(1.);
+        prep_mats[ip] = C;
     }
 
     // First calculate the system matrix and get SS
-    QI_DBMAT(R);
-    AugMat X = AugMat::Identity();
+    // Each group of a segment is prep, ramp, readout, ramp
+    std::vector<AugMat> pre_mats(sequence.size());
+    std::vector<AugMat> post_mats(sequence.size());
+    AugMat              X = AugMat::Identity();
     for (int is = 0; is < sequence.size(); is++) {
-        for (int ig = 0; ig < sequence.groups_per_seg[is]; ig++) {
-            X = ramp * seg_mats[is] * ramp * prep_mats[is] * X;
-        }
+        pre_mats[is]  = ramp * prep_mats[sequence.prep_index[is]];
+        post_mats[is] = ramp * seg_mats[sequence.block_index[is]];
+        X             = Pow(AugMat(post_mats[is] * pre_mats[is]), sequence.groups_per_seg[is]) * X;
     }
     AugVec m_ss = SolveSteadyState(X);
     QI_DBMAT(X);
     QI_DBVEC(m_ss);
     // Now loop through the segments and record the signal for each
-    Eigen::ArrayXd sig(sequence.size());
-    AugVec         m_current = m_ss;
+    QI_ARRAY(T) sig(sequence.size());
+    AugVec      m_current = m_ss;
     for (int is = 0; is < sequence.size(); is++) {
-        double segment_accumulate = 0.;
+        int const ib = sequence.block_index[is];
+        T         segment_accumulate(0.);
         for (int ig = 0; ig < sequence.groups_per_seg[is]; ig++) {
-            AugVec const m_prepped = ramp * prep_mats[is] * m_current;
-            auto const   m_group_avg =
-                GeometricAvg(TR_mats[is],
-                             seg_mats[is],
-                             m_prepped,
-                             sequence.spokes_per_seg / sequence.groups_per_seg[is]);
-            segment_accumulate += m_group_avg[2] * sin(sequence.FA[is]);
-            QI_DBVEC(m_group_avg);
-            QI_DB(sin(sequence.FA[is]));
+            AugVec const m_prepped = pre_mats[is] * m_current;
+            T const      z_avg     = avg_z[ib].dot(m_prepped);
+            segment_accumulate += z_avg * sequence.sin_FA[is];
+            QI_DB(z_avg);
+            QI_DB(sequence.sin_FA[is]);
             QI_DB(segment_accumulate);
-            m_current = ramp * seg_mats[is] * m_prepped;
+            m_current = post_mats[is] * m_prepped;
         }
         QI_DB(segment_accumulate);
-        sig[is] = M0 * segment_accumulate / sequence.groups_per_seg[is];
+        sig[is] = M0 * segment_accumulate / double(sequence.groups_per_seg[is]);
     }
     QI_DBVEC(sig);
     return sig;
-}
\ No newline at end of file
+}
+PARMESAN_INSTANTIATE_SIGNAL(MUPAModel)
@@ -1,24 +1,26 @@
 // #define QI_DEBUG_BUILD 1
 #include "Macro.h"
 #include "parmesan.hpp"
+#include "propagators.hpp"
 #include "transient_mt_model.h"
 
-using AugMat = Eigen::Matrix<double, 5, 5>; // Short for Augmented Matrix
-using AugVec = Eigen::Vector<double, 5>;
-
-auto MUPAMTModel::signal(VaryingArray const &v, FixedArray const &) const -> QI_ARRAY(double) {
-    using T = double;
+template <typename T>
+auto MUPAMTModel::typed_signal(QI_ARRAYN(T, NV) const &v) const -> QI_ARRAY(T) {
+    // The readout is spoiled every TR and the preps leave no transverse magnetisation, so only
+    // (z_f, z_b, 1) is ever needed and every propagator is reduced to that block
+    using AugMat = Eigen::Matrix<T, 3, 3>;
+    using AugVec = Eigen::Vector<T, 3>;
 
     T const &M0_f = v[0];
     T const &M0_b = v[1];
     T const &R1_f = 1. / v[2];
     T const &R1_b = R1_f;
     T const &R2_f = 1. / v[3];
-    T const &k    = 4.3;
+    T const &k    = T(4.3);
     T const &k_bf = k * M0_f / (M0_f + M0_b);
     T const &k_fb = k * M0_b / (M0_f + M0_b);
     T const &B1   = v[4];
-    T const &G0   = 1.4e-5;
+    T const &G0   = T(1.4e-5);
     QI_DBVEC(v)
     QI_DB(M0_f)
     QI_DB(M0_b)
@@ -27,93 +29,77 @@ auto MUPAMTModel::signal(VaryingArray const &v, FixedArray const &) const -> QI_
     QI_DB(k_bf)
     QI_DB(k_fb)
     QI_DB(B1)
-    AugMat R;
-    R << -R2_f, 0, 0, 0, 0,          //
-        0, -R2_f, 0, 0, 0,           //
-        0, 0, -R1_f, 0, M0_f * R1_f, //
-        0, 0, 0, -R1_b, M0_b * R1_b, //
-        0, 0, 0, 0, 0;
-
-    AugMat K;
-    K << 0, 0, 0, 0, 0,       //
-        0, 0, 0, 0, 0,        //
-        0, 0, -k_fb, k_bf, 0, //
-        0, 0, k_fb, -k_bf, 0, //
-        0, 0, 0, 0, 0;
-
-    AugMat const S = Eigen::DiagonalMatrix<double, 5, 5>({0, 0, 1., 1., 1.}).toDenseMatrix();
-
-    AugMat const RpK = R + K;
+    AugMat const ramp = TwoPoolRelax(R1_f, R1_b, R2_f, k_fb, k_bf, M0_f, M0_b, sequence.Tramp)
+                            .template bottomRightCorner<3, 3>();
 
-    // Setup readout segment matrices
-    AugMat const        ramp = (RpK * sequence.Tramp).exp();
-    std::vector<AugMat> TR_mats(sequence.FA.rows());
-    std::vector<AugMat> seg_mats(sequence.FA.rows());
-    for (int is = 0; is < sequence.FA.rows(); is++) {
-        double const B1x = B1 * sequence.FA[is] / sequence.Trf[is];
-        double const W   = M_PI * G0 * B1x * B1x;
-        AugMat       rf;
-        rf << 0, 0, 0, 0, 0,  //
-            0, 0, B1x, 0, 0,  //
-            0, -B1x, 0, 0, 0, //
-            0, 0, 0, -W, 0,   //
-            0, 0, 0, 0, 0;
-        AugMat const Rrd = (RpK * (sequence.TR - sequence.Trf[is])).exp();
-        AugMat const Ard = ((RpK + rf) * sequence.Trf[is]).exp();
-        TR_mats[is]      = S * Rrd * Ard;
-        seg_mats[is]     = TR_mats[is].pow(sequence.spokes_per_seg / sequence.groups_per_seg[is]);
+    // Setup readout segment matrices, once for each distinct readout block
+    std::vector<AugMat> TR_mats(sequence.n_blocks());
+    std::vector<AugMat> seg_mats(sequence.n_blocks());
+    std::vector<AugVec> avg_z(sequence.n_blocks()); // z averaged over a group is avg_z . m
+    for (int ib = 0; ib < sequence.n_blocks(); ib++) {
+        int const    is  = sequence.block_first[ib];
+        double const Trf = sequence.Trf[is];
+        T const      B1x = B1 * sequence.FA[is] / Trf;
+        T const      W   = M_PI * G0 * B1x * B1x;
+        AugMat const Rrd =
+            TwoPoolRelax(R1_f, R1_b, R2_f, k_fb, k_bf, M0_f, M0_b, sequence.TR - Trf)
+                .template bottomRightCorner<3, 3>();
+        AugMat const Ard = TwoPoolPulse(R1_f, R1_b, R2_f, k_fb, k_bf, M0_f, M0_b, B1x, W, Trf)
+                               .template bottomRightCorner<3, 3>();
+        TR_mats[ib]      = Rrd * Ard;
+        seg_mats[ib]     = Pow(TR_mats[ib], sequence.spokes_per_group[is]);
+        avg_z[ib]        =
+            GeometricAvgMatrix(TR_mats[ib], seg_mats[ib], sequence.spokes_per_group[is]).row(0);
     }
 
     // Setup pulse matrices
-    std::vector<AugMat> prep_mats(sequence.size());
-    for (int is = 0; is < sequence.size(); is++) {
-        auto const & name = sequence.prep[is];
-        auto const & p    = sequence.prep_pulses[name];
-        double const Ew   = exp(-M_PI * 1.4e-5 * B1 * B1 * p.int_b1_sq);
-        AugMat       C;
-        double const E2 = exp(-R2_f * p.T_trans);
-        // double const E1 = exp(-R1_f * p.T_long);
+    std::vector<AugMat> prep_mats(sequence.unique_preps.size());
+    for (size_t ip = 0; ip < sequence.unique_preps.size(); ip++) {
+        auto const & p  = sequence.unique_preps[ip];
+        T const      Ew = exp(-M_PI * 1.4e-5 * B1 * B1 * p.int_b1_sq);
+        AugMat       C  = AugMat::Zero();
+        T const      E2 = exp(-R2_f * p.T_trans);
+        // T const E1 = exp(-R1_f * p.T_long);
         QI_DB(Ew)
         QI_DB(E2)
-        C << 0, 0, 0, 0, 0,                //
-            0, 0, 0, 0, 0,                 //
-            0, 0, E2 * cos(p.FAeff), 0, 0, //
-            0, 0, 0, Ew, 0,                //
-            0, 0, 0, 0, 1;
-        prep_mats[is] = C;
+        C(0, 0)       = E2 * cos(p.FAeff);
+        C(1, 1)       = Ew;
+        C(2, 2)       = T(1.);
+        prep_mats[ip] = C;
     }
 
-    // First calculate the system matrix
-    AugMat X = AugMat::Identity();
+    // First calculate the system matrix. Each group of a segment is prep, ramp, readout, ramp
+    std::vector<AugMat> pre_mats(sequence.size());
+    std::vector<AugMat> post_mats(sequence.size());
+    AugMat              X = AugMat::Identity();
     for (int is = 0; is < sequence.size(); is++) {
-        for (int ig = 0; ig < sequence.groups_per_seg[is]; ig++) {
-            X = ramp * seg_mats[is] * ramp * S * prep_mats[is] * X;
-        }
+        pre_mats[is]  = ramp * prep_mats[sequence.prep_index[is]];
+        post_mats[is] = ramp * seg_mats[sequence.block_index[is]];
+        X             = Pow(AugMat(post_mats[is] * pre_mats[is]), sequence.groups_per_seg[is]) * X;
     }
     AugVec m_ss = SolveSteadyState(X);
 
     // Now loop through the segments and record the signal for each
-    Eigen::ArrayXd sig(sequence.size());
+    QI_ARRAY(T) sig(sequence.size());
     QI_DBVEC(m_ss);
     AugVec m_current = m_ss;
     for (int is = 0; is < sequence.size(); is++) {
-        double segment_accumulate = 0.;
+        int const ib    = sequence.block_index[is];
+        T const   sin_a = sin(B1 * sequence.FA[is]);
+        T         segment_accumulate(0.);
         for (int ig = 0; ig < sequence.groups_per_seg[is]; ig++) {
-            AugVec const m_prepped = ramp * S * prep_mats[is] * m_current;
-            auto const   m_group_avg =
-                GeometricAvg(TR_mats[is],
-                             seg_mats[is],
-                             m_prepped,
-                             sequence.spokes_per_seg / sequence.groups_per_seg[is]);
-            segment_accumulate += m_group_avg[2] * sin(B1 * sequence.FA[is]);
-            m_current = ramp * seg_mats[is] * m_prepped;
+            AugVec const m_prepped = pre_mats[is] * m_current;
+            T const      z_avg     = avg_z[ib].dot(m_prepped);
+            segment_accumulate += z_avg * sin_a;
+            m_current = post_mats[is] * m_prepped;
         }
-        sig[is] = segment_accumulate / sequence.groups_per_seg[is];
+        sig[is] = segment_accumulate / double(sequence.groups_per_seg[is]);
     }
     QI_DBVEC(v);
     QI_DBVEC(sig);
     return sig;
 }
+PARMESAN_INSTANTIATE_SIGNAL(MUPAMTModel)
 
 void MUPAMTModel::derived(const VaryingArray &varying,
                           const FixedArray & /* Unused */,
@@ -125,4 +111,4 @@ void MUPAMTModel::derived(const VaryingArray &varying,
     QI_DB(M0_f)
     QI_DB(M0_b)
     QI_DBVEC(derived)
-}
\ No newline at end of file
+}
@@ -1,5 +1,51 @@
 #include "Log.h"
 #include "transient_sequence.h"
+#include <algorithm>
+
+/*
+ *  Segments that share a flip-angle, pulse length and number of spokes per group have identical
+ *  readout propagators, and segments that share a prep name have identical prep propagators, so
+ *  the models only need to build each of these once per voxel.
+ */
+void RUFISSequence::compile() {
+    auto const n_seg = size();
+    spokes_per_group = spokes_per_seg / groups_per_seg;
+    sin_FA           = FA.sin();
+
+    unique_preps.clear();
+    std::vector<std::string> prep_names;
+    prep_index.resize(n_seg);
+    for (Eigen::Index is = 0; is < n_seg; is++) {
+        auto const it = std::find(prep_names.begin(), prep_names.end(), prep[is]);
+        if (it != prep_names.end()) {
+            prep_index[is] = std::distance(prep_names.begin(), it);
+        } else {
+            auto const p = prep_pulses.find(prep[is]);
+            if (p == prep_pulses.end()) {
+                QI::Fail("Prep pulse {} was not defined", prep[is]);
+            }
+            prep_index[is] = prep_names.size();
+            prep_names.push_back(prep[is]);
+            unique_preps.push_back(p->second);
+        }
+    }
+
+    std::vector<int> firsts;
+    block_index.resize(n_seg);
+    for (Eigen::Index is = 0; is < n_seg; is++) {
+        auto const it = std::find_if(firsts.begin(), firsts.end(), [&](int const f) {
+            return (FA[f] == FA[is]) && (Trf[f] == Trf[is]) &&
+                   (spokes_per_group[f] == spokes_per_group[is]);
+        });
+        if (it != firsts.end()) {
+            block_index[is] = std::distance(firsts.begin(), it);
+        } else {
+            block_index[is] = firsts.size();
+            firsts.push_back(is);
+        }
+    }
+    block_first = Eigen::Map<Eigen::ArrayXi>(firsts.data(), firsts.size());
+}
 
 void from_json(const json &j, RUFISSequence &s) {
     QI::GetJSON(j, "TR", s.TR);
@@ -15,4 +61,11 @@ void from_json(const json &j, RUFISSequence &s) {
         QI::Fail(
             "Number preps {} does not match number of flip-angles {}", s.prep.size(), s.FA.rows());
     }
-}
\ No newline at end of file
+    if ((s.Trf.rows() != s.FA.rows()) || (s.groups_per_seg.rows() != s.FA.rows())) {
+        QI::Fail("Parameters had differing lengths (FA={}, Trf={}, groups_per_seg={})",
+                 s.FA.rows(),
+                 s.Trf.rows(),
+                 s.groups_per_seg.rows());
+    }
+    s.compile();
+}
@@ -11,7 +11,18 @@ struct RUFISSequence : QI::SequenceBase {
     int                                        spokes_per_seg;
     std::unordered_map<std::string, PrepPulse> prep_pulses;
     std::vector<std::string>                   prep;
+
+    // Tables that do not depend on the tissue parameters, filled once by compile()
+    Eigen::ArrayXi         spokes_per_group; // Per segment
+    Eigen::ArrayXd         sin_FA;           // Per segment
+    std::vector<PrepPulse> unique_preps;     // Each distinct prep pulse once
+    Eigen::ArrayXi         prep_index;       // Per segment index into unique_preps
+    Eigen::ArrayXi         block_first;      // First segment of each distinct readout block
+    Eigen::ArrayXi         block_index;      // Per segment index into block_first
+
     QI_SEQUENCE_DECLARE(RUFIS);
     Eigen::Index size() const override { return prep.size(); };
+    Eigen::Index n_blocks() const { return block_first.rows(); }
+    void         compile();
 };
 void from_json(const json &j, RUFISSequence &s);
@@ -17,8 +17,10 @@
 
 #include "Args.h"
 
+#include "CubicTable.h"
 #include "FitFunction.h"
 #include "FitScaledAuto.h"
+#include "FitVarPro.h"
 #include "ImageIO.h"
 #include "Model.h"
 #include "ModelFitFilter.h"
@@ -40,10 +42,94 @@ template <typename T> struct fcFunctor {
     }
 };
 
+// The original quadrature, kept as a reference for the table below
+template <typename T> T fcQuadrature(const T &dw, const T &tau) {
+    Eigen::Integrator<T> integrator(5);
+    const auto           quad_rule = Eigen::Integrator<T>::GaussKronrod15;
+    T                    abs_error{1.e-9};
+    T                    rel_error{1.e-9};
+    fcFunctor<T>         functor{dw, tau};
+    return (1. / 3.) *
+           integrator.quadratureAdaptive(functor, T{0.0}, T{1.0}, abs_error, rel_error, quad_rule);
+}
+
+/*
+ *  fc depends only on x = dw * tau. log(fc) is tabulated against log(x) between x_min and x_max,
+ *  with one extra sample beyond each end, from an accurate quadrature. Below x_min the series
+ *  3x^2/10 - 3x^4/280 + 27x^6/80080 is used, and above x_max the asymptote x - 1 + 1/(6x). The
+ *  relative error is below 1e-7 for all x. The quadrature above becomes inaccurate past x = 100.
+ */
+class fcTable {
+  public:
+    static constexpr int    size  = 1024;
+    static constexpr double x_min = 0.1;
+    static constexpr double x_max = 1000.0;
+
+    static const fcTable &Get() {
+        static const fcTable table; // Built on first use, thread-safe
+        return table;
+    }
+
+    template <typename T> T operator()(const T &x) const {
+        using std::exp;
+        using std::log;
+        if (x < x_min) {
+            const T x2 = x * x;
+            return x2 * (3. / 10. - x2 * (3. / 280. - x2 * (27. / 80080.)));
+        } else if (x > x_max) {
+            return x - 1. + 1. / (6. * x);
+        } else {
+            return exp(table.Evaluate((log(x) - log_x0) / dlog_x));
+        }
+    }
+
+  private:
+    const double         dlog_x, log_x0;
+    const QI::CubicTable table;
+
+    fcTable() :
+        dlog_x{(std::log(x_max) - std::log(x_min)) / (size - 3)},
+        log_x0{std::log(x_min) - dlog_x}, table{Tabulate(log_x0, dlog_x)} {}
+
+    /*
+     *  Substituting u = 1 - s^2 removes the sqrt(1 - u) endpoint, and a series for 1 - J0(z) at
+     *  small z avoids the cancellation near u = 0, so the integrand is smooth on [0, 1].
+     */
+    static Eigen::ArrayXd Tabulate(const double log_x0, const double dlog_x) {
+        Eigen::Integrator<double> integrator(2000);
+        const auto                quad_rule = Eigen::Integrator<double>::GaussKronrod61;
+        Eigen::ArrayXd            vals(size);
+        for (int i = 0; i < size; i++) {
+            const double x         = std::exp(log_x0 + i * dlog_x);
+            const auto   integrand = [x](const double s) {
+                const double u = 1. - s * s;
+                const double z = 1.5 * x * u;
+                const double q = z * z / 4.;
+                const double one_minus_J0 =
+                    (z < 1.) ? q * (1. - q / 4. * (1. - q / 9. * (1. - q / 16. * (1. - q / 25.))))
+                             : 1. - ceres::BesselJ0(z);
+                return 2. * s * s * (2. + u) * one_minus_J0 / (u * u);
+            };
+            vals[i] = std::log(
+                integrator.quadratureAdaptive(integrand, 0.0, 1.0, 0.0, 1.e-12, quad_rule) / 3.);
+        }
+        return vals;
+    }
+};
+
+template <typename T> QI_ARRAY(T) fcEchoes(const T &dw, const QI_ARRAY(T) &aTE, bool quadrature) {
+    QI_ARRAY(T) fc(aTE.rows());
+    for (int i = 0; i < aTE.rows(); i++) {
+        fc[i] = quadrature ? fcQuadrature(dw, aTE[i]) : fcTable::Get()(dw * aTE[i]);
+    }
+    return fc;
+}
+
 struct ASEModel : QI::Model<double, double, 4, 0, 1, 3> {
     using SequenceType = QI::MultiEchoSequence;
     const SequenceType &sequence;
     const double        B0, Hct;
+    const bool          quadrature = false;
 
     const std::array<const std::string, NV> varying_names{"S0"s, "dT"s, "R2p"s, "DBV"s};
     const std::array<const std::string, ND> derived_names{"Tc"s, "OEF"s, "dHb"s};
@@ -64,18 +150,8 @@ struct ASEModel : QI::Model<double, double, 4, 0, 1, 3> {
         const T &  DBV = varying[3];
         const auto dw  = R2p / DBV;
 
-        Eigen::Integrator<T> integrator(5);
-        const auto           quad_rule = Eigen::Integrator<T>::GaussKronrod15;
-        T                    abs_error{1.e-9};
-        T                    rel_error{1.e-9};
-        const auto           aTE = (sequence.TE + dT).abs();
-        QI_ARRAY(T) fc(sequence.size());
-        for (int i = 0; i < sequence.size(); i++) {
-            const auto   tau = aTE(i);
-            fcFunctor<T> functor{dw, tau};
-            fc[i] = (1. / 3.) * integrator.quadratureAdaptive(
-                                    functor, T{0.0}, T{1.0}, abs_error, rel_error, quad_rule);
-        }
+        const QI_ARRAY(T) aTE = (sequence.TE + dT).abs();
+        const QI_ARRAY(T) fc  = fcEchoes(dw, aTE, quadrature);
         QI_ARRAY(T) S = S0 * exp(-DBV * fc);
         return S;
     }
@@ -98,12 +174,14 @@ struct ASEModel : QI::Model<double, double, 4, 0, 1, 3> {
         derived[2] = dHb;
     }
 };
-using ASEFit = QI::ScaledAutoDiffFit<ASEModel>;
+using ASEFit       = QI::ScaledAutoDiffFit<ASEModel>;
+using ASEVarProFit = QI::VarProFit<ASEModel>;
 
 struct ASEFixDBVModel : QI::Model<double, double, 3, 0, 1, 3> {
     using SequenceType = QI::MultiEchoSequence;
     const SequenceType &sequence;
     const double        B0, Hct, DBV;
+    const bool          quadrature = false;
 
     const std::array<const std::string, NV> varying_names{"S0"s, "dT"s, "R2p"s};
     const std::array<const std::string, ND> derived_names{"Tc"s, "OEF"s, "dHb"s};
@@ -123,18 +201,8 @@ struct ASEFixDBVModel : QI::Model<double, double, 3, 0, 1, 3> {
         const T &  R2p = varying[2];
         const auto dw  = R2p / DBV;
 
-        Eigen::Integrator<T> integrator(5);
-        const auto           quad_rule = Eigen::Integrator<T>::GaussKronrod15;
-        T                    abs_error{1.e-9};
-        T                    rel_error{1.e-9};
-        const auto           aTE = (sequence.TE + dT).abs();
-        QI_ARRAY(T) fc(sequence.size());
-        for (int i = 0; i < sequence.size(); i++) {
-            const auto   tau = aTE(i);
-            fcFunctor<T> functor{dw, tau};
-            fc[i] = (1. / 3.) * integrator.quadratureAdaptive(
-                                    functor, T{0.0}, T{1.0}, abs_error, rel_error, quad_rule);
-        }
+        const QI_ARRAY(T) aTE = (sequence.TE + dT).abs();
+        const QI_ARRAY(T) fc  = fcEchoes(dw, aTE, quadrature);
         QI_ARRAY(T) S = S0 * exp(-DBV * fc);
 
         return S;
@@ -156,7 +224,8 @@ struct ASEFixDBVModel : QI::Model<double, double, 3, 0, 1, 3> {
         derived[2] = dHb;
     }
 };
-using ASEFixDBVFit = QI::ScaledAutoDiffFit<ASEFixDBVModel>;
+using ASEFixDBVFit       = QI::ScaledAutoDiffFit<ASEFixDBVModel>;
+using ASEFixDBVVarProFit = QI::VarProFit<ASEFixDBVModel>;
 
 /*
  * Main
@@ -165,17 +234,23 @@ int ase_oef_main(args::Subparser &parser) {
     args::Positional<std::string> input_path(parser, "ASE_FILE", "Input ASE file");
 
     QI_COMMON_ARGS;
+    QI_VARPRO_ARG;
     args::ValueFlag<double> B0(parser, "B0", "Field-strength (Tesla), default 3", {'B', "B0"}, 3.0);
     args::ValueFlag<double> Hct(parser, "HCT", "Hematocrit (default 0.34)", {'h', "Hct"}, 0.34);
     args::ValueFlag<double> DBV(parser, "DBV", "Fix DBV and only fit R2'", {'d', "DBV"}, 0.0);
+    args::Flag              quadrature(
+        parser, "QUADRATURE", "Integrate fc directly instead of using the table", {"quadrature"});
 
     parser.Parse();
     json input    = json_file ? QI::ReadJSON(json_file.Get()) : QI::ReadJSON(std::cin);
     auto sequence = input.at("MultiEcho").get<QI::MultiEchoSequence>();
+    if (!quadrature) {
+        fcTable::Get(); // Build the table before the threads start
+    }
 
     if (simulate) {
         if (DBV) {
-            ASEFixDBVModel model{{}, sequence, B0.Get(), Hct.Get(), DBV.Get()};
+            ASEFixDBVModel model{{}, sequence, B0.Get(), Hct.Get(), DBV.Get(), quadrature};
             QI::SimulateModel<ASEFixDBVModel, false>(input,
                                                      model,
                                                      {},
@@ -184,9 +259,10 @@ int ase_oef_main(args::Subparser &parser) {
                                                      verbose,
                                                      simulate.Get(),
                                                      threads.Get(),
-                                                     subregion.Get());
+                                                     subregion.Get(),
+                                                     seed.Get());
         } else {
-            ASEModel model{{}, sequence, B0.Get(), Hct.Get()};
+            ASEModel model{{}, sequence, B0.Get(), Hct.Get(), quadrature};
             QI::SimulateModel<ASEModel, false>(input,
                                                model,
                                                {},
@@ -195,7 +271,8 @@ int ase_oef_main(args::Subparser &parser) {
                                                verbose,
                                                simulate.Get(),
                                                threads.Get(),
-                                               subregion.Get());
+                                               subregion.Get(),
+                                               seed.Get());
         }
     } else {
         auto process = [&](auto fit_func) {
@@ -205,14 +282,23 @@ int ase_oef_main(args::Subparser &parser) {
             fit_filter->Update();
             fit_filter->WriteOutputs(prefix.Get() + "ASE_");
         };
+        if (varpro) {
+            QI::Log(verbose, "Using Variable Projection");
+        }
         if (DBV) {
-            ASEFixDBVModel model{{}, sequence, B0.Get(), Hct.Get(), DBV.Get()};
-            ASEFixDBVFit   fit{model};
-            process(fit);
+            ASEFixDBVModel model{{}, sequence, B0.Get(), Hct.Get(), DBV.Get(), quadrature};
+            if (varpro) {
+                process(ASEFixDBVVarProFit{model});
+            } else {
+                process(ASEFixDBVFit{model});
+            }
         } else {
-            ASEModel model{{}, sequence, Hct.Get(), B0.Get()};
-            ASEFit   fit{model};
-            process(fit);
+            ASEModel model{{}, sequence, B0.Get(), Hct.Get(), quadrature};
+            if (varpro) {
+                process(ASEVarProFit{model});
+            } else {
+                process(ASEFit{model});
+            }
         }
     }
     return EXIT_SUCCESS;
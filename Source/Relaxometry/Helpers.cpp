@@ -12,6 +12,8 @@
 #include <limits>
 #include <cmath>
 
+#include "Helpers.h"
+
 namespace QI {
 
 // Helper Functions
@@ -27,4 +29,17 @@ void CalcExchange(const double tau_a, const double f_a, double &f_b, double &k_a
     }
 }
 
+// As above, for a batch of samples
+void CalcExchange(const Eigen::ArrayXd &tau_a,
+                  const Eigen::ArrayXd &f_a,
+                  Eigen::ArrayXd &      f_b,
+                  Eigen::ArrayXd &      k_ab,
+                  Eigen::ArrayXd &      k_ba) {
+    const double feps = std::numeric_limits<float>::epsilon();
+    f_b               = 1.0 - f_a;
+    const auto single = ((f_a - 1.).abs() <= feps) || ((f_b - 1.).abs() <= feps);
+    k_ab              = single.select(0., 1. / tau_a);
+    k_ba              = single.select(0., k_ab * f_a / f_b);
+}
+
 } // End namespace QI
@@ -25,6 +25,11 @@ namespace Eigen {
 namespace QI {
 
 void CalcExchange(const double tau_a, const double f_a, double &f_b, double &k_ab, double &k_ba);
+void CalcExchange(const Eigen::ArrayXd &tau_a,
+                  const Eigen::ArrayXd &f_a,
+                  Eigen::ArrayXd &      f_b,
+                  Eigen::ArrayXd &      k_ab,
+                  Eigen::ArrayXd &      k_ba);
 
 } // End namespace QI
 
@@ -28,17 +28,22 @@ Eigen::ArrayXcd SSFP1(double const &          PD,
 
     const double               psi   = 2. * M_PI * f0 * s.TR;
     const Eigen::ArrayXd       alpha = s.FA * B1;
-    const Eigen::ArrayXd       theta = psi + s.PhaseInc;
     const Eigen::ArrayXd       d     = (1. - E1 * E2 * E2 - (E1 - E2 * E2) * cos(alpha));
     const std::complex<double> echo  = sqrt(E2) * std::polar(1., psi / 2.);
     const Eigen::ArrayXcd      G     = -PD * echo * (1 - E1) * sin(alpha) / d;
     const Eigen::ArrayXd       b     = E2 * (1. - E1) * (1. + cos(alpha)) / d;
 
-    Eigen::ArrayXcd et(theta.size());
-    et.real() = cos(-theta);
-    et.imag() = sin(-theta);
+    // theta = psi + PhaseInc, by angle addition with the trig tables in the sequence
+    const double         cos_psi = cos(psi);
+    const double         sin_psi = sin(psi);
+    const Eigen::ArrayXd cos_th  = cos_psi * s.cos_PhaseInc - sin_psi * s.sin_PhaseInc;
+    const Eigen::ArrayXd sin_th  = sin_psi * s.cos_PhaseInc + cos_psi * s.sin_PhaseInc;
 
-    const Eigen::ArrayXcd M = G * (1. - E2 * et) / (1 - b * cos(theta));
+    Eigen::ArrayXcd et(s.size());
+    et.real() = cos_th;
+    et.imag() = -sin_th;
+
+    const Eigen::ArrayXcd M = G * (1. - E2 * et) / (1 - b * cos_th);
 
     return M;
 }
@@ -18,6 +18,7 @@
 #include "SPGRSequence.h"
 #include "SSFPSequence.h"
 #include <Eigen/Core>
+#include <type_traits>
 
 namespace QI {
 
@@ -38,9 +39,14 @@ Eigen::ArrayXcd SSFP1(double const &          PD,
 template <typename Ta, typename Tb>
 inline auto SPGRSignal(Ta const &PD, Ta const &T1, Tb const &B1, SPGRSequence const &s)
     -> QI_ARRAY(Ta) {
+    Ta const E1 = exp(-s.TR / T1);
+    if constexpr (std::is_same_v<Tb, double>) {
+        if (B1 == 1.) {
+            return PD * ((1. - E1) * s.sin_FA) / (1. - E1 * s.cos_FA);
+        }
+    }
     const QI_ARRAY(Tb) sa = sin(B1 * s.FA);
     const QI_ARRAY(Tb) ca = cos(B1 * s.FA);
-    Ta const E1           = exp(-s.TR / T1);
     return PD * ((1. - E1) * sa) / (1. - E1 * ca);
 }
 
@@ -72,6 +72,19 @@ Eigen::ArrayXd TwoPoolModel::signal(const Eigen::ArrayXd &v,
     return sig;
 }
 
+Eigen::ArrayXXd TwoPoolModel::signal_batch(const Eigen::ArrayXXd &v, FixedArray const &f) const {
+    Eigen::ArrayXXd sig(spgr.size() + ssfp.size(), v.cols());
+    auto            spgr_sig = sig.topRows(spgr.size());
+    auto            ssfp_sig = sig.bottomRows(ssfp.size());
+    spgr_sig                 = SPGR2(v, f[0], f[1], spgr).abs();
+    ssfp_sig                 = SSFP2(v, f[0], f[1], ssfp).abs();
+    if (scale_to_mean) {
+        spgr_sig.rowwise() /= spgr_sig.colwise().mean();
+        ssfp_sig.rowwise() /= ssfp_sig.colwise().mean();
+    }
+    return sig;
+}
+
 Eigen::ArrayXd TwoPoolModel::spgr_signal(const Eigen::ArrayXd &v,
                                          const QI_ARRAYN(double, NF) & f) const {
     Eigen::ArrayXcd const M = SPGR2(v[0], v[1], v[2], v[3], v[4], v[5], v[6], f[0], f[1], spgr);
@@ -48,6 +48,8 @@ struct TwoPoolModel : Model<double, double, 7, 2, 2> {
 
     std::vector<Eigen::ArrayXd> signals(VaryingArray const &varying, FixedArray const &fixed) const;
     Eigen::ArrayXd signal(const Eigen::ArrayXd &varying, const QI_ARRAYN(double, NF) & fixed) const;
+    // One column of signals per column of varying, for SRC
+    Eigen::ArrayXXd signal_batch(const Eigen::ArrayXXd &varying, FixedArray const &fixed) const;
 };
 
 } // End namespace QI
\ No newline at end of file
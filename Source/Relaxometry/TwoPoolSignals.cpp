@@ -3,13 +3,65 @@
 // #define QI_DEBUG_BUILD
 #include "Macro.h"
 
-#include <Eigen/Dense>
-#include <unsupported/Eigen/MatrixFunctions>
-
 #include "Helpers.h"
 
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+/*
+ *  Both signals reduce to 2x2 problems. All the flip-angles are evaluated at once, with each
+ *  element of the angle-dependent 2x2 matrices held as an array over the flip-angles, so the
+ *  trigonometry and arithmetic are whole-array operations that Eigen vectorises.
+ */
+
 namespace QI {
 
+namespace {
+struct Mat2 {
+    double m00, m01, m10, m11;
+};
+
+/*
+ *  exp(M) for a real 2x2 matrix with real eigenvalues, which is always the case for exchange
+ *  between two pools. With mean eigenvalue m and half-gap q,
+ *  exp(M) = exp(m) (cosh(q) I + sinh(q) / q (M - m I))
+ */
+Mat2 Exp2(Mat2 const &M) {
+    double const m     = 0.5 * (M.m00 + M.m11);
+    double const h     = 0.5 * (M.m00 - M.m11);
+    double const q     = std::sqrt(std::max(h * h + M.m01 * M.m10, 0.));
+    double const e     = std::exp(m);
+    double const sinhc = q > 1e-8 ? std::sinh(q) / q : 1. + q * q / 6.;
+    double const c     = e * std::cosh(q);
+    double const s     = e * sinhc;
+    return {c + s * h, s * M.m01, s * M.m10, c - s * h};
+}
+
+// A 2x2 matrix for each sample in a batch
+struct Mat2X {
+    Eigen::ArrayXd m00, m01, m10, m11;
+};
+
+Mat2X Exp2(Mat2X const &M) {
+    Eigen::ArrayXd const m     = 0.5 * (M.m00 + M.m11);
+    Eigen::ArrayXd const h     = 0.5 * (M.m00 - M.m11);
+    Eigen::ArrayXd const q     = (h.square() + M.m01 * M.m10).max(0.).sqrt();
+    Eigen::ArrayXd const e     = m.exp();
+    Eigen::ArrayXd const sinhc = (q > 1e-8).select(q.sinh() / q, 1. + q.square() / 6.);
+    Eigen::ArrayXd const c     = e * q.cosh();
+    Eigen::ArrayXd const s     = e * sinhc;
+    return {c + s * h, s * M.m01, s * M.m10, c - s * h};
+}
+
+Mat2X Mul2(Mat2X const &A, Mat2X const &B) {
+    return {A.m00 * B.m00 + A.m01 * B.m10,
+            A.m00 * B.m01 + A.m01 * B.m11,
+            A.m10 * B.m00 + A.m11 * B.m10,
+            A.m10 * B.m01 + A.m11 * B.m11};
+}
+} // namespace
+
 Eigen::ArrayXcd SPGR2(double const            PD,
                       double const            T1_a,
                       double const            T2_a,
@@ -20,28 +72,32 @@ Eigen::ArrayXcd SPGR2(double const            PD,
                       double const            f0,
                       double const            B1,
                       SPGREchoSequence const &spgr) {
-    Eigen::Matrix2d  A, eATR;
-    Eigen::Vector2d  M0, Mz;
-    Eigen::Vector2cd Mxy;
-    double           k_ab, k_ba, f_b;
+    double k_ab, k_ba, f_b;
     CalcExchange(tau_a, f_a, f_b, k_ab, k_ba);
-    M0 << f_a, f_b;
-    A << -(1. / T1_a) - k_ab, k_ba, //
-        k_ab, -(1. / T1_b) - k_ba;
-    eATR                  = (spgr.TR * A).exp();
-    Eigen::Matrix2cd echo = Eigen::Matrix2cd::Zero();
+    auto const E = Exp2({spgr.TR * (-(1. / T1_a) - k_ab),
+                         spgr.TR * k_ba,
+                         spgr.TR * k_ab,
+                         spgr.TR * (-(1. / T1_b) - k_ba)});
+    // (I - E) M0
+    double const r0 = (1. - E.m00) * f_a - E.m01 * f_b;
+    double const r1 = (1. - E.m11) * f_b - E.m10 * f_a;
     // T2' absorbed into PD as it effects both components equally
-    echo(0, 0) = std::polar(exp(-spgr.TE / T2_a), 2. * M_PI * f0 * spgr.TE);
-    echo(1, 1) = std::polar(exp(-spgr.TE / T2_b), 2. * M_PI * f0 * spgr.TE);
-
-    Eigen::Vector2d const RHS = (Eigen::Matrix2d::Identity() - eATR) * M0;
-    Eigen::VectorXcd      signal(spgr.size());
-    for (int i = 0; i < spgr.size(); i++) {
-        const double a = spgr.FA[i] * B1;
-        Mz.noalias()   = (Eigen::Matrix2d::Identity() - eATR * cos(a)).partialPivLu().solve(RHS);
-        Mxy.noalias()  = echo * PD * Mz * sin(a);
-        signal(i)      = Mxy(0) + Mxy(1);
-    }
+    auto const echo  = std::polar(PD, 2. * M_PI * f0 * spgr.TE);
+    auto const echoa = echo * exp(-spgr.TE / T2_a);
+    auto const echob = echo * exp(-spgr.TE / T2_b);
+
+    // Solve (I - E cos(a)) Mz = (I - E) M0 for all flip-angles at once
+    Eigen::ArrayXd const a   = spgr.FA * B1;
+    Eigen::ArrayXd const ca  = a.cos();
+    Eigen::ArrayXd const sa  = a.sin();
+    Eigen::ArrayXd const b00 = 1. - E.m00 * ca;
+    Eigen::ArrayXd const b11 = 1. - E.m11 * ca;
+    Eigen::ArrayXd const sd  = sa / (b00 * b11 - (E.m01 * E.m10) * ca.square());
+    Eigen::ArrayXd const Mza = (b11 * r0 + (E.m01 * r1) * ca) * sd;
+    Eigen::ArrayXd const Mzb = (b00 * r1 + (E.m10 * r0) * ca) * sd;
+    Eigen::ArrayXcd      signal(spgr.size());
+    signal.real() = echoa.real() * Mza + echob.real() * Mzb;
+    signal.imag() = echoa.imag() * Mza + echob.imag() * Mzb;
     QI_DBMSG("SPGR2\n");
     QI_DB(PD);
     QI_DB(T1_a);
@@ -76,22 +132,31 @@ Eigen::ArrayXcd SSFP2(double const            PD,
     const double  E2_b = exp(-TR / T2_b);
     double        f_b, k_ab, k_ba;
     CalcExchange(tau_a, f_a, f_b, k_ab, k_ba);
-    const double   E_ab  = exp(-TR * k_ab / f_b);
-    const double   K1    = E_ab * f_b + f_a;
-    const double   K2    = E_ab * f_a + f_b;
-    const double   K3    = f_a * (1 - E_ab);
-    const double   K4    = f_b * (1 - E_ab);
-    Eigen::ArrayXd alpha = B1 * s.FA;
-    Eigen::ArrayXd theta = s.PhaseInc + 2. * M_PI * f0 * TR;
-
-    // TR Evolution
-    Eigen::MatrixXd M(4, s.size());
-    Eigen::Matrix6d LHS;
-    Eigen::Vector6d RHS;
-    RHS << 0, 0, 0, 0, -E1_b * K3 * f_b + f_a * (-E1_a * K1 + 1),
-        -E1_a * K4 * f_a + f_b * (-E1_b * K2 + 1);
-
-    // TE Evolution
+    const double E_ab = exp(-TR * k_ab / f_b);
+    const double K1   = E_ab * f_b + f_a;
+    const double K2   = E_ab * f_a + f_b;
+    const double K3   = f_a * (1 - E_ab);
+    const double K4   = f_b * (1 - E_ab);
+
+    /*
+     *  The steady-state is the solution of a 6x6 system for the transverse (x, y) and
+     *  longitudinal (z) magnetisation of both pools, but the transverse block only involves the
+     *  2x2 relaxation-exchange matrix Ex and its square, so it can be eliminated in closed form.
+     *  With Q = cos(a) I - cos(theta) (1 + cos(a)) Ex + Ex^2, the x and y responses to the z
+     *  magnetisation are P1 = (I - cos(theta) Ex) Q^-1 and P2 = sin(theta) Ex Q^-1, the
+     *  remaining 2x2 system for z is (cos(a) I - E1x + sin(a)^2 P1) z = r, and then
+     *  x = -sin(a) P1 z and y = -sin(a) P2 z.
+     */
+    Mat2 const   Ex{E2_a * K1, E2_b * K3, E2_a * K4, E2_b * K2};
+    Mat2 const   Ex2{Ex.m00 * Ex.m00 + Ex.m01 * Ex.m10,
+                   Ex.m00 * Ex.m01 + Ex.m01 * Ex.m11,
+                   Ex.m10 * Ex.m00 + Ex.m11 * Ex.m10,
+                   Ex.m10 * Ex.m01 + Ex.m11 * Ex.m11};
+    Mat2 const   E1x{E1_a * K1, E1_b * K3, E1_a * K4, E1_b * K2};
+    double const r0 = -E1_b * K3 * f_b + f_a * (-E1_a * K1 + 1);
+    double const r1 = -E1_a * K4 * f_a + f_b * (-E1_b * K2 + 1);
+
+    // TE Evolution, only the column sums of the echo matrix are needed
     const double sE2_a    = exp(-TR / (2. * T2_a));
     const double sE2_b    = exp(-TR / (2. * T2_b));
     const double sqrtE_ab = exp(-TR * k_ab / (2 * f_b));
@@ -99,33 +164,59 @@ Eigen::ArrayXcd SSFP2(double const            PD,
     const double K2e      = sqrtE_ab * f_a + f_b;
     const double K3e      = f_a * (1 - sqrtE_ab);
     const double K4e      = f_b * (1 - sqrtE_ab);
-    const double cte      = cos(M_PI * f0 * TR);
-    const double ste      = sin(M_PI * f0 * TR);
-
-    Eigen::Matrix4d echo;
-    echo << sE2_a * K1e * cte, sE2_b * K3e * cte, -sE2_a * K1e * ste, -sE2_b * K3e * ste, //
-        sE2_a * K4e * cte, sE2_b * K2e * cte, -sE2_a * K4e * ste, -sE2_b * K2e * ste,     //
-        sE2_a * K1e * ste, sE2_b * K3e * ste, sE2_a * K1e * cte, sE2_b * K3e * cte,       //
-        sE2_a * K4e * ste, sE2_b * K2e * ste, sE2_a * K4e * cte, sE2_b * K2e * cte;
-
-    for (int i = 0; i < s.size(); i++) {
-        const double ca  = cos(alpha[i]);
-        const double sa  = sin(alpha[i]);
-        const double ctr = cos(theta[i]);
-        const double str = sin(theta[i]);
-
-        LHS << -E2_a * K1 * ctr + ca, -E2_b * K3 * ctr, E2_a * K1 * str, E2_b * K3 * str, sa, 0,
-            -E2_a * K4 * ctr, -E2_b * K2 * ctr + ca, E2_a * K4 * str, E2_b * K2 * str, 0, sa,
-            -E2_a * K1 * str, -E2_b * K3 * str, -E2_a * K1 * ctr + 1, -E2_b * K3 * ctr, 0, 0,
-            -E2_a * K4 * str, -E2_b * K2 * str, -E2_a * K4 * ctr, -E2_b * K2 * ctr + 1, 0, 0, //
-            -sa, 0, 0, 0, -E1_a * K1 + ca, -E1_b * K3,                                        //
-            0, -sa, 0, 0, -E1_a * K4, -E1_b * K2 + ca;
-        M.col(i) = echo * (LHS.partialPivLu().solve(RHS)).head(4);
-    }
+    const double cte      = PD * cos(M_PI * f0 * TR);
+    const double ste      = PD * sin(M_PI * f0 * TR);
+    const double w_a      = sE2_a * (K1e + K4e);
+    const double w_b      = sE2_b * (K3e + K2e);
+
+    // theta = PhaseInc + 2 pi f0 TR, by angle addition
+    double const         cpsi  = cos(2. * M_PI * f0 * TR);
+    double const         spsi  = sin(2. * M_PI * f0 * TR);
+    Eigen::ArrayXd const alpha = B1 * s.FA;
+    Eigen::ArrayXd const ca    = alpha.cos();
+    Eigen::ArrayXd const sa    = alpha.sin();
+    Eigen::ArrayXd const ctr   = cpsi * s.cos_PhaseInc - spsi * s.sin_PhaseInc;
+    Eigen::ArrayXd const str   = spsi * s.cos_PhaseInc + cpsi * s.sin_PhaseInc;
+    Eigen::ArrayXd const g     = ctr * (1. + ca);
+
+    // Q^-1, without the determinant which is folded in below
+    Eigen::ArrayXd const qi00 = ca - g * Ex.m11 + Ex2.m11;
+    Eigen::ArrayXd const qi01 = g * Ex.m01 - Ex2.m01;
+    Eigen::ArrayXd const qi10 = g * Ex.m10 - Ex2.m10;
+    Eigen::ArrayXd const qi11 = ca - g * Ex.m00 + Ex2.m00;
+    Eigen::ArrayXd const detq = qi00 * qi11 - qi01 * qi10;
+
+    // P1 and P2 scaled by det(Q)
+    Eigen::ArrayXd const a00  = 1. - ctr * Ex.m00;
+    Eigen::ArrayXd const a11  = 1. - ctr * Ex.m11;
+    Eigen::ArrayXd const p100 = a00 * qi00 - ctr * Ex.m01 * qi10;
+    Eigen::ArrayXd const p101 = a00 * qi01 - ctr * Ex.m01 * qi11;
+    Eigen::ArrayXd const p110 = a11 * qi10 - ctr * Ex.m10 * qi00;
+    Eigen::ArrayXd const p111 = a11 * qi11 - ctr * Ex.m10 * qi01;
+    Eigen::ArrayXd const p200 = str * (Ex.m00 * qi00 + Ex.m01 * qi10);
+    Eigen::ArrayXd const p201 = str * (Ex.m00 * qi01 + Ex.m01 * qi11);
+    Eigen::ArrayXd const p210 = str * (Ex.m10 * qi00 + Ex.m11 * qi10);
+    Eigen::ArrayXd const p211 = str * (Ex.m10 * qi01 + Ex.m11 * qi11);
+
+    // (cos(a) I - E1x + sin(a)^2 P1) z = r
+    Eigen::ArrayXd const s2q = sa.square() / detq;
+    Eigen::ArrayXd const n00 = ca - E1x.m00 + s2q * p100;
+    Eigen::ArrayXd const n01 = s2q * p101 - E1x.m01;
+    Eigen::ArrayXd const n10 = s2q * p110 - E1x.m10;
+    Eigen::ArrayXd const n11 = ca - E1x.m11 + s2q * p111;
+    Eigen::ArrayXd const zs  = -sa / (detq * (n00 * n11 - n01 * n10));
+    Eigen::ArrayXd const z0  = (n11 * r0 - n01 * r1) * zs;
+    Eigen::ArrayXd const z1  = (n00 * r1 - n10 * r0) * zs;
+
+    // x and y magnetisation of each pool, then the echo
+    Eigen::ArrayXd const x0 = p100 * z0 + p101 * z1;
+    Eigen::ArrayXd const x1 = p110 * z0 + p111 * z1;
+    Eigen::ArrayXd const y0 = p200 * z0 + p201 * z1;
+    Eigen::ArrayXd const y1 = p210 * z0 + p211 * z1;
 
     Eigen::ArrayXcd mce(s.size());
-    mce.real() = PD * (M.row(0) + M.row(1));
-    mce.imag() = PD * (M.row(2) + M.row(3));
+    mce.real() = w_a * (cte * x0 - ste * y0) + w_b * (cte * x1 - ste * y1);
+    mce.imag() = w_a * (ste * x0 + cte * y0) + w_b * (ste * x1 + cte * y1);
 
     QI_DBMSG("SSFP2\n");
     QI_DB(PD);
@@ -144,4 +235,132 @@ Eigen::ArrayXcd SSFP2(double const            PD,
     return mce;
 }
 
+/*
+ *  The batched signals follow the single-sample versions above, but swap the roles of the two
+ *  dimensions. The per-sample terms are arrays over the batch, and the loop over flip-angles then
+ *  only does whole-array arithmetic with the shared trigonometry.
+ */
+Eigen::ArrayXXcd SPGR2(Eigen::ArrayXXd const & v,
+                       double const            f0,
+                       double const            B1,
+                       SPGREchoSequence const &spgr) {
+    Eigen::ArrayXd const PD   = v.row(0).transpose();
+    Eigen::ArrayXd const T1_a = v.row(1).transpose();
+    Eigen::ArrayXd const T2_a = v.row(2).transpose();
+    Eigen::ArrayXd const T1_b = v.row(3).transpose();
+    Eigen::ArrayXd const T2_b = v.row(4).transpose();
+    Eigen::ArrayXd const f_a  = v.row(6).transpose();
+    Eigen::ArrayXd       f_b, k_ab, k_ba;
+    CalcExchange(v.row(5).transpose(), f_a, f_b, k_ab, k_ba);
+    auto const E = Exp2(Mat2X{spgr.TR * (-(1. / T1_a) - k_ab),
+                              spgr.TR * k_ba,
+                              spgr.TR * k_ab,
+                              spgr.TR * (-(1. / T1_b) - k_ba)});
+    Eigen::ArrayXd const r0     = (1. - E.m00) * f_a - E.m01 * f_b;
+    Eigen::ArrayXd const r1     = (1. - E.m11) * f_b - E.m10 * f_a;
+    Eigen::ArrayXd const e01e10 = E.m01 * E.m10;
+    // T2' absorbed into PD, the off-resonance phase is the same for every sample
+    auto const           echo  = std::polar(1., 2. * M_PI * f0 * spgr.TE);
+    Eigen::ArrayXd const echoa = PD * (-spgr.TE / T2_a).exp();
+    Eigen::ArrayXd const echob = PD * (-spgr.TE / T2_b).exp();
+
+    Eigen::ArrayXXcd signal(spgr.size(), v.cols());
+    for (Eigen::Index i = 0; i < spgr.size(); i++) {
+        double const         ca  = std::cos(spgr.FA[i] * B1);
+        double const         sa  = std::sin(spgr.FA[i] * B1);
+        Eigen::ArrayXd const b00 = 1. - E.m00 * ca;
+        Eigen::ArrayXd const b11 = 1. - E.m11 * ca;
+        Eigen::ArrayXd const sd  = sa / (b00 * b11 - e01e10 * (ca * ca));
+        Eigen::ArrayXd const Mza = (b11 * r0 + (E.m01 * r1) * ca) * sd;
+        Eigen::ArrayXd const Mzb = (b00 * r1 + (E.m10 * r0) * ca) * sd;
+        Eigen::ArrayXd const M   = echoa * Mza + echob * Mzb;
+
+        signal.row(i).real() = echo.real() * M.transpose();
+        signal.row(i).imag() = echo.imag() * M.transpose();
+    }
+    return signal;
+}
+
+Eigen::ArrayXXcd SSFP2(Eigen::ArrayXXd const &v,
+                       double const           f0,
+                       double const           B1,
+                       SSFPSequence const &   s) {
+    const double &       TR   = s.TR;
+    Eigen::ArrayXd const PD   = v.row(0).transpose();
+    Eigen::ArrayXd const T2_a = v.row(2).transpose();
+    Eigen::ArrayXd const T2_b = v.row(4).transpose();
+    Eigen::ArrayXd const f_a  = v.row(6).transpose();
+    Eigen::ArrayXd const E1_a = (-TR / v.row(1).transpose()).exp();
+    Eigen::ArrayXd const E1_b = (-TR / v.row(3).transpose()).exp();
+    Eigen::ArrayXd const E2_a = (-TR / T2_a).exp();
+    Eigen::ArrayXd const E2_b = (-TR / T2_b).exp();
+    Eigen::ArrayXd       f_b, k_ab, k_ba;
+    CalcExchange(v.row(5).transpose(), f_a, f_b, k_ab, k_ba);
+    Eigen::ArrayXd const E_ab = (-TR * k_ab / f_b).exp();
+    Eigen::ArrayXd const K1   = E_ab * f_b + f_a;
+    Eigen::ArrayXd const K2   = E_ab * f_a + f_b;
+    Eigen::ArrayXd const K3   = f_a * (1 - E_ab);
+    Eigen::ArrayXd const K4   = f_b * (1 - E_ab);
+
+    Mat2X const          Ex{E2_a * K1, E2_b * K3, E2_a * K4, E2_b * K2};
+    Mat2X const          Ex2 = Mul2(Ex, Ex);
+    Mat2X const          E1x{E1_a * K1, E1_b * K3, E1_a * K4, E1_b * K2};
+    Eigen::ArrayXd const r0 = -E1_b * K3 * f_b + f_a * (-E1_a * K1 + 1);
+    Eigen::ArrayXd const r1 = -E1_a * K4 * f_a + f_b * (-E1_b * K2 + 1);
+
+    // TE Evolution, with PD folded into the column sums of the echo matrix
+    Eigen::ArrayXd const sqrtE_ab = (-TR * k_ab / (2 * f_b)).exp();
+    Eigen::ArrayXd const K1e      = sqrtE_ab * f_b + f_a;
+    Eigen::ArrayXd const K2e      = sqrtE_ab * f_a + f_b;
+    Eigen::ArrayXd const K3e      = f_a * (1 - sqrtE_ab);
+    Eigen::ArrayXd const K4e      = f_b * (1 - sqrtE_ab);
+    Eigen::ArrayXd const w_a      = PD * (-TR / (2. * T2_a)).exp() * (K1e + K4e);
+    Eigen::ArrayXd const w_b      = PD * (-TR / (2. * T2_b)).exp() * (K3e + K2e);
+    const double cte  = cos(M_PI * f0 * TR);
+    const double ste  = sin(M_PI * f0 * TR);
+    double const cpsi = cos(2. * M_PI * f0 * TR);
+    double const spsi = sin(2. * M_PI * f0 * TR);
+
+    Eigen::ArrayXXcd mce(s.size(), v.cols());
+    for (Eigen::Index i = 0; i < s.size(); i++) {
+        double const ca  = std::cos(B1 * s.FA[i]);
+        double const sa  = std::sin(B1 * s.FA[i]);
+        double const ctr = cpsi * s.cos_PhaseInc[i] - spsi * s.sin_PhaseInc[i];
+        double const str = spsi * s.cos_PhaseInc[i] + cpsi * s.sin_PhaseInc[i];
+        double const g   = ctr * (1. + ca);
+
+        Eigen::ArrayXd const qi00 = ca - g * Ex.m11 + Ex2.m11;
+        Eigen::ArrayXd const qi01 = g * Ex.m01 - Ex2.m01;
+        Eigen::ArrayXd const qi10 = g * Ex.m10 - Ex2.m10;
+        Eigen::ArrayXd const qi11 = ca - g * Ex.m00 + Ex2.m00;
+        Eigen::ArrayXd const detq = qi00 * qi11 - qi01 * qi10;
+
+        Eigen::ArrayXd const a00  = 1. - ctr * Ex.m00;
+        Eigen::ArrayXd const a11  = 1. - ctr * Ex.m11;
+        Eigen::ArrayXd const p100 = a00 * qi00 - ctr * Ex.m01 * qi10;
+        Eigen::ArrayXd const p101 = a00 * qi01 - ctr * Ex.m01 * qi11;
+        Eigen::ArrayXd const p110 = a11 * qi10 - ctr * Ex.m10 * qi00;
+        Eigen::ArrayXd const p111 = a11 * qi11 - ctr * Ex.m10 * qi01;
+        Eigen::ArrayXd const p200 = str * (Ex.m00 * qi00 + Ex.m01 * qi10);
+        Eigen::ArrayXd const p201 = str * (Ex.m00 * qi01 + Ex.m01 * qi11);
+        Eigen::ArrayXd const p210 = str * (Ex.m10 * qi00 + Ex.m11 * qi10);
+        Eigen::ArrayXd const p211 = str * (Ex.m10 * qi01 + Ex.m11 * qi11);
+
+        Eigen::ArrayXd const s2q = (sa * sa) / detq;
+        Eigen::ArrayXd const n00 = ca - E1x.m00 + s2q * p100;
+        Eigen::ArrayXd const n01 = s2q * p101 - E1x.m01;
+        Eigen::ArrayXd const n10 = s2q * p110 - E1x.m10;
+        Eigen::ArrayXd const n11 = ca - E1x.m11 + s2q * p111;
+        Eigen::ArrayXd const zs  = -sa / (detq * (n00 * n11 - n01 * n10));
+        Eigen::ArrayXd const z0  = (n11 * r0 - n01 * r1) * zs;
+        Eigen::ArrayXd const z1  = (n00 * r1 - n10 * r0) * zs;
+
+        Eigen::ArrayXd const x = w_a * (p100 * z0 + p101 * z1) + w_b * (p110 * z0 + p111 * z1);
+        Eigen::ArrayXd const y = w_a * (p200 * z0 + p201 * z1) + w_b * (p210 * z0 + p211 * z1);
+        mce.row(i).real()      = (cte * x - ste * y).transpose();
+        mce.row(i).imag()      = (ste * x + cte * y).transpose();
+    }
+    return mce;
+}
+
 } // namespace QI
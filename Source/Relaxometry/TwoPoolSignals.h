@@ -38,4 +38,19 @@ Eigen::ArrayXcd SSFP2(double const        PD,
                       double const        B1,
                       SSFPSequence const &ssfp);
 
+/*
+ *  Batched versions for region contraction. Each column of varying is one sample of PD, T1_a,
+ *  T2_a, T1_b, T2_b, tau_a and f_a, and the result has the matching column of signals. The
+ *  flip-angle terms only depend on f0 and B1, so they are shared by the whole batch.
+ */
+Eigen::ArrayXXcd SPGR2(Eigen::ArrayXXd const & varying,
+                       double const            f0,
+                       double const            B1,
+                       SPGREchoSequence const &spgr);
+
+Eigen::ArrayXXcd SSFP2(Eigen::ArrayXXd const &varying,
+                       double const           f0,
+                       double const           B1,
+                       SSFPSequence const &   ssfp);
+
 } // namespace QI
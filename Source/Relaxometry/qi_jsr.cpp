@@ -110,11 +110,11 @@ struct JSRModel : QI::Model<double, double, 4, 1, 2> {
         QI_ARRAY(T) const G = -PD * Ee * (1. - E1) * sin(alpha) / d;
         QI_ARRAY(T) const b = E2 * (1. - E1) * (1. + cos(alpha)) / d;
 
-        QI_ARRAY(T) const theta  = ssfp.PhaseInc + psi;
-        QI_ARRAY(T) const cos_th = cos(theta);
-        QI_ARRAY(T) const sin_th = sin(theta);
+        // theta = PhaseInc + psi
         T const cos_psi          = cos(psi);
         T const sin_psi          = sin(psi);
+        QI_ARRAY(T) const cos_th = cos_psi * ssfp.cos_PhaseInc - sin_psi * ssfp.sin_PhaseInc;
+        QI_ARRAY(T) const sin_th = sin_psi * ssfp.cos_PhaseInc + cos_psi * ssfp.sin_PhaseInc;
 
         QI_ARRAY(T)
         const re_m =
@@ -307,7 +307,8 @@ int jsr_main(args::Subparser &parser) {
                                           verbose,
                                           simulate.Get(),
                                           threads.Get(),
-                                          subregion.Get());
+                                          subregion.Get(),
+                                          seed.Get());
     } else {
         JSRFit jsr_fit{model, npsi.Get()};
         auto   fit_filter =
@@ -251,7 +251,8 @@ int mpm_r2s_main(args::Subparser &parser) {
                                           verbose,
                                           simulate.Get(),
                                           threads.Get(),
-                                          subregion.Get());
+                                          subregion.Get(),
+                                          seed.Get());
     } else {
         auto fit_filter =
             QI::ModelFitFilter<MPMFit>::New(
@@ -117,7 +117,8 @@ int planet_main(args::Subparser &parser) {
                                              verbose,
                                              simulate.Get(),
                                              threads.Get(),
-                                             subregion.Get());
+                                             subregion.Get(),
+                                             seed.Get());
     } else {
         PLANETFit fit{model};
         auto      fit_filter =
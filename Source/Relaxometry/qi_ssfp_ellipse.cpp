@@ -35,12 +35,16 @@ struct EllipseModel : QI::Model<std::complex<double>, double, 5, 0> {
 
         const double &theta0  = v[3];
         const double &psi0    = v[4];
-        const auto    theta   = theta0 - sequence.PhaseInc;
-        const double  psi     = theta0 / 2.0 + psi0;
-        const auto    cos_th  = cos(theta);
-        const auto    sin_th  = sin(theta);
-        const auto    cos_psi = cos(psi);
-        const auto    sin_psi = sin(psi);
+        const double  cos_th0 = cos(theta0);
+        const double  sin_th0 = sin(theta0);
+        // theta = theta0 - PhaseInc
+        const Eigen::ArrayXd cos_th =
+            cos_th0 * sequence.cos_PhaseInc + sin_th0 * sequence.sin_PhaseInc;
+        const Eigen::ArrayXd sin_th =
+            sin_th0 * sequence.cos_PhaseInc - cos_th0 * sequence.sin_PhaseInc;
+        const double psi     = theta0 / 2.0 + psi0;
+        const double cos_psi = cos(psi);
+        const double sin_psi = sin(psi);
         QI_ARRAY(std::complex<double>) result(sequence.PhaseInc.rows());
         result.real() =
             G * (cos_psi - a * (cos_th * cos_psi - sin_th * sin_psi)) / (1.0 - b * cos_th);
@@ -58,10 +62,11 @@ struct EllipseModel : QI::Model<std::complex<double>, double, 5, 0> {
         const T &     b       = v[2];
         const T &     theta0  = v[3];
         const T &     psi0    = v[4];
-        const ArrayXT theta   = theta0 - sequence.PhaseInc;
+        const T       cos_th0 = cos(theta0);
+        const T       sin_th0 = sin(theta0);
+        const ArrayXT cos_th  = cos_th0 * sequence.cos_PhaseInc + sin_th0 * sequence.sin_PhaseInc;
+        const ArrayXT sin_th  = sin_th0 * sequence.cos_PhaseInc - cos_th0 * sequence.sin_PhaseInc;
         const T       psi     = theta0 / 2.0 + psi0;
-        const ArrayXT cos_th  = cos(theta);
-        const ArrayXT sin_th  = sin(theta);
         const T       cos_psi = cos(psi);
         const T       sin_psi = sin(psi);
         const ArrayXT re_m =
@@ -203,7 +208,8 @@ int ssfp_ellipse_main(args::Subparser &parser) {
                                                verbose,
                                                simulate.Get(),
                                                threads.Get(),
-                                               subregion.Get());
+                                               subregion.Get(),
+                                               seed.Get());
     } else {
         EllipseFit fit{model};
         auto       fit_filter =
@@ -15,6 +15,8 @@
 
 #include "Args.h"
 #include "FitFunction.h"
+#include "FitLM.h"
+#include "FitVarPro.h"
 #include "ImageIO.h"
 #include "Model.h"
 #include "ModelFitFilter.h"
@@ -33,6 +35,7 @@ struct DESPOT1 : QI::Model<double, double, 2, 1> {
     std::array<const std::string, 1> const fixed_names{"B1"s};
     FixedArray const                       fixed_defaults{1.0};
 
+    VaryingArray const start{10., 1.};
     VaryingArray const bounds_lo{1.e-6, 1.e-6};
     VaryingArray const bounds_hi{100., 10.};
 
@@ -174,16 +177,49 @@ struct DESPOT1NLLS : DESPOT1Fit {
     }
 };
 
+struct DESPOT1LM : DESPOT1Fit {
+    QI::LMFit<DESPOT1> const lm;
+    DESPOT1LM(DESPOT1 &m) : DESPOT1Fit(m), lm{m, 0.f, static_cast<int>(m.max_iterations)} {}
+
+    QI::FitReturnType fit(const std::vector<Eigen::ArrayXd> &inputs,
+                          DESPOT1::FixedArray const &        fixed,
+                          DESPOT1::VaryingArray &            p,
+                          DESPOT1::CovarArray *              cov,
+                          RMSErrorType &                     rmse,
+                          std::vector<Eigen::ArrayXd> &      residuals,
+                          FlagType &                         iterations) const override {
+        return lm.fit(inputs, fixed, p, cov, rmse, residuals, iterations);
+    }
+};
+
+struct DESPOT1VarPro : DESPOT1Fit {
+    QI::VarProFit<DESPOT1> const vp;
+    DESPOT1VarPro(DESPOT1 &m) : DESPOT1Fit(m), vp{m} {}
+
+    QI::FitReturnType fit(const std::vector<Eigen::ArrayXd> &inputs,
+                          DESPOT1::FixedArray const &        fixed,
+                          DESPOT1::VaryingArray &            p,
+                          DESPOT1::CovarArray *              cov,
+                          RMSErrorType &                     rmse,
+                          std::vector<Eigen::ArrayXd> &      residuals,
+                          FlagType &                         iterations) const override {
+        return vp.fit(inputs, fixed, p, cov, rmse, residuals, iterations);
+    }
+};
+
 //******************************************************************************
 // Main
 //******************************************************************************
 int despot1_main(args::Subparser &parser) {
     args::Positional<std::string> spgr_path(parser, "SPGR FILE", "Path to SPGR data");
     QI_COMMON_ARGS;
+    QI_MONTECARLO_ARG;
+    QI_VARPRO_ARG;
     args::ValueFlag<std::string> B1(parser, "B1", "B1 map (ratio) file", {'b', "B1"});
-    args::ValueFlag<char> algorithm(parser, "ALGO", "Choose algorithm (l/w/n)", {'a', "algo"}, 'l');
+    args::ValueFlag<char> algorithm(
+        parser, "ALGO", "Choose algorithm (l/w/n/m)", {'a', "algo"}, 'l');
     args::ValueFlag<int>  its(
-        parser, "ITERS", "Max iterations for WLLS/NLLS (default 15)", {'i', "its"}, 15);
+        parser, "ITERS", "Max iterations for WLLS/NLLS/LM (default 15)", {'i', "its"}, 15);
     parser.Parse();
     QI::CheckPos(spgr_path);
     QI::Log(verbose, "Reading sequence information");
@@ -191,7 +227,7 @@ int despot1_main(args::Subparser &parser) {
     auto spgrSequence = input.at("SPGR").get<QI::SPGRSequence>();
 
     DESPOT1 model{{}, spgrSequence, its.Get()};
-    if (simulate) {
+    if (simulate && !montecarlo) {
         QI::SimulateModel<DESPOT1, false>(input,
                                           model,
                                           {B1.Get()},
@@ -200,10 +236,15 @@ int despot1_main(args::Subparser &parser) {
                                           verbose,
                                           simulate.Get(),
                                           threads.Get(),
-                                          subregion.Get());
+                                          subregion.Get(),
+                                          seed.Get());
     } else {
         DESPOT1Fit *d1 = nullptr;
-        switch (algorithm.Get()) {
+        switch (varpro ? 'v' : algorithm.Get()) {
+        case 'v':
+            d1 = new DESPOT1VarPro(model);
+            QI::Log(verbose, "VarPro algorithm selected.");
+            break;
         case 'l':
             d1 = new DESPOT1LLS(model);
             QI::Log(verbose, "LLS algorithm selected.");
@@ -216,9 +257,27 @@ int despot1_main(args::Subparser &parser) {
             d1 = new DESPOT1NLLS(model);
             QI::Log(verbose, "NLLS algorithm selected.");
             break;
+        case 'm':
+            d1 = new DESPOT1LM(model);
+            QI::Log(verbose, "Fixed-size LM algorithm selected.");
+            break;
         default:
             QI::Fail("Unknown algorithm type: {}", algorithm.Get());
         }
+        if (montecarlo) {
+            QI::MonteCarloModel(input,
+                                *d1,
+                                {B1.Get()},
+                                mask.Get(),
+                                verbose,
+                                simulate.Get(),
+                                montecarlo.Get(),
+                                seed.Get(),
+                                threads.Get(),
+                                subregion.Get(),
+                                prefix.Get() + "D1_");
+            return EXIT_SUCCESS;
+        }
         auto fit = QI::ModelFitFilter<DESPOT1Fit>::New(
             d1, verbose, covar, resids, threads.Get(), subregion.Get());
         fit->ReadInputs({QI::CheckPos(spgr_path)}, {B1.Get()}, mask.Get());
@@ -207,7 +207,8 @@ int despot1hifi_main(args::Subparser &parser) {
                                            verbose,
                                            simulate.Get(),
                                            threads.Get(),
-                                           subregion.Get());
+                                           subregion.Get(),
+                                           seed.Get());
     } else {
         HIFIFit hifi_fit{model};
         auto    fit_filter =
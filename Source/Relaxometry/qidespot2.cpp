@@ -16,6 +16,7 @@
 
 #include "Args.h"
 #include "FitFunction.h"
+#include "FitVarPro.h"
 #include "ImageIO.h"
 #include "Model.h"
 #include "ModelFitFilter.h"
@@ -30,6 +31,7 @@ struct DESPOT2 : QI::Model<double, double, 2, 2> {
     long const                       max_iterations;
     std::array<const std::string, 2> varying_names{{"PD"s, "T2"s}};
 
+    VaryingArray const               start{10., 0.1};
     VaryingArray const               bounds_lo{1e-6, 1e-3};
     VaryingArray const               bounds_hi{100, 5};
     std::array<const std::string, 2> fixed_names{{"T1"s, "B1"s}};
@@ -225,12 +227,28 @@ struct DESPOT2NLLS : DESPOT2Fit {
     }
 };
 
+struct DESPOT2VarPro : DESPOT2Fit {
+    QI::VarProFit<DESPOT2> const vp;
+    DESPOT2VarPro(DESPOT2 &m) : DESPOT2Fit(m), vp{m} {}
+
+    QI::FitReturnType fit(const std::vector<Eigen::ArrayXd> &inputs,
+                          DESPOT2::FixedArray const &        fixed,
+                          DESPOT2::VaryingArray &            p,
+                          DESPOT2::CovarArray *              cov,
+                          RMSErrorType &                     rmse,
+                          std::vector<Eigen::ArrayXd> &      residuals,
+                          FlagType &                         iterations) const override {
+        return vp.fit(inputs, fixed, p, cov, rmse, residuals, iterations);
+    }
+};
+
 //******************************************************************************
 // Main
 //******************************************************************************
 int despot2_main(args::Subparser &parser) {
     args::Positional<std::string> ssfp_path(parser, "SSFP FILE", "Path to SSFP data");
     QI_COMMON_ARGS;
+    QI_VARPRO_ARG;
     args::ValueFlag<std::string> t1_path(parser, "T1 MAP", "Path to T1 map **REQUIRED**", {"T1"});
     args::ValueFlag<std::string> B1(parser, "B1", "B1 map (ratio) file", {'b', "B1"});
     args::ValueFlag<char> algorithm(parser, "ALGO", "Choose algorithm (l/w/n)", {'a', "algo"}, 'l');
@@ -244,9 +262,11 @@ int despot2_main(args::Subparser &parser) {
     json    input = json_file ? QI::ReadJSON(json_file.Get()) : QI::ReadJSON(std::cin);
     auto    ssfp  = input.at("SSFP").get<QI::SSFPSequence>();
     DESPOT2 model{{}, ssfp, its.Get()};
+    if (gs_arg) {
+        QI::Log(verbose, "GS Mode selected");
+        model.elliptical = true;
+    }
     if (simulate) {
-        if (gs_arg)
-            model.elliptical = true;
         QI::SimulateModel<DESPOT2, false>(input,
                                           model,
                                           {QI::CheckValue(t1_path), B1.Get()},
@@ -255,10 +275,15 @@ int despot2_main(args::Subparser &parser) {
                                           verbose,
                                           simulate.Get(),
                                           threads.Get(),
-                                          subregion.Get());
+                                          subregion.Get(),
+                                          seed.Get());
     } else {
         DESPOT2Fit *d2 = nullptr;
-        switch (algorithm.Get()) {
+        switch (varpro ? 'v' : algorithm.Get()) {
+        case 'v':
+            d2 = new DESPOT2VarPro(model);
+            QI::Log(verbose, "VarPro algorithm selected.");
+            break;
         case 'l':
             d2 = new DESPOT2LLS(model);
             QI::Log(verbose, "LLS algorithm selected.");
@@ -272,10 +297,6 @@ int despot2_main(args::Subparser &parser) {
             QI::Log(verbose, "NLLS algorithm selected.");
             break;
         }
-        if (gs_arg) {
-            QI::Log(verbose, "GS Mode selected");
-            d2->model.elliptical = true;
-        }
         auto fit = QI::ModelFitFilter<DESPOT2Fit>::New(
             d2, verbose, covar, resids, threads.Get(), subregion.Get());
         fit->ReadInputs({QI::CheckPos(ssfp_path)}, {QI::CheckValue(t1_path), B1.Get()}, mask.Get());
@@ -53,10 +53,14 @@ struct FMModel : QI::Model<double, double, 3, 2> {
         const T a           = E2;
         const QI_ARRAY(T) b = E2 * (1 - E1) * (1 + cos(B1 * s.FA)) / d;
 
-        const T theta0           = 2. * M_PI * f0 * sequence.TR;
-        const QI_ARRAY(T) theta  = theta0 + sequence.PhaseInc;
-        const QI_ARRAY(T) cos_th = cos(theta);
-        const QI_ARRAY(T) sin_th = sin(theta);
+        // theta = theta0 + PhaseInc
+        const T theta0  = 2. * M_PI * f0 * sequence.TR;
+        const T cos_th0 = cos(theta0);
+        const T sin_th0 = sin(theta0);
+        const QI_ARRAY(T) cos_th =
+            cos_th0 * sequence.cos_PhaseInc - sin_th0 * sequence.sin_PhaseInc;
+        const QI_ARRAY(T) sin_th =
+            sin_th0 * sequence.cos_PhaseInc + cos_th0 * sequence.sin_PhaseInc;
         const T psi              = theta0 / 2.0;
         const T cos_psi          = cos(psi);
         const T sin_psi          = sin(psi);
@@ -75,8 +79,10 @@ using FMFit = QI::FitFunction<FMModel>;
 
 struct FMNLLS : FMFit {
     using FMFit::FMFit;
+    static const bool WarmStart = true;
     long              max_iterations;
     bool              asymmetric = false;
+    double            warm_rmse  = 0.05; // Accept a warm start without trying other f0 below this
     QI::FitReturnType fit(const std::vector<Eigen::ArrayXd> &inputs,
                           FMModel::FixedArray const &        fixed,
                           FMModel::VaryingArray &            bestP,
@@ -122,18 +128,38 @@ struct FMNLLS : FMFit {
             options.gradient_tolerance  = 1e-7;
             options.parameter_tolerance = 1e-5;
             options.logging_type        = ceres::SILENT;
-            for (const double &f0 : f0_starts) {
-                p = {5., std::max(0.1 * T1, 1.5 * model.sequence.TR), f0};
-                // Yarnykh gives T2 = 0.045 * T1 in brain, but best to overestimate for CSF
+            bool warm_ok = false;
+            if (QI::IsWarmStart(bestP)) {
+                // Start from the neighbour's solution, and only fall back to the full set of f0
+                // starts if that did not fit well
+                double const f0_lo = this->asymmetric ? -0.5 / model.sequence.TR : 0.0;
+                p                  = bestP;
+                p[0]               = std::max(p[0] / scale, 1.);
+                p[1]               = std::clamp(p[1], model.sequence.TR, T1);
+                p[2]               = std::clamp(p[2], f0_lo, 0.5 / model.sequence.TR);
                 ceres::Solve(options, &problem, &summary);
                 if (!summary.IsSolutionUsable()) {
                     return {false, summary.FullReport()};
                 }
-                double r = summary.final_cost;
-                if (r < best) {
-                    best       = r;
-                    bestP      = p;
-                    iterations = summary.iterations.size();
+                best       = summary.final_cost;
+                bestP      = p;
+                iterations = summary.iterations.size();
+                warm_ok    = sqrt(2. * best / data.rows()) < warm_rmse;
+            }
+            if (!warm_ok) {
+                for (const double &f0 : f0_starts) {
+                    p = {5., std::max(0.1 * T1, 1.5 * model.sequence.TR), f0};
+                    // Yarnykh gives T2 = 0.045 * T1 in brain, but best to overestimate for CSF
+                    ceres::Solve(options, &problem, &summary);
+                    if (!summary.IsSolutionUsable()) {
+                        return {false, summary.FullReport()};
+                    }
+                    double r = summary.final_cost;
+                    if (r < best) {
+                        best       = r;
+                        bestP      = p;
+                        iterations = summary.iterations.size();
+                    }
                 }
             }
             if (!summary.IsSolutionUsable()) {
@@ -174,6 +200,8 @@ int despot2fm_main(args::Subparser &parser) {
     args::ValueFlag<int>         its(
         parser, "ITERS", "Max iterations for NLLS (default 75)", {'i', "its"}, 75);
     args::Flag asym(parser, "ASYM", "Fit +/- off-resonance frequency", {'A', "asym"});
+    args::Flag warm(
+        parser, "WARM", "Start from fitted neighbours instead of multiple f0 starts", {"warm"});
     parser.Parse();
 
     QI::Log(verbose, "Reading sequence information");
@@ -189,7 +217,8 @@ int despot2fm_main(args::Subparser &parser) {
                                           verbose,
                                           simulate.Get(),
                                           threads.Get(),
-                                          subregion.Get());
+                                          subregion.Get(),
+                                          seed.Get());
     } else {
         FMNLLS fm{model};
         fm.max_iterations = its.Get();
@@ -197,6 +226,7 @@ int despot2fm_main(args::Subparser &parser) {
         auto fit_filter =
             QI::ModelFitFilter<FMNLLS>::New(
                 &fm, verbose, covar, resids, threads.Get(), subregion.Get());
+        fit_filter->SetWarmStart(warm);
         fit_filter->ReadInputs(
             {QI::CheckPos(ssfp_path)}, {QI::CheckValue(t1_path), B1.Get()}, mask.Get());
         fit_filter->Update();
@@ -123,7 +123,8 @@ int irtse_main(args::Subparser &parser) {
                                             verbose,
                                             simulate.Get(),
                                             threads.Get(),
-                                            subregion.Get());
+                                            subregion.Get(),
+                                            seed.Get());
     } else {
         IRTSEFit *me = nullptr;
 
@@ -15,8 +15,10 @@
 #include "ceres/ceres.h"
 #include <Eigen/Core>
 #include <array>
+#include <limits>
 
 #include "Args.h"
+#include "FitDictionary.h"
 #include "FitFunction.h"
 #include "ImageIO.h"
 #include "Model.h"
@@ -29,6 +31,14 @@
 #include "TwoPoolModel.h"
 #include "Util.h"
 
+// Models that can evaluate a whole batch of samples at once, sharing the flip-angle terms
+template <typename Model>
+concept BatchModel = requires(Model const &                      m,
+                              Eigen::ArrayXXd const &            samples,
+                              typename Model::FixedArray const &fixed) {
+    m.signal_batch(samples, fixed);
+};
+
 template <typename Model> struct MCDSRCFunctor {
     const Eigen::ArrayXd data, weights;
     const QI_ARRAYN(double, Model::NF) fixed;
@@ -55,6 +65,17 @@ template <typename Model> struct MCDSRCFunctor {
     double operator()(const QI_ARRAYN(double, Model::NV) & varying) const {
         return (residuals(varying) * weights).square().sum();
     }
+
+    // Costs for one sample per column, which RegionContraction uses instead of operator()
+    void batch(Eigen::ArrayXXd const &samples, Eigen::ArrayXd &costs) const
+        requires BatchModel<Model>
+    {
+        costs = ((model.signal_batch(samples, fixed).colwise() - data).colwise() * weights)
+                    .square()
+                    .colwise()
+                    .sum()
+                    .transpose();
+    }
 };
 
 template <typename Model> struct SRCFit {
@@ -78,9 +99,15 @@ template <typename Model> struct SRCFit {
     }
     int n_outputs() const { return Model::NV; }
 
-    int    max_iterations = 5;
-    size_t src_samples = 5000, src_retain = 50;
-    bool   src_gauss = true;
+    int                         max_iterations = 5;
+    size_t                      src_samples = 5000, src_retain = 50;
+    bool                        src_gauss    = true;
+    bool                        src_adaptive = false;
+    QI::RCSampler               src_sampler  = QI::RCSampler::Random;
+    int                         src_seed     = -1; // Negative for a random seed in every voxel
+    mutable std::atomic<size_t> evaluations{0}; // Total cost function evaluations
+
+    void addTelemetry(json &report) const { report["src_evaluations"] = evaluations.load(); }
 
     QI::FitReturnType fit(const std::vector<Eigen::ArrayXd> &inputs,
                           typename Model::FixedArray const & fixed,
@@ -117,8 +144,13 @@ template <typename Model> struct SRCFit {
                                           max_iterations,
                                           0.02,
                                           src_gauss,
-                                          false);
-        if (!rc.optimise(v)) {
+                                          false,
+                                          src_seed);
+        rc.setSampler(src_sampler);
+        rc.setAdaptive(src_adaptive);
+        bool const success = rc.optimise(v);
+        evaluations += rc.evaluations();
+        if (!success) {
             return {false, "Region contraction failed"};
         }
         auto r   = func.residuals(v);
@@ -142,6 +174,10 @@ int mcdespot_main(args::Subparser &parser) {
     args::Positional<std::string> spgr_path(parser, "SPGR FILE", "Input SPGR file");
     args::Positional<std::string> ssfp_path(parser, "SSFP FILE", "Input SSFP file");
     QI_COMMON_ARGS;
+    QI_MONTECARLO_ARG;
+    QI_CHECKPOINT_ARGS;
+    QI_SLAB_ARG;
+    QI_TELEMETRY_ARG;
     args::ValueFlag<std::string> f0(parser, "f0", "f0 map (Hertz)", {'f', "f0"});
     args::ValueFlag<std::string> B1(parser, "B1", "B1 map (ratio)", {'b', "B1"});
     args::ValueFlag<int>         modelarg(
@@ -150,10 +186,32 @@ int mcdespot_main(args::Subparser &parser) {
     args::Flag use_src(
         parser, "SRC", "Use flat prior (stochastic region contraction), not gaussian", {"SRC"});
     args::ValueFlag<int> its(parser, "ITERS", "Max iterations, default 4", {'i', "its"}, 4);
+    args::ValueFlag<std::string> sampler(
+        parser, "SAMPLER", "SRC sampler, random (default) or sobol", {"sampler"}, "random");
+    args::Flag adaptive(parser,
+                        "ADAPTIVE",
+                        "Shrink the SRC sample count as the region contracts, stop when stable",
+                        {"adaptive"});
     args::Flag           bounds(parser, "BOUNDS", "Specify bounds in input", {"bounds"});
+    args::ValueFlag<std::string> dict(
+        parser,
+        "DICT",
+        "Match to a dictionary instead of SRC, saved to/read from this file",
+        {"dict"});
+    args::Flag dict_float(parser, "FLOAT", "Store the dictionary as float32", {"dict-float"});
+    args::Flag no_refine(
+        parser, "NO REFINE", "Do not refine dictionary matches between atoms", {"no-refine"});
+    args::ValueFlag<int> polish(
+        parser, "POLISH", "Polish dictionary matches with N NLLS iterations", {"polish"}, 0);
     parser.Parse();
     QI::CheckPos(spgr_path);
     QI::CheckPos(ssfp_path);
+    if (resume && !checkpoint) {
+        QI::Fail("--resume requires --checkpoint");
+    }
+    if (slab && checkpoint) {
+        QI::Fail("--slab cannot be combined with --checkpoint");
+    }
 
     QI::Log(verbose, "Reading sequences");
     auto input = json_file ? QI::ReadJSON(json_file.Get()) : QI::ReadJSON(std::cin);
@@ -161,7 +219,7 @@ int mcdespot_main(args::Subparser &parser) {
     auto ssfp  = input.at("SSFP").get<QI::SSFPSequence>();
 
     auto process = [&](auto model, const std::string &model_name) {
-        if (simulate) {
+        if (simulate && !montecarlo) {
             QI::SimulateModel<decltype(model), true>(input,
                                                      model,
                                                      {f0.Get(), B1.Get()},
@@ -170,26 +228,93 @@ int mcdespot_main(args::Subparser &parser) {
                                                      verbose,
                                                      simulate.Get(),
                                                      threads.Get(),
-                                                     subregion.Get());
+                                                     subregion.Get(),
+                                                     seed.Get());
         } else {
+            auto run = [&](auto &fit) {
+                using FitType = std::remove_reference_t<decltype(fit)>;
+                if (montecarlo) {
+                    QI::MonteCarloModel(input,
+                                        fit,
+                                        {f0.Get(), B1.Get()},
+                                        mask.Get(),
+                                        verbose,
+                                        simulate.Get(),
+                                        montecarlo.Get(),
+                                        seed.Get(),
+                                        threads.Get(),
+                                        subregion.Get(),
+                                        prefix.Get() + model_name);
+                    return;
+                }
+                auto fit_filter = QI::ModelFitFilter<FitType>::New(
+                    &fit, verbose, covar, resids, threads.Get(), subregion.Get());
+                fit_filter->SetTelemetry(telemetry.Get());
+                if (slab) {
+                    fit_filter->ProcessSlabs({spgr_path.Get(), ssfp_path.Get()},
+                                             {f0.Get(), B1.Get()},
+                                             mask.Get(),
+                                             prefix.Get() + model_name,
+                                             slab.Get());
+                } else {
+                    fit_filter->ReadInputs(
+                        {spgr_path.Get(), ssfp_path.Get()}, {f0.Get(), B1.Get()}, mask.Get());
+                    if (checkpoint) {
+                        fit_filter->SetCheckpoint(
+                            checkpoint.Get(), checkpoint_interval.Get(), resume);
+                    }
+                    fit_filter->Update();
+                    fit_filter->WriteOutputs(prefix.Get() + model_name);
+                }
+                QI::Log(verbose, "Finished.");
+            };
+            if (dict) {
+                auto match = [&](auto scalar) {
+                    using Scalar   = decltype(scalar);
+                    json const key = {{"SPGR", input.at("SPGR")},
+                                      {"SSFP", input.at("SSFP")},
+                                      {"dictionary", input.at("dictionary")},
+                                      {"model", model_name},
+                                      {"scale", model.scale_to_mean}};
+                    QI::Dictionary<decltype(model), Scalar> const dictionary(model,
+                                                                             input.at("dictionary"),
+                                                                             key,
+                                                                             dict.Get(),
+                                                                             threads.Get(),
+                                                                             verbose);
+                    QI::DictionaryFit<decltype(model), Scalar> fit{model, dictionary};
+                    fit.refine        = !no_refine;
+                    fit.polish        = polish.Get();
+                    fit.scale_to_mean = model.scale_to_mean;
+                    run(fit);
+                };
+                if (dict_float) {
+                    match(float{});
+                } else {
+                    match(double{});
+                }
+                return;
+            }
             using FitType = SRCFit<decltype(model)>;
             FitType src{model};
-            src.src_gauss = !use_src;
+            src.src_gauss    = !use_src;
+            src.src_adaptive = adaptive;
+            if (seed) {
+                // Every voxel starts from the same seed, so the fit does not depend on threading
+                src.src_seed = static_cast<int>(seed.Get() % std::numeric_limits<int>::max());
+            }
+            if (sampler.Get() == "sobol") {
+                src.src_sampler = QI::RCSampler::Sobol;
+            } else if (sampler.Get() != "random") {
+                QI::Fail("Unknown SRC sampler: {}", sampler.Get());
+            }
             if (bounds) {
                 src.model.bounds_lo = QI::ArrayFromJSON<double>(input, "lower_bounds");
                 src.model.bounds_hi = QI::ArrayFromJSON<double>(input, "upper_bounds");
             }
             QI::Log(verbose, "Low bounds: {}", src.model.bounds_lo.transpose());
             QI::Log(verbose, "High bounds: {}", src.model.bounds_hi.transpose());
-
-            auto fit_filter =
-                QI::ModelFitFilter<FitType>::New(
-                    &src, verbose, covar, resids, threads.Get(), subregion.Get());
-            fit_filter->ReadInputs(
-                {spgr_path.Get(), ssfp_path.Get()}, {f0.Get(), B1.Get()}, mask.Get());
-            fit_filter->Update();
-            fit_filter->WriteOutputs(prefix.Get() + model_name);
-            QI::Log(verbose, "Finished.");
+            run(src);
         }
     };
     switch (modelarg.Get()) {
@@ -125,7 +125,12 @@ int mp2rage_main(args::Subparser &parser) {
         }
     }
     QI::Log(verbose, "Lookup table length = {}", num_entries);
-    QI::SplineInterpolator mp2_to_t1(MP2_values.head(num_entries), T1_values.head(num_entries));
+    // The contrast falls monotonically with T1, so the inverse is tabulated once for all voxels
+    QI::SplineTable mp2_to_t1(
+        QI::SplineInterpolator(MP2_values.head(num_entries), T1_values.head(num_entries)),
+        MP2_values[num_entries - 1],
+        MP2_values[0],
+        16384);
     if (beta) {
         QI::Log(verbose, "Recalculating unregularised MP2 image");
         MP2Filter->SetFunctor([&](const std::complex<float> &p1, const std::complex<float> &p2) {
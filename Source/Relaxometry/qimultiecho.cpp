@@ -187,7 +187,8 @@ int multiecho_main(args::Subparser &parser) {
                                             verbose,
                                             simulate.Get(),
                                             threads.Get(),
-                                            subregion.Get());
+                                            subregion.Get(),
+                                            seed.Get());
     } else {
         MultiEchoFit *me = nullptr;
         switch (algorithm.Get()) {
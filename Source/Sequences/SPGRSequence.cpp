@@ -17,7 +17,8 @@
 
 namespace QI {
 
-SPGRSequence::SPGRSequence(Eigen::ArrayXd const &FA_, double const &TR_) : FA{FA_}, TR{TR_} {}
+SPGRSequence::SPGRSequence(Eigen::ArrayXd const &FA_, double const &TR_) :
+    FA{FA_}, TR{TR_}, sin_FA{FA_.sin()}, cos_FA{FA_.cos()} {}
 
 Eigen::Index SPGRSequence::size() const {
     return FA.rows();
@@ -25,7 +26,9 @@ Eigen::Index SPGRSequence::size() const {
 
 void from_json(const json &j, SPGRSequence &s) {
     j.at("TR").get_to(s.TR);
-    s.FA = ArrayFromJSON(j, "FA", M_PI / 180.0);
+    s.FA     = ArrayFromJSON(j, "FA", M_PI / 180.0);
+    s.sin_FA = s.FA.sin();
+    s.cos_FA = s.FA.cos();
 }
 
 void to_json(json &j, const SPGRSequence &s) {
@@ -21,6 +21,7 @@ namespace QI {
 struct SPGRSequence : SequenceBase {
     Eigen::ArrayXd FA;
     double         TR;
+    Eigen::ArrayXd sin_FA, cos_FA; // Nominal (B1 = 1) values, filled from FA
     SPGRSequence(Eigen::ArrayXd const &FA, double const &TR);
     Eigen::Index size() const override;
     QI_SEQUENCE_DECLARE(SPGR);
@@ -40,6 +40,8 @@ void from_json(const json &j, SSFPSequence &s) {
                  s.PhaseInc.rows(),
                  s.FA.rows());
     }
+    s.cos_PhaseInc = s.PhaseInc.cos();
+    s.sin_PhaseInc = s.PhaseInc.sin();
 }
 
 void to_json(json &j, const SSFPSequence &s) {
@@ -64,6 +66,8 @@ void from_json(const json &j, SSFPFiniteSequence &s) {
                  s.PhaseInc.rows(),
                  s.FA.rows());
     }
+    s.cos_PhaseInc = s.PhaseInc.cos();
+    s.sin_PhaseInc = s.PhaseInc.sin();
 }
 
 void to_json(json &j, const SSFPFiniteSequence &s) {
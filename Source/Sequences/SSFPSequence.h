@@ -26,6 +26,7 @@ struct SSFPBase : SequenceBase {
 
 struct SSFPSequence : SSFPBase {
     Eigen::ArrayXd PhaseInc;
+    Eigen::ArrayXd cos_PhaseInc, sin_PhaseInc; // Filled by from_json
     QI_SEQUENCE_DECLARE(SSFP);
     Eigen::ArrayXd weights(const double f0) const override;
 };
@@ -39,6 +40,7 @@ void to_json(json &j, const SSFPSequence &s);
 struct SSFPFiniteSequence : SSFPBase {
     double         Trf;
     Eigen::ArrayXd PhaseInc;
+    Eigen::ArrayXd cos_PhaseInc, sin_PhaseInc; // Filled by from_json
 
     QI_SEQUENCE_DECLARE(SSFPFinite);
     Eigen::ArrayXd weights(const double f0) const override;
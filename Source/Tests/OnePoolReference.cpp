@@ -0,0 +1,50 @@
+/*
+ *  OnePoolReference.cpp - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2021 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include "OnePoolReference.h"
+
+#include <complex>
+
+namespace QI::Reference {
+
+Eigen::ArrayXd
+SPGRSignal(double const PD, double const T1, double const B1, SPGRSequence const &s) {
+    Eigen::ArrayXd const sa = sin(B1 * s.FA);
+    Eigen::ArrayXd const ca = cos(B1 * s.FA);
+    double const         E1 = exp(-s.TR / T1);
+    return PD * ((1. - E1) * sa) / (1. - E1 * ca);
+}
+
+Eigen::ArrayXcd SSFP1(double const        PD,
+                      double const        T1,
+                      double const        T2,
+                      double const        f0,
+                      double const        B1,
+                      SSFPSequence const &s) {
+    const double E1 = exp(-s.TR / T1);
+    const double E2 = exp(-s.TR / T2);
+
+    const double               psi   = 2. * M_PI * f0 * s.TR;
+    const Eigen::ArrayXd       alpha = s.FA * B1;
+    const Eigen::ArrayXd       theta = psi + s.PhaseInc;
+    const Eigen::ArrayXd       d     = (1. - E1 * E2 * E2 - (E1 - E2 * E2) * cos(alpha));
+    const std::complex<double> echo  = sqrt(E2) * std::polar(1., psi / 2.);
+    const Eigen::ArrayXcd      G     = -PD * echo * (1 - E1) * sin(alpha) / d;
+    const Eigen::ArrayXd       b     = E2 * (1. - E1) * (1. + cos(alpha)) / d;
+
+    Eigen::ArrayXcd et(theta.size());
+    et.real() = cos(-theta);
+    et.imag() = sin(-theta);
+
+    return G * (1. - E2 * et) / (1 - b * cos(theta));
+}
+
+} // namespace QI::Reference
@@ -0,0 +1,32 @@
+/*
+ *  OnePoolReference.h - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2021 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include "SPGRSequence.h"
+#include "SSFPSequence.h"
+
+namespace QI::Reference {
+
+/*
+ *  The one-pool signals as they were before the sequences kept trig tables, with the flip-angle
+ *  and phase-increment trig redone on every call. Only used to check and time the fast versions.
+ */
+Eigen::ArrayXd
+SPGRSignal(double const PD, double const T1, double const B1, SPGRSequence const &s);
+Eigen::ArrayXcd SSFP1(double const        PD,
+                      double const        T1,
+                      double const        T2,
+                      double const        f0,
+                      double const        B1,
+                      SSFPSequence const &s);
+
+} // namespace QI::Reference
@@ -0,0 +1,43 @@
+/*
+ *  OnePoolSignalsBench.cpp - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2021 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *  Time per voxel of the one-pool signals with the sequence trig tables and with the trig redone
+ *  on every call. The transient PARMESAN models are timed by qi_bench_transient.
+ *
+ */
+
+#include <cstdlib>
+
+#include "OnePoolReference.h"
+#include "OnePoolSignals.h"
+#include "SignalBench.h"
+
+using namespace QI::SignalBench;
+
+int main() {
+    auto const spgr =
+        json{{"TR", 8e-3}, {"FA", {2, 4, 6, 8, 10, 12, 14, 16}}}.get<QI::SPGRSequence>();
+    auto const ssfp =
+        json{{"TR", 8e-3},
+             {"FA", {12, 16, 24, 32, 40, 50, 60, 70, 12, 16, 24, 32, 40, 50, 60, 70}},
+             {"PhaseInc", {180, 180, 180, 180, 180, 180, 180, 180, 0, 0, 0, 0, 0, 0, 0, 0}}}
+            .get<QI::SSFPSequence>();
+
+    double const spgr_ref =
+        Time([&](double T1) { return QI::Reference::SPGRSignal(1., T1, 1., spgr); }, 1.07);
+    double const spgr_new = Time([&](double T1) { return QI::SPGRSignal(1., T1, 1., spgr); }, 1.07);
+    double const ssfp_ref = Time(
+        [&](double T1) { return QI::Reference::SSFP1(1., T1, 0.05, 25., 0.95, ssfp); }, 1.07);
+    double const ssfp_new =
+        Time([&](double T1) { return QI::SSFP1(1., T1, 0.05, 25., 0.95, ssfp); }, 1.07);
+    Header("Per call (ns)", "Tables (ns)");
+    Row("SPGR", spgr.size(), spgr_ref, spgr_new);
+    Row("SSFP1", ssfp.size(), ssfp_ref, ssfp_new);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+/*
+ *  OnePoolSignalsTest.cpp - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2021 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *  Compares the one-pool signals, which use the trig tables kept by the sequences, against the
+ *  reference that redoes the trig on every call.
+ *
+ */
+
+#include <cstdlib>
+#include <random>
+
+#include "OnePoolReference.h"
+#include "OnePoolSignals.h"
+#include "SignalBench.h"
+
+using namespace QI::SignalBench;
+
+namespace {
+constexpr int    samples   = 100000;
+constexpr double tolerance = 1e-12;
+} // namespace
+
+int main() {
+    auto const spgr =
+        json{{"TR", 8e-3}, {"FA", {2, 4, 6, 8, 10, 12, 14, 16}}}.get<QI::SPGRSequence>();
+    auto const ssfp =
+        json{{"TR", 8e-3},
+             {"FA", {12, 16, 24, 32, 40, 50, 60, 70, 12, 16, 24, 32, 40, 50, 60, 70}},
+             {"PhaseInc", {180, 180, 180, 180, 180, 180, 180, 180, 0, 0, 0, 0, 0, 0, 0, 0}}}
+            .get<QI::SSFPSequence>();
+
+    std::mt19937_64                  rng(42);
+    std::uniform_real_distribution<> uniform(0., 1.);
+    Errors                           errors("SPGR", "SSFP1", tolerance);
+    for (int i = 0; i < samples; i++) {
+        double const T1 = 0.05 + 4.95 * uniform(rng);
+        double const T2 = 0.005 + (T1 - 0.005) * uniform(rng);
+        double const f0 = -150. + 300. * uniform(rng);
+        // Every other sample has B1 = 1, where SPGRSignal takes the tables
+        double const B1       = (i & 1) ? 0.7 + 0.6 * uniform(rng) : 1.;
+        double const spgr_err = Error(QI::SPGRSignal(1., T1, B1, spgr),
+                                      QI::Reference::SPGRSignal(1., T1, B1, spgr));
+        double const ssfp_err = Error(QI::SSFP1(1., T1, T2, f0, B1, ssfp),
+                                      QI::Reference::SSFP1(1., T1, T2, f0, B1, ssfp));
+
+        auto const where = [&] {
+            return fmt::format("Mismatch at T1 {} T2 {} f0 {} B1 {}", T1, T2, f0, B1);
+        };
+        if (!errors.add(where, spgr_err, ssfp_err)) {
+            return EXIT_FAILURE;
+        }
+    }
+    errors.print(fmt::format("error over {} samples", samples));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,78 @@
+/*
+ *  ParmesanBench.h - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2021 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include <chrono>
+#include <limits>
+
+#include "parmesan.hpp"
+
+/*
+ *  Timing and Jacobians shared by the PARMESAN benchmarks
+ */
+namespace QI::Bench {
+
+constexpr int calls   = 500;
+constexpr int repeats = 5;
+
+// Microseconds per call of f(i), best of several repeats to skip over interruptions
+template <typename F> double Time(F const &f) {
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < repeats; r++) {
+        auto const start = std::chrono::steady_clock::now();
+        for (int i = 0; i < calls; i++) {
+            f(i);
+        }
+        auto const stop = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::micro>(stop - start).count());
+    }
+    return best / calls;
+}
+
+// One signal and two more per parameter, with the relative step of ceres::CENTRAL as used by
+// ScaledNumericDiffFit
+template <typename F, typename V> Eigen::MatrixXd Central(F const &signal, V const &v) {
+    Eigen::ArrayXd const s0 = signal(v);
+    Eigen::MatrixXd      J(s0.rows(), v.rows());
+    for (int i = 0; i < v.rows(); i++) {
+        double const h  = (v[i] != 0.) ? 1e-6 * std::abs(v[i]) : 1e-6;
+        V            vp = v, vm = v;
+        vp[i] += h;
+        vm[i] -= h;
+        J.col(i) = (signal(vp) - signal(vm)).matrix() / (2. * h);
+    }
+    return J;
+}
+
+// One signal with a Jet per parameter, as ScaledAutoDiffFit
+template <typename Model>
+Eigen::MatrixXd Automatic(Model const &model, typename Model::VaryingArray const &v) {
+    using Jet = ParmesanJet<Model>;
+    QI_ARRAYN(Jet, Model::NV) vj;
+    for (int i = 0; i < Model::NV; i++) {
+        vj[i] = Jet(v[i], i);
+    }
+    auto const      sj = model.signal(vj, typename Model::FixedArray());
+    Eigen::MatrixXd J(sj.rows(), Model::NV);
+    for (int i = 0; i < sj.rows(); i++) {
+        J.row(i) = sj[i].v.transpose();
+    }
+    return J;
+}
+
+// Nudge a parameter each call so nothing is hoisted out of the timing loop
+template <typename V> V Nudge(V v, int const i) {
+    v[1] += i * 1e-9;
+    return v;
+}
+
+} // namespace QI::Bench
@@ -0,0 +1,93 @@
+/*
+ *  ParmesanDerivsBench.cpp - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2021 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *  Wall time of one Jacobian of each PARMESAN model by central differences and by automatic
+ *  differentiation, which is what each fit iteration pays for. The faster one should be the
+ *  model's prefer_autodiff default in ss_main and transient_main.
+ *
+ */
+
+#include <cstdlib>
+
+#include "fmt/format.h"
+
+#include "ParmesanBench.h"
+#include "TestSequences.h"
+#include "ss_T2.h"
+#include "ss_model.h"
+#include "ss_mt.h"
+#include "transient_b1_model.h"
+#include "transient_model.h"
+#include "transient_mt_model.h"
+
+namespace {
+using namespace QI::Bench;
+
+template <typename Model> bool Row(std::string const &name, Model const &model) {
+    typename Model::VaryingArray const v = model.start;
+
+    auto const signal = [&](auto const &p) {
+        return model.signal(p, typename Model::FixedArray());
+    };
+    // Check the two Jacobians agree before timing them
+    Eigen::MatrixXd const Jn  = Central(signal, v);
+    Eigen::MatrixXd const Ja  = Automatic(model, v);
+    double const          err = (Ja - Jn).cwiseAbs().maxCoeff() / Jn.cwiseAbs().maxCoeff();
+
+    double const sig      = Time([&](int i) { return signal(Nudge(v, i)); });
+    double const num_jac  = Time([&](int i) { return Central(signal, Nudge(v, i)); });
+    double const auto_jac = Time([&](int i) { return Automatic(model, Nudge(v, i)); });
+    bool const   faster   = auto_jac < num_jac;
+    fmt::print("{:>8} {:>4} {:>10.1f} {:>10.1f} {:>10.1f} {:>10} {:>10} {:>10.1e}\n",
+               name,
+               Model::NV,
+               sig,
+               num_jac,
+               auto_jac,
+               faster ? "auto" : "numeric",
+               Model::prefer_autodiff ? "auto" : "numeric",
+               err);
+    return err < 1e-4;
+}
+} // namespace
+
+int main() {
+    SSSequence ss = json{{"TR", 4e-3},
+                         {"Trf", 100e-6},
+                         {"Tramp", 10e-3},
+                         {"spokes_per_seg", 256},
+                         {"FA", {4, 4, 4, 4, 4, 4, 4, 4}},
+                         {"prep_p1", 0.5},
+                         {"prep_p2", 0.4},
+                         {"prep_Trf", 5e-3},
+                         {"prep_FA", {0, 60, 120, 180, 240, 300, 360, 420}},
+                         {"prep_df", {0, 1000, 0, 1000, 0, 1000, 0, 1000}}};
+    // A Gaussian lineshape is enough to time the interpolation
+    Eigen::ArrayXd const gauss =
+        (-Eigen::ArrayXd::LinSpaced(256, 0., 2.5e4).square() / (2. * 5e3 * 5e3)).exp() * 1e-5;
+    QI::InterpLineshape const lineshape(0., 100., 256, gauss, 12e-6);
+    RUFISSequence             rufis = TestRUFIS();
+
+    fmt::print("Times in us per voxel. Jacobians by central differences and automatic "
+               "differentiation.\n");
+    fmt::print("{:>8} {:>4} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}\n",
+               "Model",
+               "NV",
+               "Signal",
+               "Central",
+               "Automatic",
+               "Faster",
+               "Default",
+               "Jac diff");
+    bool const ok = Row("SS_T1", SS_T1_Model{{}, ss}) & Row("SS_T1T2", SS_T1T2_Model{{}, ss}) &
+                    Row("SS_MT", SS_MT_Model{{}, ss, lineshape}) &
+                    Row("MUPA", MUPAModel{{}, rufis}) & Row("MUPAB1", MUPAB1Model{{}, rufis}) &
+                    Row("MUPAMT", MUPAMTModel{{}, rufis});
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
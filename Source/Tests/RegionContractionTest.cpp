@@ -0,0 +1,104 @@
+/*
+ *  RegionContractionTest.cpp - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2021 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *  Checks that region contraction evaluates functors with a batch interface through it, and that
+ *  from the same seed the batched and per-sample paths find the same minimum.
+ *
+ */
+
+#include <cstdlib>
+
+#include "fmt/format.h"
+
+#include "RegionContraction.h"
+
+namespace {
+constexpr int seed = 42;
+
+// A quadratic bowl with its minimum inside the bounds
+struct Bowl {
+    Eigen::ArrayXd centre, scale;
+    mutable size_t calls = 0;
+
+    int  inputs() const { return static_cast<int>(centre.size()); }
+    bool constraint(Eigen::ArrayXd const &) const { return true; }
+
+    double operator()(Eigen::ArrayXd const &v) const {
+        calls++;
+        return ((v - centre) * scale).square().sum();
+    }
+};
+
+struct BatchBowl : Bowl {
+    mutable size_t batches = 0;
+
+    void batch(Eigen::ArrayXXd const &samples, Eigen::ArrayXd &costs) const {
+        batches++;
+        costs = ((samples.colwise() - centre).colwise() * scale)
+                    .square()
+                    .colwise()
+                    .sum()
+                    .transpose();
+    }
+};
+
+template <typename Functor>
+Eigen::ArrayXd Optimise(Functor &f, QI::RCSampler const sampler, size_t &contractions) {
+    Eigen::ArrayXd const lo = Eigen::ArrayXd::Zero(f.inputs());
+    Eigen::ArrayXd const hi = Eigen::ArrayXd::Ones(f.inputs());
+    Eigen::ArrayXd const th = Eigen::ArrayXd::Constant(f.inputs(), 0.05);
+    QI::RegionContraction<Functor> rc(f, lo, hi, th, 5000, 50, 10, 0.02, true, false, seed);
+    rc.setSampler(sampler);
+    Eigen::ArrayXd params(f.inputs());
+    if (!rc.optimise(params)) {
+        fmt::print("Region contraction failed\n");
+        std::exit(EXIT_FAILURE);
+    }
+    contractions = rc.contractions();
+    return params;
+}
+
+bool Check(std::string const &name, QI::RCSampler const sampler) {
+    Eigen::ArrayXd centre(7), scale(7);
+    centre << 0.2, 0.35, 0.5, 0.65, 0.8, 0.3, 0.6;
+    scale << 1., 2., 4., 1., 0.5, 8., 3.;
+    Bowl      plain{centre, scale};
+    BatchBowl batched{{centre, scale}};
+    size_t    plain_contractions, batch_contractions;
+
+    Eigen::ArrayXd const p_plain = Optimise(plain, sampler, plain_contractions);
+    Eigen::ArrayXd const p_batch = Optimise(batched, sampler, batch_contractions);
+    double const         diff    = (p_plain - p_batch).abs().maxCoeff();
+    double const         error   = (p_batch - centre).abs().maxCoeff();
+    fmt::print("{} batches {} contractions {} difference {} error {}\n",
+               name,
+               batched.batches,
+               batch_contractions,
+               diff,
+               error);
+    if (batched.calls != 0 || batched.batches != batch_contractions) {
+        fmt::print("{} did not evaluate every contraction as a batch\n", name);
+        return false;
+    }
+    if (plain_contractions != batch_contractions || !(diff <= 1e-12)) {
+        fmt::print("{} batched and per-sample results differ\n", name);
+        return false;
+    }
+    if (!(error <= 0.05)) {
+        fmt::print("{} missed the minimum\n", name);
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+int main() {
+    bool const ok = Check("Random", QI::RCSampler::Random) & Check("Sobol", QI::RCSampler::Sobol);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,90 @@
+/*
+ *  SignalBench.h - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2021 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <utility>
+
+#include "fmt/format.h"
+
+/*
+ *  Timing and error reporting shared by the one- and two-pool signal tests and benchmarks, which
+ *  compare a fast signal against a reference over the same sequences
+ */
+namespace QI::SignalBench {
+
+constexpr int calls = 200000;
+
+// Nanoseconds per call of signal(T1). T1 is nudged each call so nothing can be hoisted out of the
+// loop.
+template <typename F> double Time(F const &signal, double const T1) {
+    double     sum   = 0.;
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; i++) {
+        sum += signal(T1 + i * 1e-9).abs().sum();
+    }
+    auto const stop = std::chrono::steady_clock::now();
+    if (!std::isfinite(sum)) {
+        fmt::print("Non-finite signal\n");
+        std::exit(EXIT_FAILURE);
+    }
+    return std::chrono::duration<double, std::nano>(stop - start).count() / calls;
+}
+
+inline void Header(std::string const &ref, std::string const &fast) {
+    fmt::print("{:>8} {:>8} {:>14} {:>14} {:>8}\n", "Signal", "Angles", ref, fast, "Speedup");
+}
+
+inline void Row(std::string const &name, long const size, double const ref, double const fast) {
+    fmt::print("{:>8} {:>8} {:>14.0f} {:>14.0f} {:>8.1f}\n", name, size, ref, fast, ref / fast);
+}
+
+// Largest difference relative to the largest reference signal
+template <typename A, typename B> double Error(A const &test, B const &ref) {
+    return (test - ref).abs().maxCoeff() / ref.abs().maxCoeff();
+}
+
+/*
+ *  The worst errors of two signals checked over the same samples. Stops at the first sample where
+ *  either is above the tolerance.
+ */
+class Errors {
+  public:
+    Errors(std::string a, std::string b, double const tolerance) :
+        m_a(std::move(a)), m_b(std::move(b)), m_tolerance(tolerance) {}
+
+    // Returns false, after printing where(), if either error is above the tolerance
+    template <typename Where> bool add(Where const &where, double const err_a, double const err_b) {
+        if (!(err_a <= m_tolerance) || !(err_b <= m_tolerance)) {
+            fmt::print("{}: {} error {} {} error {}\n", where(), m_a, err_a, m_b, err_b);
+            return false;
+        }
+        m_max_a = std::max(m_max_a, err_a);
+        m_max_b = std::max(m_max_b, err_b);
+        return true;
+    }
+
+    void print(std::string const &what) const {
+        fmt::print("Maximum relative {}: {} {} {} {}\n", what, m_a, m_max_a, m_b, m_max_b);
+    }
+
+  private:
+    std::string  m_a, m_b;
+    double const m_tolerance;
+    double       m_max_a = 0., m_max_b = 0.;
+};
+
+} // namespace QI::SignalBench
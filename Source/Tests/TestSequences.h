@@ -0,0 +1,36 @@
+/*
+ *  TestSequences.h - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2021 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include "transient_sequence.h"
+
+/*
+ *  A MUPA protocol with 12 segments, three prep pulses and a mix of one and four groups per
+ *  segment, shared by the PARMESAN tests and benchmarks
+ */
+inline RUFISSequence TestRUFIS() {
+    json const prep_pulses = {
+        {"none", {{"FAeff", 0.}, {"int_b1_sq", 0.}, {"T_long", 0.}, {"T_trans", 0.}}},
+        {"inv", {{"FAeff", 180.}, {"int_b1_sq", 2e4}, {"T_long", 10e-3}, {"T_trans", 5e-3}}},
+        {"t2", {{"FAeff", 0.}, {"int_b1_sq", 4e4}, {"T_long", 40e-3}, {"T_trans", 40e-3}}}};
+    json const doc = {{"TR", 2.5e-3},
+                      {"Tramp", 10e-3},
+                      {"spokes_per_seg", 512},
+                      {"FA", {3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2}},
+                      {"Trf", {20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20}},
+                      {"groups_per_seg", {1, 1, 1, 1, 1, 1, 4, 4, 4, 4, 4, 4}},
+                      {"prep_pulses", prep_pulses},
+                      {"prep",
+                       {"none", "inv", "t2", "none", "inv", "t2", "none", "inv", "t2", "none",
+                        "inv", "t2"}}};
+    return doc.get<RUFISSequence>();
+}
@@ -0,0 +1,76 @@
+/*
+ *  TransientBench.cpp - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2021 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *  Cost of the transient PARMESAN signals and of one Jacobian, which is what each iteration of a
+ *  fit pays for, compared to the general matrix function reference. The reference Jacobian uses
+ *  central differences, as the fits did before automatic differentiation.
+ *
+ */
+
+#include <cstdlib>
+
+#include "fmt/format.h"
+
+#include "ParmesanBench.h"
+#include "TestSequences.h"
+#include "TransientReference.h"
+#include "transient_b1_model.h"
+#include "transient_mt_model.h"
+
+namespace {
+using namespace QI::Bench;
+
+template <typename Model, typename Reference>
+void Row(std::string const &name, Model const &model, Reference const &reference, auto v) {
+    auto const signal = [&](auto const &p) {
+        return model.signal(p, typename Model::FixedArray());
+    };
+    auto const   nudge    = [&](int const i) { return Nudge(v, i); };
+    double const ref_sig  = Time([&](int i) { return reference(nudge(i)); });
+    double const sig      = Time([&](int i) { return signal(nudge(i)); });
+    double const ref_jac  = Time([&](int i) { return Central(reference, nudge(i)); });
+    double const num_jac  = Time([&](int i) { return Central(signal, nudge(i)); });
+    double const auto_jac = Time([&](int i) { return Automatic(model, nudge(i)); });
+    fmt::print("{:>8} {:>10.1f} {:>10.1f} {:>8.1f} {:>10.1f} {:>10.1f} {:>10.1f} {:>8.1f}\n",
+               name,
+               ref_sig,
+               sig,
+               ref_sig / sig,
+               ref_jac,
+               num_jac,
+               auto_jac,
+               ref_jac / std::min(num_jac, auto_jac));
+}
+} // namespace
+
+int main() {
+    auto sequence = TestRUFIS();
+    fmt::print("Times in us. Reference Jacobian by central differences, new by central and by "
+               "automatic differences.\n");
+    fmt::print("{:>8} {:>10} {:>10} {:>8} {:>10} {:>10} {:>10} {:>8}\n",
+               "Model",
+               "Ref sig",
+               "Signal",
+               "Speedup",
+               "Ref jac",
+               "Central",
+               "Automatic",
+               "Speedup");
+    MUPAB1Model const b1{{}, sequence};
+    Row("MUPAB1",
+        b1,
+        [&](auto const &p) { return QI::Reference::MUPAB1Signal(sequence, p); },
+        MUPAB1Model::VaryingArray{10., 1.2, 0.08, 0.95});
+    MUPAMTModel const mt{{}, sequence};
+    Row("MUPAMT",
+        mt,
+        [&](auto const &p) { return QI::Reference::MUPAMTSignal(sequence, p); },
+        MUPAMTModel::VaryingArray{10., 2., 1.2, 0.08, 0.95});
+    return EXIT_SUCCESS;
+}
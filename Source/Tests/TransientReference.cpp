@@ -0,0 +1,198 @@
+/*
+ *  TransientReference.cpp - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2021 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#include "TransientReference.h"
+
+#include <unsupported/Eigen/MatrixFunctions>
+
+#include "parmesan.hpp"
+
+namespace QI::Reference {
+
+Eigen::ArrayXd MUPAB1Signal(RUFISSequence const &sequence, Eigen::Array<double, 4, 1> const &v) {
+    using AugMat = Eigen::Matrix<double, 4, 4>;
+    using AugVec = Eigen::Vector<double, 4>;
+
+    double const M0 = v[0];
+    double const R1 = 1. / v[1];
+    double const R2 = 1. / v[2];
+    double const B1 = v[3];
+
+    AugMat R;
+    R << -R2, 0, 0, 0, //
+        0, -R2, 0, 0,  //
+        0, 0, -R1, R1, //
+        0, 0, 0, 0;
+
+    AugMat const Rrd  = (R * sequence.TR).exp();
+    AugMat const S    = Eigen::DiagonalMatrix<double, 4, 4>({0, 0, 1., 1.}).toDenseMatrix();
+    AugMat const ramp = (R * sequence.Tramp).exp();
+
+    // Setup readout segment matrices
+    std::vector<AugMat> TR_mats(sequence.size());
+    std::vector<AugMat> seg_mats(sequence.size());
+    for (int is = 0; is < sequence.size(); is++) {
+        AugMat       rf;
+        double const B1x = B1 * sequence.FA[is] / sequence.Trf[is];
+        rf << 0, 0, 0, 0,  //
+            0, 0, B1x, 0,  //
+            0, -B1x, 0, 0, //
+            0, 0, 0, 0;
+        AugMat const Ard = ((R + rf) * sequence.Trf[is]).exp();
+        TR_mats[is]      = S * Rrd * Ard;
+        seg_mats[is]     = TR_mats[is].pow(sequence.spokes_per_seg / sequence.groups_per_seg[is]);
+    }
+
+    // Setup pulse matrices
+    std::vector<AugMat> prep_mats(sequence.size());
+    for (int is = 0; is < sequence.size(); is++) {
+        auto const & p  = sequence.prep_pulses.at(sequence.prep[is]);
+        double const E2 = exp(-R2 * p.T_trans);
+        double const E1 = exp(-R1 * p.T_long);
+        AugMat       C;
+        C << 0, 0, 0, 0,                            //
+            0, 0, 0, 0,                             //
+            0, 0, E1 * E2 * cos(p.FAeff), (1 - E1), //
+            0, 0, 0, 1;
+        prep_mats[is] = C;
+    }
+
+    // First calculate the system matrix and get SS
+    AugMat X = AugMat::Identity();
+    for (int is = 0; is < sequence.size(); is++) {
+        for (int ig = 0; ig < sequence.groups_per_seg[is]; ig++) {
+            X = ramp * seg_mats[is] * ramp * prep_mats[is] * X;
+        }
+    }
+    AugVec const m_ss = SolveSteadyState(X);
+    // Now loop through the segments and record the signal for each
+    Eigen::ArrayXd sig(sequence.size());
+    AugVec         m_current = m_ss;
+    for (int is = 0; is < sequence.size(); is++) {
+        double segment_accumulate = 0.;
+        for (int ig = 0; ig < sequence.groups_per_seg[is]; ig++) {
+            AugVec const m_prepped = ramp * prep_mats[is] * m_current;
+            auto const   m_group_avg =
+                GeometricAvg(TR_mats[is],
+                             seg_mats[is],
+                             m_prepped,
+                             sequence.spokes_per_seg / sequence.groups_per_seg[is]);
+            segment_accumulate += m_group_avg[2] * sin(B1 * sequence.FA[is]);
+            m_current = ramp * seg_mats[is] * m_prepped;
+        }
+        sig[is] = M0 * segment_accumulate / sequence.groups_per_seg[is];
+    }
+    return sig;
+}
+
+Eigen::ArrayXd MUPASignal(RUFISSequence const &sequence, Eigen::Array<double, 3, 1> const &v) {
+    // MUPA is MUPAB1 with a nominal B1
+    Eigen::Array<double, 4, 1> v_b1;
+    v_b1 << v, 1.;
+    return MUPAB1Signal(sequence, v_b1);
+}
+
+Eigen::ArrayXd MUPAMTSignal(RUFISSequence const &sequence, Eigen::Array<double, 5, 1> const &v) {
+    using AugMat = Eigen::Matrix<double, 5, 5>;
+    using AugVec = Eigen::Vector<double, 5>;
+
+    double const M0_f = v[0];
+    double const M0_b = v[1];
+    double const R1_f = 1. / v[2];
+    double const R1_b = R1_f;
+    double const R2_f = 1. / v[3];
+    double const k    = 4.3;
+    double const k_bf = k * M0_f / (M0_f + M0_b);
+    double const k_fb = k * M0_b / (M0_f + M0_b);
+    double const B1   = v[4];
+    double const G0   = 1.4e-5;
+
+    AugMat R;
+    R << -R2_f, 0, 0, 0, 0,          //
+        0, -R2_f, 0, 0, 0,           //
+        0, 0, -R1_f, 0, M0_f * R1_f, //
+        0, 0, 0, -R1_b, M0_b * R1_b, //
+        0, 0, 0, 0, 0;
+
+    AugMat K;
+    K << 0, 0, 0, 0, 0,       //
+        0, 0, 0, 0, 0,        //
+        0, 0, -k_fb, k_bf, 0, //
+        0, 0, k_fb, -k_bf, 0, //
+        0, 0, 0, 0, 0;
+
+    AugMat const S   = Eigen::DiagonalMatrix<double, 5, 5>({0, 0, 1., 1., 1.}).toDenseMatrix();
+    AugMat const RpK = R + K;
+
+    // Setup readout segment matrices
+    AugMat const        ramp = (RpK * sequence.Tramp).exp();
+    std::vector<AugMat> TR_mats(sequence.size());
+    std::vector<AugMat> seg_mats(sequence.size());
+    for (int is = 0; is < sequence.size(); is++) {
+        double const B1x = B1 * sequence.FA[is] / sequence.Trf[is];
+        double const W   = M_PI * G0 * B1x * B1x;
+        AugMat       rf;
+        rf << 0, 0, 0, 0, 0,  //
+            0, 0, B1x, 0, 0,  //
+            0, -B1x, 0, 0, 0, //
+            0, 0, 0, -W, 0,   //
+            0, 0, 0, 0, 0;
+        AugMat const Rrd = (RpK * (sequence.TR - sequence.Trf[is])).exp();
+        AugMat const Ard = ((RpK + rf) * sequence.Trf[is]).exp();
+        TR_mats[is]      = S * Rrd * Ard;
+        seg_mats[is]     = TR_mats[is].pow(sequence.spokes_per_seg / sequence.groups_per_seg[is]);
+    }
+
+    // Setup pulse matrices
+    std::vector<AugMat> prep_mats(sequence.size());
+    for (int is = 0; is < sequence.size(); is++) {
+        auto const & p  = sequence.prep_pulses.at(sequence.prep[is]);
+        double const Ew = exp(-M_PI * G0 * B1 * B1 * p.int_b1_sq);
+        double const E2 = exp(-R2_f * p.T_trans);
+        AugMat       C;
+        C << 0, 0, 0, 0, 0,                //
+            0, 0, 0, 0, 0,                 //
+            0, 0, E2 * cos(p.FAeff), 0, 0, //
+            0, 0, 0, Ew, 0,                //
+            0, 0, 0, 0, 1;
+        prep_mats[is] = C;
+    }
+
+    // First calculate the system matrix
+    AugMat X = AugMat::Identity();
+    for (int is = 0; is < sequence.size(); is++) {
+        for (int ig = 0; ig < sequence.groups_per_seg[is]; ig++) {
+            X = ramp * seg_mats[is] * ramp * S * prep_mats[is] * X;
+        }
+    }
+    AugVec const m_ss = SolveSteadyState(X);
+
+    // Now loop through the segments and record the signal for each
+    Eigen::ArrayXd sig(sequence.size());
+    AugVec         m_current = m_ss;
+    for (int is = 0; is < sequence.size(); is++) {
+        double segment_accumulate = 0.;
+        for (int ig = 0; ig < sequence.groups_per_seg[is]; ig++) {
+            AugVec const m_prepped = ramp * S * prep_mats[is] * m_current;
+            auto const   m_group_avg =
+                GeometricAvg(TR_mats[is],
+                             seg_mats[is],
+                             m_prepped,
+                             sequence.spokes_per_seg / sequence.groups_per_seg[is]);
+            segment_accumulate += m_group_avg[2] * sin(B1 * sequence.FA[is]);
+            m_current = ramp * seg_mats[is] * m_prepped;
+        }
+        sig[is] = segment_accumulate / sequence.groups_per_seg[is];
+    }
+    return sig;
+}
+
+} // namespace QI::Reference
@@ -0,0 +1,26 @@
+/*
+ *  TransientReference.h - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2021 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ */
+
+#pragma once
+
+#include "transient_sequence.h"
+
+namespace QI::Reference {
+
+/*
+ *  The transient PARMESAN signals as they were before propagators.hpp, built from Eigen's general
+ *  matrix exp() and pow() with a loop over every group. Only used to check and time the models.
+ */
+Eigen::ArrayXd MUPASignal(RUFISSequence const &sequence, Eigen::Array<double, 3, 1> const &v);
+Eigen::ArrayXd MUPAB1Signal(RUFISSequence const &sequence, Eigen::Array<double, 4, 1> const &v);
+Eigen::ArrayXd MUPAMTSignal(RUFISSequence const &sequence, Eigen::Array<double, 5, 1> const &v);
+
+} // namespace QI::Reference
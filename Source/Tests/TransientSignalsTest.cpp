@@ -0,0 +1,141 @@
+/*
+ *  TransientSignalsTest.cpp - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2021 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *  Checks the closed-form propagators against Eigen's general matrix exp() and pow(), and the
+ *  transient PARMESAN signals against the general reference over the model bounds.
+ *
+ */
+
+#include <cstdlib>
+#include <random>
+
+#include "fmt/format.h"
+#include <unsupported/Eigen/MatrixFunctions>
+
+#include "TestSequences.h"
+#include "TransientReference.h"
+#include "propagators.hpp"
+#include "transient_b1_model.h"
+#include "transient_model.h"
+#include "transient_mt_model.h"
+
+namespace {
+constexpr int    samples   = 10000;
+constexpr double tolerance = 1e-9;
+
+std::mt19937_64 rng(42);
+
+double Uniform(double const lo, double const hi) {
+    return std::uniform_real_distribution<>(lo, hi)(rng);
+}
+
+template <typename M> double Error(M const &test, M const &ref) {
+    return (test - ref).cwiseAbs().maxCoeff() / ref.cwiseAbs().maxCoeff();
+}
+
+bool Check(std::string const &name, double const error) {
+    if (!(error <= tolerance)) {
+        fmt::print("{} error {} is above {}\n", name, error, tolerance);
+        return false;
+    }
+    return true;
+}
+
+bool CheckPropagators() {
+    double worst = 0.;
+    for (int i = 0; i < samples; i++) {
+        double const R1   = 1. / Uniform(0.01, 5.);
+        double const R2   = 1. / Uniform(0.01, 5.);
+        double const M0   = Uniform(0.1, 10.);
+        double const w    = Uniform(-5e4, 5e4);
+        double const w_y  = Uniform(-5e4, 5e4);
+        double const t    = Uniform(1e-6, 0.05);
+        double const k_fb = Uniform(0., 10.);
+        double const k_bf = Uniform(0., 10.);
+        double const M0_b = Uniform(0.1, 10.);
+        double const W    = Uniform(0., 1e3);
+
+        Eigen::Matrix4d R;
+        R << -R2, 0, 0, 0, //
+            0, -R2, 0, 0,  //
+            0, 0, -R1, R1 * M0, //
+            0, 0, 0, 0;
+        Eigen::Matrix4d rf = Eigen::Matrix4d::Zero();
+        rf(1, 2)           = w;
+        rf(2, 1)           = -w;
+        Eigen::Matrix4d rot = Eigen::Matrix4d::Zero();
+        rot(0, 2)           = -w_y;
+        rot(1, 2)           = -w;
+        rot(2, 0)           = w_y;
+        rot(2, 1)           = w;
+
+        Eigen::Matrix<double, 5, 5> R5;
+        R5 << -R2, 0, 0, 0, 0, //
+            0, -R2, 0, 0, 0,   //
+            0, 0, -R1 - k_fb, k_bf, R1 * M0, //
+            0, 0, k_fb, -R1 - k_bf, R1 * M0_b, //
+            0, 0, 0, 0, 0;
+        Eigen::Matrix<double, 5, 5> rf5 = Eigen::Matrix<double, 5, 5>::Zero();
+        rf5(1, 2)                       = w;
+        rf5(2, 1)                       = -w;
+        rf5(3, 3)                       = -W;
+
+        double const errors[] = {
+            Error(OnePoolRelax(R1, R2, M0, t), Eigen::Matrix4d((R * t).exp())),
+            Error(OnePoolPulse(R1, R2, M0, w, t), Eigen::Matrix4d(((R + rf) * t).exp())),
+            Error(OnePoolRotation(w, w_y, t), Eigen::Matrix4d((rot * t).exp())),
+            Error(TwoPoolRelax(R1, R1, R2, k_fb, k_bf, M0, M0_b, t),
+                  Eigen::Matrix<double, 5, 5>((R5 * t).exp())),
+            Error(TwoPoolPulse(R1, R1, R2, k_fb, k_bf, M0, M0_b, w, W, t),
+                  Eigen::Matrix<double, 5, 5>(((R5 + rf5) * t).exp()))};
+        for (auto const e : errors) {
+            worst = std::max(worst, e);
+        }
+        Eigen::Matrix4d const P = OnePoolPulse(R1, R2, M0, w, t);
+        int const             n = i % 1024;
+        worst                   = std::max(worst, Error(Pow(P, n), Eigen::Matrix4d(P.pow(n))));
+    }
+    fmt::print("Propagators maximum relative error {}\n", worst);
+    return Check("Propagators", worst);
+}
+
+template <typename Model, typename Reference>
+bool CheckModel(std::string const &name, Model const &model, Reference const &reference) {
+    double worst = 0.;
+    for (int i = 0; i < samples / 10; i++) {
+        typename Model::VaryingArray v;
+        for (int j = 0; j < Model::NV; j++) {
+            v[j] = Uniform(model.bounds_lo[j], model.bounds_hi[j]);
+        }
+        worst = std::max(
+            worst, Error(model.signal(v, typename Model::FixedArray()), reference(v)));
+    }
+    fmt::print("{} maximum relative error {}\n", name, worst);
+    return Check(name, worst);
+}
+} // namespace
+
+int main() {
+    auto              sequence = TestRUFIS();
+    MUPAModel const   mupa{{}, sequence};
+    MUPAB1Model const b1{{}, sequence};
+    MUPAMTModel const mt{{}, sequence};
+    bool const        ok =
+        CheckPropagators() &
+        CheckModel("MUPA",
+                   mupa,
+                   [&](auto const &v) { return QI::Reference::MUPASignal(sequence, v); }) &
+        CheckModel("MUPAB1",
+                   b1,
+                   [&](auto const &v) { return QI::Reference::MUPAB1Signal(sequence, v); }) &
+        CheckModel("MUPAMT", mt, [&](auto const &v) {
+            return QI::Reference::MUPAMTSignal(sequence, v);
+        });
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,56 @@
+/*
+ *  TwoPoolSignalsBench.cpp - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2021 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *  Time per call of the closed-form two-pool signals and the general reference
+ *
+ */
+
+#include <cstdlib>
+
+#include "SignalBench.h"
+#include "TwoPoolReference.h"
+#include "TwoPoolSignals.h"
+
+using namespace QI::SignalBench;
+
+int main() {
+    auto const spgr =
+        json{{"TR", 8e-3}, {"TE", 3e-3}, {"FA", {2, 4, 6, 8, 10, 12, 14, 16}}}
+            .get<QI::SPGREchoSequence>();
+    auto const ssfp =
+        json{{"TR", 8e-3},
+             {"FA", {12, 16, 24, 32, 40, 50, 60, 70, 12, 16, 24, 32, 40, 50, 60, 70}},
+             {"PhaseInc", {180, 180, 180, 180, 180, 180, 180, 180, 0, 0, 0, 0, 0, 0, 0, 0}}}
+            .get<QI::SSFPSequence>();
+
+    double const spgr_ref = Time(
+        [&](double T1_a) {
+            return QI::Reference::SPGR2(1., T1_a, 0.02, 1.07, 0.117, 0.2, 0.15, 25., 0.95, spgr);
+        },
+        0.465);
+    double const spgr_new = Time(
+        [&](double T1_a) {
+            return QI::SPGR2(1., T1_a, 0.02, 1.07, 0.117, 0.2, 0.15, 25., 0.95, spgr);
+        },
+        0.465);
+    double const ssfp_ref = Time(
+        [&](double T1_a) {
+            return QI::Reference::SSFP2(1., T1_a, 0.02, 1.07, 0.117, 0.2, 0.15, 25., 0.95, ssfp);
+        },
+        0.465);
+    double const ssfp_new = Time(
+        [&](double T1_a) {
+            return QI::SSFP2(1., T1_a, 0.02, 1.07, 0.117, 0.2, 0.15, 25., 0.95, ssfp);
+        },
+        0.465);
+    Header("Reference (ns)", "Closed (ns)");
+    Row("SPGR2", spgr.size(), spgr_ref, spgr_new);
+    Row("SSFP2", ssfp.size(), ssfp_ref, ssfp_new);
+    return EXIT_SUCCESS;
+}
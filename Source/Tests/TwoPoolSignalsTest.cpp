@@ -0,0 +1,106 @@
+/*
+ *  TwoPoolSignalsTest.cpp - Part of QUantitative Imaging Tools
+ *
+ *  Copyright (c) 2021 Tobias Wood.
+ *
+ *  This Source Code Form is subject to the terms of the Mozilla Public
+ *  License, v. 2.0. If a copy of the MPL was not distributed with this
+ *  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ *  Compares the closed-form two-pool signals against the general reference over the mcDESPOT
+ *  parameter bounds, plus a spread of off-resonance and B1, and the batched signals against the
+ *  single-sample ones.
+ *
+ */
+
+#include <cstdlib>
+#include <random>
+
+#include "SignalBench.h"
+#include "TwoPoolReference.h"
+#include "TwoPoolSignals.h"
+
+using namespace QI::SignalBench;
+
+namespace {
+constexpr int    samples   = 100000;
+constexpr int    batch     = 1000;
+constexpr double tolerance = 1e-9;
+} // namespace
+
+int main() {
+    // The protocol from the mcDESPOT tests
+    auto const spgr =
+        json{{"TR", 8e-3}, {"TE", 3e-3}, {"FA", {2, 4, 6, 8, 10, 12, 14, 16}}}
+            .get<QI::SPGREchoSequence>();
+    auto const ssfp =
+        json{{"TR", 8e-3},
+             {"FA", {12, 16, 24, 32, 40, 50, 60, 70, 12, 16, 24, 32, 40, 50, 60, 70}},
+             {"PhaseInc", {180, 180, 180, 180, 180, 180, 180, 180, 0, 0, 0, 0, 0, 0, 0, 0}}}
+            .get<QI::SSFPSequence>();
+
+    // PD, T1_a, T2_a, T1_b, T2_b, tau_a, f_a, f0, B1. The first seven are TwoPoolModel's bounds.
+    Eigen::Array<double, 9, 1> lo, hi;
+    lo << 1.0, 0.300, 0.010, 0.9, 0.040, 0.025, 0.001, -150., 0.7;
+    hi << 1.0, 0.800, 0.030, 3.0, 1.500, 0.600, 0.35, 150., 1.3;
+
+    std::mt19937_64                  rng(42);
+    std::uniform_real_distribution<> uniform(0., 1.);
+    Errors                           errors("SPGR2", "SSFP2", tolerance);
+    for (int i = 0; i < samples; i++) {
+        Eigen::Array<double, 9, 1> p;
+        // Start at the corners of the bounds, where the closed forms are most likely to break
+        for (int j = 0; j < 9; j++) {
+            double const u = (i < 512) ? ((i >> j) & 1) : uniform(rng);
+            p[j]           = lo[j] + u * (hi[j] - lo[j]);
+        }
+        double const spgr_err =
+            Error(QI::SPGR2(p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8], spgr),
+                  QI::Reference::SPGR2(p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8], spgr));
+        double const ssfp_err =
+            Error(QI::SSFP2(p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8], ssfp),
+                  QI::Reference::SSFP2(p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8], ssfp));
+
+        auto const where = [&] {
+            return fmt::format("Mismatch at {}", fmt::join(p.data(), p.data() + 9, " "));
+        };
+        if (!errors.add(where, spgr_err, ssfp_err)) {
+            return EXIT_FAILURE;
+        }
+    }
+    errors.print(fmt::format("error over {} samples", samples));
+
+    // Each batch shares f0 and B1, so use a fresh pair for each one
+    Errors batch_errors("SPGR2", "SSFP2", tolerance);
+    for (int i = 0; i < samples / batch; i++) {
+        Eigen::ArrayXXd v(7, batch);
+        for (int j = 0; j < 7; j++) {
+            for (int k = 0; k < batch; k++) {
+                v(j, k) = lo[j] + uniform(rng) * (hi[j] - lo[j]);
+            }
+        }
+        double const           f0         = lo[7] + uniform(rng) * (hi[7] - lo[7]);
+        double const           B1         = lo[8] + uniform(rng) * (hi[8] - lo[8]);
+        Eigen::ArrayXXcd const spgr_batch = QI::SPGR2(v, f0, B1, spgr);
+        Eigen::ArrayXXcd const ssfp_batch = QI::SSFP2(v, f0, B1, ssfp);
+        for (int k = 0; k < batch; k++) {
+            auto const   p = v.col(k);
+            double const spgr_err =
+                Error(spgr_batch.col(k),
+                      QI::SPGR2(p[0], p[1], p[2], p[3], p[4], p[5], p[6], f0, B1, spgr));
+            double const ssfp_err =
+                Error(ssfp_batch.col(k),
+                      QI::SSFP2(p[0], p[1], p[2], p[3], p[4], p[5], p[6], f0, B1, ssfp));
+
+            auto const where = [&] {
+                return fmt::format(
+                    "Batch mismatch at {} {} {}", fmt::join(p.data(), p.data() + 7, " "), f0, B1);
+            };
+            if (!batch_errors.add(where, spgr_err, ssfp_err)) {
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    batch_errors.print("batch error");
+    return EXIT_SUCCESS;
+}